@@ -0,0 +1,355 @@
+/* ****************************************************************************************************
+ * pmake-bench.c - Benchmark suite for pmake. Generates a synthetic C project of configurable size —
+ * number of source files, headers, header fan-in per file and lines per file — and measures how long
+ * pmake takes for a clean build, a no-op build, a rebuild after touching a single file, and for
+ * parsing the `.pmake` file. GNU make and a plain shell loop build the same project as baselines.
+ *
+ * Every measurement is written as CSV and JSON, so the numbers of two pmake releases can be compared
+ * side by side and a performance regression shows up here instead of in a production build.
+ *
+ * Usage: pmake-bench [--files N] [--headers N] [--fanin N] [--lines N] [--jobs N] [--runs N]
+ *                    [--cc COMPILER] [--pmake PATH] [--dir DIR] [--csv FILE] [--json FILE]
+ *                    [--no-make] [--no-shell]
+ *
+ * The harness relies on a POSIX shell to run the tools, so it targets Unix-like systems.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created.                                                         Version: 00.01
+ * **************************************************************************************************** */
+#define _XOPEN_SOURCE 700  // realpath()
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "parse.h"
+#include "util.h"
+
+// How often the `.pmake` file is parsed in-process to get a stable per-parse time.
+#define PARSE_ROUNDS 2000
+
+// The knobs of one benchmark session. Defaults give a mid-sized project that builds in seconds.
+typedef struct {
+    int files;          // Number of generated .c files (main.c comes on top)
+    int headers;        // Number of generated headers
+    int fanin;          // Headers included by every source file
+    int lines;          // Approximate lines of code per source file
+    int jobs;           // Parallel jobs for pmake and make
+    int runs;           // Repetitions of every measurement
+    int use_make;       // Measure GNU make as a baseline
+    int use_shell;      // Measure a plain shell loop as a baseline
+    const char *cc;     // Compiler for all tools
+    const char *pmake;  // The pmake binary under test
+    const char *dir;    // Where the project is generated
+    const char *csv;    // CSV result file
+    const char *json;   // JSON result file
+} BenchConfig;
+
+// One measurement: which tool, which scenario, which repetition, and how long it took.
+typedef struct {
+    const char *tool;
+    const char *scenario;
+    int run;
+    double seconds;
+} Sample;
+
+static Sample *samples = NULL;
+static int nsamples = 0;
+
+static void add_sample(const char *tool, const char *scenario, int run, double seconds) {
+    Sample *s = realloc(samples, sizeof(Sample) * (size_t)(nsamples + 1));
+    if (!s) return;
+    samples = s;
+    samples[nsamples].tool = tool;
+    samples[nsamples].scenario = scenario;
+    samples[nsamples].run = run;
+    samples[nsamples].seconds = seconds;
+    nsamples++;
+}
+
+// --------------------------------------------------------------------------------
+// Write a file below the project directory, creating missing directories.
+// --------------------------------------------------------------------------------
+static void write_text(const BenchConfig *cfg, const char *name, const char *text) {
+    char *path = str_printf("%s/%s", cfg->dir, name);
+    make_parent_dirs(path);
+
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        fprintf(stderr, "Error: Could not write %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    fputs(text, fp);
+    fclose(fp);
+    free(path);
+}
+
+// --------------------------------------------------------------------------------
+// Generate the synthetic project: headers with declarations and inline helpers,
+// source files that include `fanin` of them and define enough functions to reach
+// the requested line count, a main.c, and the build files for pmake, make and the
+// shell loop.
+// --------------------------------------------------------------------------------
+static void generate_project(const BenchConfig *cfg) {
+    StrBuf sb = {0};
+
+    for (int h = 0; h < cfg->headers; h++) {
+        sb.len = 0;
+        sb_printf(&sb, "#ifndef H_%d_H\n#define H_%d_H\n\n", h, h);
+        for (int k = 0; k < 20; k++) {
+            sb_printf(&sb, "#define H_%d_CONST_%d %d\n", h, k, h * 31 + k);
+        }
+        sb_printf(&sb, "\nstatic inline int h_%d_mix(int x) {\n    return (x * %d) ^ H_%d_CONST_3;\n}\n",
+                  h, h + 3, h);
+        sb_printf(&sb, "\n#endif\n");
+        char *name = str_printf("include/h_%d.h", h);
+        write_text(cfg, name, sb.data);
+        free(name);
+    }
+
+    for (int i = 0; i < cfg->files; i++) {
+        sb.len = 0;
+        int headers = cfg->fanin < cfg->headers ? cfg->fanin : cfg->headers;
+        for (int k = 0; k < headers; k++) {
+            sb_printf(&sb, "#include \"h_%d.h\"\n", (i * 7 + k) % cfg->headers);
+        }
+        sb_printf(&sb, "\n");
+
+        // Every function is six lines; the last one sums up the others so the
+        // optimizer can't throw the unit away.
+        int funcs = cfg->lines / 6 > 0 ? cfg->lines / 6 : 1;
+        for (int f = 0; f < funcs; f++) {
+            sb_printf(&sb, "static int unit_%d_f%d(int x) {\n", i, f);
+            sb_printf(&sb, "    int acc = x + %d;\n", f);
+            sb_printf(&sb, "    for (int i = 0; i < %d; i++) acc = acc * 3 + i;\n", f % 17 + 1);
+            sb_printf(&sb, "    acc ^= h_%d_mix(acc);\n", (i * 7) % cfg->headers);
+            sb_printf(&sb, "    return acc;\n}\n");
+        }
+        sb_printf(&sb, "\nint unit_%d(int x) {\n    int sum = 0;\n", i);
+        for (int f = 0; f < funcs; f++) sb_printf(&sb, "    sum += unit_%d_f%d(x);\n", i, f);
+        sb_printf(&sb, "    return sum;\n}\n");
+
+        char *name = str_printf("src/unit_%d.c", i);
+        write_text(cfg, name, sb.data);
+        free(name);
+    }
+
+    sb.len = 0;
+    for (int i = 0; i < cfg->files; i++) sb_printf(&sb, "int unit_%d(int x);\n", i);
+    sb_printf(&sb, "\nint main(int argc, char **argv) {\n    (void)argv;\n    int sum = 0;\n");
+    for (int i = 0; i < cfg->files; i++) sb_printf(&sb, "    sum += unit_%d(argc);\n", i);
+    sb_printf(&sb, "    return sum == 42;\n}\n");
+    write_text(cfg, "src/main.c", sb.data);
+
+    sb.len = 0;
+    sb_printf(&sb, "# Generated by pmake-bench.\ncomp=%s\nflags=-O0 -I./include\ntarget=exec\n", cfg->cc);
+    sb_printf(&sb, "bin=./bin\nproject=bench\nsrc=./src/*.c\nlibs=\n");
+    write_text(cfg, "bench.pmake", sb.data);
+
+    sb.len = 0;
+    sb_printf(&sb, "# Generated by pmake-bench.\nCC := %s\nCFLAGS := -O0 -Iinclude\n", cfg->cc);
+    sb_printf(&sb, "SRCS := $(wildcard src/*.c)\nOBJS := $(patsubst src/%%.c,mkobj/%%.o,$(SRCS))\n\n");
+    sb_printf(&sb, "mkbin/bench: $(OBJS)\n\t@mkdir -p mkbin\n\t$(CC) $(OBJS) -o $@\n\n");
+    sb_printf(&sb, "mkobj/%%.o: src/%%.c\n\t@mkdir -p mkobj\n\t$(CC) $(CFLAGS) -MMD -MP -c $< -o $@\n\n");
+    sb_printf(&sb, "-include $(OBJS:.o=.d)\n");
+    write_text(cfg, "Makefile", sb.data);
+
+    sb.len = 0;
+    sb_printf(&sb, "#!/bin/sh\n# Generated by pmake-bench: the naive way, one file after the other.\n");
+    sb_printf(&sb, "set -e\nmkdir -p shobj shbin\nfor f in src/*.c; do\n");
+    sb_printf(&sb, "    %s -O0 -Iinclude -c \"$f\" -o \"shobj/$(basename \"$f\" .c).o\"\ndone\n", cfg->cc);
+    sb_printf(&sb, "%s shobj/*.o -o shbin/bench\n", cfg->cc);
+    write_text(cfg, "build.sh", sb.data);
+
+    sb_free(&sb);
+}
+
+// --------------------------------------------------------------------------------
+// Run a shell command inside the project directory with its output discarded and
+// return the wall time it took. A failing command aborts the benchmark — timing a
+// broken build would only produce misleading numbers.
+// --------------------------------------------------------------------------------
+static double time_command(const BenchConfig *cfg, const char *cmd) {
+    char *full = str_printf("cd '%s' && %s >/dev/null 2>&1", cfg->dir, cmd);
+    double start = now_seconds();
+    int rc = system(full);
+    double elapsed = now_seconds() - start;
+
+    if (rc != 0) {
+        fprintf(stderr, "Error: Benchmark command failed: %s\n", full);
+        exit(EXIT_FAILURE);
+    }
+    free(full);
+    return elapsed;
+}
+
+// Mark one source file as modified right now, like an editor saving it.
+static void touch_source(const BenchConfig *cfg) {
+    char *path = str_printf("%s/src/unit_0.c", cfg->dir);
+    utimensat(AT_FDCWD, path, NULL, 0);
+    free(path);
+}
+
+// --------------------------------------------------------------------------------
+// Measure one tool through the three build scenarios. clean_cmd removes
+// everything the tool produced, build_cmd builds the project.
+// --------------------------------------------------------------------------------
+static void bench_tool(const BenchConfig *cfg, const char *tool, const char *clean_cmd,
+                       const char *build_cmd) {
+    for (int run = 1; run <= cfg->runs; run++) {
+        time_command(cfg, clean_cmd);
+        add_sample(tool, "clean", run, time_command(cfg, build_cmd));
+        add_sample(tool, "noop", run, time_command(cfg, build_cmd));
+        touch_source(cfg);
+        add_sample(tool, "touch", run, time_command(cfg, build_cmd));
+        printf("  %-6s run %d: clean %.3fs, no-op %.3fs, touch %.3fs\n", tool, run,
+               samples[nsamples - 3].seconds, samples[nsamples - 2].seconds,
+               samples[nsamples - 1].seconds);
+    }
+}
+
+// --------------------------------------------------------------------------------
+// Time the parser on its own, in-process, so process startup doesn't drown it.
+// The sample is the average time of one parse.
+// --------------------------------------------------------------------------------
+static void bench_parse(const BenchConfig *cfg) {
+    char *path = str_printf("%s/bench.pmake", cfg->dir);
+
+    for (int run = 1; run <= cfg->runs; run++) {
+        double start = now_seconds();
+        for (int i = 0; i < PARSE_ROUNDS; i++) {
+            char *errmsg = NULL;
+            Makefile *mf = parse(path, &errmsg);
+            if (!mf) {
+                fprintf(stderr, "Error: %s\n", errmsg ? errmsg : "parse failed");
+                exit(EXIT_FAILURE);
+            }
+            free_makefile(mf);
+        }
+        double per_parse = (now_seconds() - start) / PARSE_ROUNDS;
+        add_sample("pmake", "parse", run, per_parse);
+        printf("  pmake  run %d: parse %.2fus\n", run, per_parse * 1e6);
+    }
+
+    free(path);
+}
+
+static void write_csv(const BenchConfig *cfg) {
+    FILE *fp = fopen(cfg->csv, "w");
+    if (!fp) {
+        fprintf(stderr, "Error: Could not write %s\n", cfg->csv);
+        return;
+    }
+    fprintf(fp, "tool,scenario,files,headers,fanin,lines,jobs,run,seconds\n");
+    for (int i = 0; i < nsamples; i++) {
+        fprintf(fp, "%s,%s,%d,%d,%d,%d,%d,%d,%.6f\n", samples[i].tool, samples[i].scenario,
+                cfg->files, cfg->headers, cfg->fanin, cfg->lines, cfg->jobs, samples[i].run,
+                samples[i].seconds);
+    }
+    fclose(fp);
+}
+
+static void write_json(const BenchConfig *cfg) {
+    FILE *fp = fopen(cfg->json, "w");
+    if (!fp) {
+        fprintf(stderr, "Error: Could not write %s\n", cfg->json);
+        return;
+    }
+    fprintf(fp, "{\n  \"config\": {\"files\": %d, \"headers\": %d, \"fanin\": %d, \"lines\": %d, "
+                "\"jobs\": %d, \"runs\": %d},\n  \"samples\": [\n",
+            cfg->files, cfg->headers, cfg->fanin, cfg->lines, cfg->jobs, cfg->runs);
+    for (int i = 0; i < nsamples; i++) {
+        fprintf(fp, "    {\"tool\": \"%s\", \"scenario\": \"%s\", \"run\": %d, \"seconds\": %.6f}%s\n",
+                samples[i].tool, samples[i].scenario, samples[i].run, samples[i].seconds,
+                i + 1 < nsamples ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+    fclose(fp);
+}
+
+static int parse_int(const char *arg, const char *value) {
+    int n = value ? atoi(value) : 0;
+    if (n < 1) {
+        fprintf(stderr, "Error: %s needs a positive number.\n", arg);
+        exit(EXIT_FAILURE);
+    }
+    return n;
+}
+
+int main(int argc, char **argv) {
+    BenchConfig cfg = { 200, 50, 10, 120, 0, 3, 1, 1, "cc", "bin/pmake", "bench/out/project",
+                        "bench/out/results.csv", "bench/out/results.json" };
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if      (strcmp(a, "--files") == 0)   { cfg.files = parse_int(a, v); i++; }
+        else if (strcmp(a, "--headers") == 0) { cfg.headers = parse_int(a, v); i++; }
+        else if (strcmp(a, "--fanin") == 0)   { cfg.fanin = parse_int(a, v); i++; }
+        else if (strcmp(a, "--lines") == 0)   { cfg.lines = parse_int(a, v); i++; }
+        else if (strcmp(a, "--jobs") == 0)    { cfg.jobs = parse_int(a, v); i++; }
+        else if (strcmp(a, "--runs") == 0)    { cfg.runs = parse_int(a, v); i++; }
+        else if (strcmp(a, "--cc") == 0 && v)    { cfg.cc = v; i++; }
+        else if (strcmp(a, "--pmake") == 0 && v) { cfg.pmake = v; i++; }
+        else if (strcmp(a, "--dir") == 0 && v)   { cfg.dir = v; i++; }
+        else if (strcmp(a, "--csv") == 0 && v)   { cfg.csv = v; i++; }
+        else if (strcmp(a, "--json") == 0 && v)  { cfg.json = v; i++; }
+        else if (strcmp(a, "--no-make") == 0)    cfg.use_make = 0;
+        else if (strcmp(a, "--no-shell") == 0)   cfg.use_shell = 0;
+        else {
+            fprintf(stderr, "Usage: %s [--files N] [--headers N] [--fanin N] [--lines N] [--jobs N]\n"
+                            "       [--runs N] [--cc COMPILER] [--pmake PATH] [--dir DIR]\n"
+                            "       [--csv FILE] [--json FILE] [--no-make] [--no-shell]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // The tools run inside the project directory, so pmake needs an absolute path.
+    char pmake[PATH_MAX];
+    if (!realpath(cfg.pmake, pmake)) {
+        fprintf(stderr, "Error: pmake binary not found: %s (build it first or pass --pmake)\n", cfg.pmake);
+        return EXIT_FAILURE;
+    }
+    if (cfg.jobs == 0) {
+        long n = 1;
+#ifdef _SC_NPROCESSORS_ONLN
+        n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+        cfg.jobs = n > 0 ? (int)n : 1;
+    }
+
+    printf("Generating %d files (%d headers, fan-in %d, ~%d lines each) in %s\n", cfg.files,
+           cfg.headers, cfg.fanin, cfg.lines, cfg.dir);
+    char *wipe = str_printf("rm -rf '%s'", cfg.dir);
+    system(wipe);
+    free(wipe);
+    generate_project(&cfg);
+
+    char *pmake_build = str_printf("'%s' -j %d bench", pmake, cfg.jobs);
+    char *make_build = str_printf("make -j %d", cfg.jobs);
+
+    printf("Measuring %d run(s) with %d job(s):\n", cfg.runs, cfg.jobs);
+    bench_tool(&cfg, "pmake", "rm -rf build bin", pmake_build);
+    if (cfg.use_make)  bench_tool(&cfg, "make", "rm -rf mkobj mkbin", make_build);
+    if (cfg.use_shell) bench_tool(&cfg, "shell", "rm -rf shobj shbin", "sh ./build.sh");
+    bench_parse(&cfg);
+
+    make_parent_dirs(cfg.csv);
+    make_parent_dirs(cfg.json);
+    write_csv(&cfg);
+    write_json(&cfg);
+    printf("Results written to %s and %s\n", cfg.csv, cfg.json);
+
+    free(pmake_build);
+    free(make_build);
+    free(samples);
+    return EXIT_SUCCESS;
+}
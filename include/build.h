@@ -0,0 +1,220 @@
+/* ****************************************************************************************************
+ * build.h - The build driver. Takes a parsed Makefile, expands the source list into individual
+ * translation units, compiles them concurrently into object files and links the result into the
+ * configured output. Everything that turns configuration into compiler invocations lives behind
+ * this interface.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created.                                                         Version: 00.01
+ * Sun 2026-10-18 Keep-going mode and a BuildResult per kind of failure.                Version: 00.02
+ * Sun 2026-10-18 BuildPlan: the commands of a build, computed without running them.    Version: 00.03
+ * Sun 2026-10-18 Depfiles per unit, dry-run and explain options.                       Version: 00.04
+ * Sun 2026-10-18 Statistics options.                                                   Version: 00.05
+ * Sun 2026-10-18 BuildPlan keeps the compile flags shared by all units.                Version: 00.06
+ * Sun 2026-10-18 BuildPlan carries the probed toolchain.                               Version: 00.07
+ * Sun 2026-10-18 BuildPlan knows lang=c++ builds and their module flags.               Version: 00.08
+ * Sun 2026-10-18 BuildPlan carries the split DWARF steps after the link.               Version: 00.09
+ * Sun 2026-10-18 Options for a progress callback and handing out the statistics.       Version: 00.10
+ * Sun 2026-10-18 BuildPlan knows its object directory and links to a temporary name.   Version: 00.11
+ * Sun 2026-10-18 Test executables of tests=, plan_tests() and list_tests().            Version: 00.12
+ * Sun 2026-10-18 BUILD_PGO_FAILED for pmake --pgo.                                     Version: 00.13
+ * Sun 2026-10-18 BuildPlan carries the flags of pkg=.                                  Version: 00.14
+ * Sun 2026-10-18 BuildPlan carries the rules of gen=, their sources join the units.    Version: 00.15
+ * Sun 2026-10-18 object_dir() only returns a private tmpfs directory.                  Version: 00.16
+ * Sun 2026-10-18 catch_signals in the build options.                                   Version: 00.17
+ * **************************************************************************************************** */
+#ifndef BUILD_H
+#define BUILD_H
+
+#include "parse.h"
+#include "toolchain.h"
+#include "gen.h"
+#include "jobs.h"
+#include "stats.h"
+#include "util.h"
+
+// Options that come from the command line rather than from the `.pmake` file. They change how a
+// build runs, not what it produces.
+typedef struct {
+    int jobs;       // Number of compiler processes to run at once
+    int keep_going; // Build everything that doesn't depend on a failed unit
+    int dry_run;    // Print the commands that would run instead of running them
+    int explain;    // Print why each unit is (or isn't) rebuilt
+    int stats;      // Print detailed build statistics
+    const char *stats_json; // Append build statistics as JSON lines to this file, or NULL
+    JobProgress progress;   // Gets every finished compile and link instead of stdout, or NULL
+    void *progress_ctx;     // Passed to progress
+    BuildStats *report;     // Receives the statistics of the build (free with free_stats()), or NULL
+    int tests;      // Build the test executables of tests= as well
+    int catch_signals;      // Stop the build on SIGINT and SIGTERM, as the command does
+} BuildOptions;
+
+// The outcome of a build. The values double as the exit codes of pmake, so scripts and CI can tell
+// a broken configuration from a compile error from a link error without parsing any output.
+typedef enum {
+    BUILD_OK             = 0,
+    BUILD_CONFIG_ERROR   = 2,   // The .pmake file or the command line is unusable
+    BUILD_COMPILE_FAILED = 3,   // A gen= rule failed or at least one translation unit didn't compile
+    BUILD_LINK_FAILED    = 4,   // Everything compiled, but the final link failed
+    BUILD_TEST_FAILED    = 5,   // Everything was built, but at least one test failed
+    BUILD_PGO_FAILED     = 6    // The training run of pmake --pgo failed or left no profile
+} BuildResult;
+
+// One translation unit of the build: where it comes from, where its object and depfile go, and
+// the exact compiler command that turns one into the other.
+typedef struct {
+    char *src;
+    char *obj;
+    char *dep;
+    char *cmd;
+} Unit;
+
+// What debug=dwp and debug=strip do to the linked output. The package and the debug file are both
+// read out of the fresh output, so they are made at the same time; stripping the output has to wait
+// for both.
+typedef struct {
+    char *dwp_cmd;      // Packs the .dwo files of the output into output.dwp, or NULL
+    char *keep_cmd;     // Copies the debug info of the output into output.debug, or NULL
+    char *strip_cmd;    // Strips the output and points it at output.debug, or NULL
+    StrList dwo;        // .dwo files that go into the package
+} DebugSteps;
+
+// One test of tests=: its source is compiled like the units of the project, then linked with the
+// project's objects (all but the one that defines main()) into an executable of its own, named after
+// the source, next to the output.
+typedef struct {
+    int unit;           // The test's unit in the plan
+    char *output;       // The test executable, "./bin/test_parse" for "./tests/test_parse.c"
+    char *link_output;  // Where the link writes, renamed to output on success
+    char *link_cmd;
+    StrList inputs;     // The test's object first, then the project's objects
+} TestLink;
+
+// Everything a build would do, worked out before anything runs: the units, the final output and
+// the command that links it. Tools that need the commands without compiling (the compilation
+// database, for instance) stop here.
+//
+// The link writes to a temporary name next to the output, and the debug steps work on that file.
+// Only when all of them succeeded is it renamed over the output, so an interrupted or failed link
+// never leaves a half-written output behind.
+typedef struct {
+    Unit *units;
+    int count;
+    char *objdir;       // Object directory, objdir=tmpfs already resolved
+    char *flags;        // Flags every unit is compiled with, or NULL
+    char *pkg_cflags;   // Compile flags of the pkg= packages, or NULL
+    char *pkg_libs;     // Link flags of the pkg= packages, or NULL
+    StrList inputs;     // Object files of all units, in link order
+    char *output;
+    char *link_output;  // Where the link writes, renamed to output once the build succeeded
+    char *link_cmd;
+    Toolchain tc;       // What the compiler can do; the commands are tailored to it
+    int cxx;            // lang=c++: the units may use named modules
+    char *module_flags; // Where the compiler finds module interfaces, or NULL
+    int split_dwarf;    // debug=split: units leave their DWARF in .dwo files next to the objects
+    DebugSteps debug;   // Steps that run on the output after every link
+    TestLink *tests;    // Tests, only after plan_tests(); their units follow the project's
+    int ntests;
+    GenRule *gens;      // Rules of gen=, run before anything is compiled
+    int ngens;
+} BuildPlan;
+
+// --------------------------------------------------------------------------------
+// Fill the options with their defaults: one job per online processor, stop at the
+// first error.
+//
+// @param opts  Options struct to initialize
+// --------------------------------------------------------------------------------
+void default_build_options(BuildOptions *opts);
+
+// --------------------------------------------------------------------------------
+// Work out the build plan for a configuration: probe the compiler and ask
+// pkg-config for the flags of pkg= (both usually cache hits), expand the source
+// list, add the sources gen= generates and build the compile command of every
+// unit, the link command and the debug steps after it. Nothing is compiled,
+// nothing is generated and nothing but the caches and the objdir=tmpfs directory
+// is written to disk. A debug directive the toolchain can't carry out, a package
+// pkg-config doesn't know and a malformed gen= rule are errors.
+//
+// @param mf      Parsed build configuration
+// @param plan    Plan to fill in; release it with free_plan()
+// @param errmsg  Set to an allocated message on failure
+// @return        0 on success, -1 on failure
+// --------------------------------------------------------------------------------
+int plan_build(const Makefile *mf, BuildPlan *plan, char **errmsg);
+
+// --------------------------------------------------------------------------------
+// Add the tests of tests= to a plan: a unit per test source, appended after the
+// units of the project, and the command that links it. The project's sources are
+// read to find the one that defines main(), which the tests are linked without.
+// A configuration without tests=, a test source that is a project source as well,
+// and two tests with the same name are errors.
+//
+// @param mf      Parsed build configuration
+// @param plan    Plan filled in by plan_build()
+// @param errmsg  Set to an allocated message on failure
+// @return        0 on success, -1 on failure
+// --------------------------------------------------------------------------------
+int plan_tests(const Makefile *mf, BuildPlan *plan, char **errmsg);
+
+// --------------------------------------------------------------------------------
+// List the test executables of tests=, in the order of the directive. Nothing is
+// probed and nothing is read but the directories the patterns are matched in.
+//
+// @param mf      Parsed build configuration
+// @param out     List that receives the paths
+// @param errmsg  Set to an allocated message if tests= is missing or matches nothing
+// @return        0 on success, -1 on failure
+// --------------------------------------------------------------------------------
+int list_tests(const Makefile *mf, StrList *out, char **errmsg);
+
+// --------------------------------------------------------------------------------
+// Return the object directory of a configuration: objdir, with objdir=tmpfs
+// resolved to a directory in /dev/shm (or ./build without one). The tmpfs
+// directory is created with mode 0700; one that exists but isn't a directory of
+// this user that only it can write to is not used, ./build is, with a warning.
+//
+// @return  Allocated directory without a trailing slash (caller frees)
+// --------------------------------------------------------------------------------
+char *object_dir(const Makefile *mf);
+
+// --------------------------------------------------------------------------------
+// List the files a successful build leaves in the bin directory: the output
+// itself, then output.dwp for debug=dwp and output.debug for debug=strip.
+// Nothing is probed and nothing is read from disk.
+//
+// @param mf   Parsed build configuration
+// @param out  List that receives the paths
+// --------------------------------------------------------------------------------
+void build_outputs(const Makefile *mf, StrList *out);
+
+// --------------------------------------------------------------------------------
+// Free everything owned by a build plan. Safe to call on a plan that
+// plan_build() failed to fill.
+// --------------------------------------------------------------------------------
+void free_plan(BuildPlan *plan);
+
+// --------------------------------------------------------------------------------
+// Execute the build process based on the provided Makefile configuration.
+// The rules of gen= whose outputs are out of date run first. Then every stale
+// source file is compiled into its own object file, up to opts->jobs at a time,
+// and the objects are linked into the output in the bin directory. Units whose
+// object is newer than the source and all its headers, and that were built with
+// the same command, are skipped. With opts->tests the test sources are compiled
+// along with the project's, and every test is linked next to it.
+//
+// On failure, errmsg will point to an allocated string describing the issue.
+// Caller is responsible for freeing errmsg if set.
+//
+// @param mf      Parsed build configuration
+// @param opts    Command line options for this build
+// @param errmsg  Output pointer for error messages (set to NULL on success)
+// @return        BUILD_OK on success, otherwise the kind of failure
+// --------------------------------------------------------------------------------
+BuildResult run(const Makefile *mf, const BuildOptions *opts, char **errmsg);
+
+#endif
@@ -0,0 +1,36 @@
+/* ****************************************************************************************************
+ * compdb.h - Emits a JSON compilation database (compile_commands.json) for a project. clangd,
+ * clang-tidy and most static analysers read this file to learn the exact command every source file
+ * is compiled with. The database comes straight from the build plan, so it always matches what a
+ * real build would run — and writing it never compiles anything.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created.                                                         Version: 00.01
+ * **************************************************************************************************** */
+#ifndef COMPDB_H
+#define COMPDB_H
+
+#include "parse.h"
+#include "build.h"
+
+// The conventional name tools look for in the project root.
+#define COMPDB_FILE "compile_commands.json"
+
+// --------------------------------------------------------------------------------
+// Write a compilation database with one entry per expanded source file. Each
+// entry holds the working directory, the source file, the object file and the
+// full compiler command. The file is replaced atomically, so an editor reading
+// it at the same moment never sees half of it.
+//
+// @param mf      Parsed build configuration
+// @param path    File to write, usually COMPDB_FILE
+// @param errmsg  Set to an allocated message on failure
+// @return        BUILD_OK on success, BUILD_CONFIG_ERROR otherwise
+// --------------------------------------------------------------------------------
+BuildResult write_compdb(const Makefile *mf, const char *path, char **errmsg);
+
+#endif
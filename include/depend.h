@@ -0,0 +1,145 @@
+/* ****************************************************************************************************
+ * depend.h - Rebuild decisions. Knows when an object file is out of date and, just as important, why:
+ * the object is missing, the source is newer, one of the headers it includes changed, or the command
+ * that built it changed. Header dependencies come from the depfiles the compiler writes next to each
+ * object (-MMD), commands are remembered in a small log in the object directory.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created.                                                         Version: 00.01
+ * Sun 2026-10-18 check_object() falls back to scanned headers without a depfile.       Version: 00.02
+ * Sun 2026-10-18 New reason STALE_CHANGED_MODULE.                                      Version: 00.03
+ * Sun 2026-10-18 Content hashes in the log, relink only if an object's bytes changed.  Version: 00.04
+ * **************************************************************************************************** */
+#ifndef DEPEND_H
+#define DEPEND_H
+
+#include <stdint.h>
+#include "util.h"
+
+// Why a file has to be rebuilt. STALE_NONE means it is up to date.
+typedef enum {
+    STALE_NONE = 0,
+    STALE_MISSING_OUTPUT,   // The object (or final output) doesn't exist yet
+    STALE_NEWER_SOURCE,     // The source file is newer than the object
+    STALE_CHANGED_HEADER,   // A header listed in the depfile is newer than the object
+    STALE_CHANGED_FLAGS,    // The command differs from the one that built the object
+    STALE_NO_DEPFILE,       // No depfile, so the headers can't be checked
+    STALE_NEWER_INPUT,      // An input of the link is newer than the output
+    STALE_CHANGED_MODULE    // A C++ module the unit imports is recompiled or newer than the object
+} StaleReason;
+
+// The command log: for every file pmake produced, a hash of the command that produced it. The
+// first `sorted` entries are kept sorted by path so lookups are a binary search even for thousands
+// of objects; entries recorded during a build are appended and sorted in when the log is saved.
+//
+// Next to the command, the log remembers content: for an object the hash of its bytes, for the
+// final output the digest of the objects it was linked from. 0 means not known. The modification
+// time the content was hashed at tells whether the hash still holds without reading the file.
+typedef struct {
+    char **paths;
+    uint64_t *hashes;
+    uint64_t *contents;
+    long long *stamps;
+    int count;
+    int cap;
+    int sorted;
+    char *file;
+} CommandLog;
+
+// --------------------------------------------------------------------------------
+// Load the command log from a file. A missing or unreadable file gives an empty
+// log — the worst that happens is that everything is considered changed once.
+//
+// @param log   Log to initialize
+// @param file  Path of the log file; remembered for save_command_log()
+// --------------------------------------------------------------------------------
+void load_command_log(CommandLog *log, const char *file);
+
+// --------------------------------------------------------------------------------
+// Record the command that just produced a file, replacing an older entry.
+// --------------------------------------------------------------------------------
+void record_command(CommandLog *log, const char *path, const char *cmd);
+
+// --------------------------------------------------------------------------------
+// Record the content of a file pmake produced: the hash of an object's bytes, or
+// the inputs digest of the final output, together with the file's modification
+// time. Adds an entry if the path is new.
+// --------------------------------------------------------------------------------
+void record_content(CommandLog *log, const char *path, uint64_t content, long long stamp);
+
+// --------------------------------------------------------------------------------
+// Compute the digest of the link inputs from the content hash of every input, in
+// link order. An input is only read when the log has no hash for it or the file
+// was modified since it was hashed; the new hash is recorded. Timestamps don't
+// enter the digest, so a recompiled object with the same bytes leaves it as is.
+//
+// @param log     Command log of the object directory
+// @param inputs  Object files that go into the output
+// @return        The digest
+// --------------------------------------------------------------------------------
+uint64_t inputs_digest(CommandLog *log, const StrList *inputs);
+
+// --------------------------------------------------------------------------------
+// Write the log back to the file it was loaded from, atomically.
+//
+// @return  0 on success, -1 on failure
+// --------------------------------------------------------------------------------
+int save_command_log(CommandLog *log);
+
+// --------------------------------------------------------------------------------
+// Free everything owned by the log.
+// --------------------------------------------------------------------------------
+void free_command_log(CommandLog *log);
+
+// --------------------------------------------------------------------------------
+// Parse a Makefile-style depfile as written by -MMD and append every
+// prerequisite (the source first, then the headers) to the list.
+//
+// @param depfile  Path of the depfile
+// @param out      List that receives the prerequisites
+// @return         0 on success, -1 if the file can't be read
+// --------------------------------------------------------------------------------
+int read_depfile(const char *depfile, StrList *out);
+
+// --------------------------------------------------------------------------------
+// Decide whether one object file must be recompiled.
+//
+// @param log      Command log of the object directory
+// @param src      Source file of the unit
+// @param obj      Object file of the unit
+// @param dep      Depfile of the unit
+// @param cmd      Command that would compile the unit now
+// @param scanned  Headers found by the include scanner, used when the depfile is
+//                 missing; NULL reports a missing depfile instead
+// @param detail   Receives an allocated description of the culprit (a file name)
+//                 or NULL; caller frees
+// @return         The reason to rebuild, or STALE_NONE
+// --------------------------------------------------------------------------------
+StaleReason check_object(const CommandLog *log, const char *src, const char *obj,
+                         const char *dep, const char *cmd, const StrList *scanned, char **detail);
+
+// --------------------------------------------------------------------------------
+// Decide whether the final output must be relinked from its inputs. When the log
+// holds the inputs digest of the last link, newer inputs only count if their
+// content differs (early cutoff); an older log falls back to timestamps.
+//
+// @param log      Command log of the object directory
+// @param output   Path of the final output
+// @param inputs   Object files that go into the output
+// @param cmd      Command that would link the output now
+// @param detail   Receives an allocated description of the culprit or NULL
+// @return         The reason to relink, or STALE_NONE
+// --------------------------------------------------------------------------------
+StaleReason check_output(CommandLog *log, const char *output, const StrList *inputs,
+                         const char *cmd, char **detail);
+
+// --------------------------------------------------------------------------------
+// Return a short human-readable text for a reason, e.g. "changed header".
+// --------------------------------------------------------------------------------
+const char *stale_reason_text(StaleReason reason);
+
+#endif
@@ -0,0 +1,57 @@
+/* ****************************************************************************************************
+ * gen.h - The gen= directive: sources that a command generates before the build compiles them, a
+ * parser table from a grammar, a header from a data file, a lookup table from a script. Every gen=
+ * line is one rule, "outputs: inputs | command", and the build runs the rules whose outputs are
+ * missing, older than one of the inputs or were made by a different command, as many at a time as it
+ * compiles units. Generated files with a source extension join the sources of the build.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created.                                                         Version: 00.01
+ * **************************************************************************************************** */
+#ifndef GEN_H
+#define GEN_H
+
+#include "util.h"
+
+// One rule of gen=. A rule that reads what another rule writes depends on it: it waits for that rule
+// and runs whenever that rule runs.
+typedef struct {
+    char *cmd;          // Shell command that writes the outputs
+    StrList outputs;    // Files the command writes
+    StrList inputs;     // Files the command reads, may be empty
+    int *deps;          // Rules that write one of the inputs, all of them earlier in the list
+    int ndeps;
+} GenRule;
+
+// --------------------------------------------------------------------------------
+// Parse the rules of gen=, one per line: the outputs, a colon, the inputs, a bar
+// and the command. The colon has to be followed by whitespace, so a drive letter
+// isn't taken for it. The rules come back ordered so that every rule follows the
+// rules it depends on. A rule without an output or a command, two rules that
+// write the same file and rules that depend on each other in a cycle are errors.
+//
+// @param gen     The gen directive, rules separated by line breaks
+// @param rules   Receives the allocated rules; release them with free_gen_rules()
+// @param count   Receives the number of rules
+// @param errmsg  Set to an allocated message on failure
+// @return        0 on success, -1 on failure
+// --------------------------------------------------------------------------------
+int parse_gen_rules(const char *gen, GenRule **rules, int *count, char **errmsg);
+
+// --------------------------------------------------------------------------------
+// Tell whether a generated file is a source the build compiles: a C or C++
+// source or a C++ module unit, by its extension. Headers and everything else
+// are only read by other sources or rules.
+// --------------------------------------------------------------------------------
+int is_generated_source(const char *path);
+
+// --------------------------------------------------------------------------------
+// Free rules returned by parse_gen_rules(). NULL-safe.
+// --------------------------------------------------------------------------------
+void free_gen_rules(GenRule *rules, int count);
+
+#endif
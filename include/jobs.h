@@ -0,0 +1,127 @@
+/* ****************************************************************************************************
+ * jobs.h - A small pool for running shell commands concurrently. Each command runs as its own child
+ * process with stdout and stderr captured through a pipe. When a job finishes, its progress line and
+ * everything it printed are written out in one piece, so warnings from parallel compilers never end
+ * up interleaved mid-line.
+ *
+ * Jobs can depend on other jobs. A job only starts once everything it depends on succeeded; if one of
+ * its dependencies failed, it is skipped. By default the first failure stops the whole pool and
+ * terminates every running child, in keep-going mode everything that can still be built is built.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created.                                                         Version: 00.01
+ * Sun 2026-10-18 Job dependencies, fail-fast cancellation and keep-going mode.         Version: 00.02
+ * Sun 2026-10-18 Per-job timing and resource usage, JobPool settings struct.           Version: 00.03
+ * Sun 2026-10-18 Optional function to run instead of the shell command.                Version: 00.04
+ * Sun 2026-10-18 Progress callback that takes over the reporting of finished jobs.     Version: 00.05
+ * Sun 2026-10-18 Per-job timeout and JOB_TIMED_OUT.                                    Version: 00.06
+ * Sun 2026-10-18 Dispatch hooks: jobs are placed when they start, not when made.       Version: 00.07
+ * Sun 2026-10-18 Signal handlers only with catch_signals set in the pool.              Version: 00.08
+ * **************************************************************************************************** */
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stddef.h>
+
+// Special values of Job.status for jobs that didn't run to completion. Everything >= 0 is the exit
+// code of the command.
+#define JOB_NOT_RUN     -1  // Never started, because the pool stopped early
+#define JOB_SKIPPED     -2  // Not started, because a dependency failed
+#define JOB_CANCELLED   -3  // Terminated by the pool after another job failed
+#define JOB_TIMED_OUT   -4  // Killed after running longer than its timeout; counts as failed
+
+// One unit of work for the pool: a shell command plus the short label shown in the progress line
+// (usually the source file). deps lists the indices of jobs in the same array that must succeed
+// before this one may start. After run_jobs() returns, status holds the exit code of the command
+// (or one of the JOB_* values above) and output holds everything it wrote to stdout and stderr.
+// The timing fields tell how long the job took and what it cost.
+//
+// A job with fn set runs fn(arg) in the forked child instead of the shell command; its return value
+// is the exit code. cmd still names the job in the "FAILED:" line. On Windows fn runs in-process.
+//
+// A job with a timeout is killed, together with everything it started, once it has run for that
+// many seconds. Windows runs jobs through system() and can't enforce it.
+typedef struct {
+    char *cmd;
+    char *label;
+    int (*fn)(void *arg);
+    void *arg;
+    int *deps;
+    int ndeps;
+    int status;
+    char *output;
+    size_t output_len;
+    double wall;        // Seconds from start to finish
+    double cpu;         // User plus system CPU seconds of the job and its children
+    long max_rss_kb;    // Peak resident set size in KiB, 0 if unknown
+    double timeout;     // Seconds the job may run, 0 for no limit
+} Job;
+
+// Called for every job that finished, as its k-th of n. The job's status and output are final.
+typedef void (*JobProgress)(const Job *job, int done, int count, void *ctx);
+
+// Called in pmake itself right before the index-th job starts, so the job can still be changed: where
+// it runs is best decided when a slot is free, not when the job is made. Returns nonzero to hold the
+// job back until the next job finished; only allowed while other jobs of the batch are running.
+typedef int (*JobDispatch)(Job *job, int index, void *ctx);
+
+// Called for every job the dispatch hook let start, once it finished or was cancelled, before it is
+// reported.
+typedef void (*JobRelease)(Job *job, int index, void *ctx);
+
+// How the pool runs a batch of jobs, and what it observed while doing so.
+typedef struct {
+    int max_parallel;   // Upper bound of concurrently running jobs (>= 1)
+    int keep_going;     // Nonzero to keep building after a failure
+    int peak_parallel;  // Filled in: the most jobs that actually ran at once
+    JobProgress progress;   // Reports finished jobs instead of printing them, or NULL
+    void *progress_ctx;     // Passed to progress
+    JobDispatch dispatch;   // Places every job right before it starts, or NULL
+    JobRelease release;     // Gets every job dispatch placed once it is done, or NULL
+    void *dispatch_ctx;     // Passed to dispatch and release
+    int catch_signals;      // Nonzero to stop the batch on SIGINT and SIGTERM
+} JobPool;
+
+// --------------------------------------------------------------------------------
+// Return the number of jobs to run at once when the user didn't ask for a specific
+// number: the count of online processors, or 1 if that can't be determined.
+// --------------------------------------------------------------------------------
+int default_job_count(void);
+
+// --------------------------------------------------------------------------------
+// Run all jobs, at most max_parallel at a time, respecting their dependencies.
+// Output of each job is captured and printed together with a "[k/n] label"
+// progress line as soon as the job completes. A failed job additionally prints
+// the command that failed. With pool->progress set, the callback gets the job
+// instead and nothing is printed.
+//
+// Without pool->keep_going, the first failure sends SIGTERM to every running job and
+// no further jobs are started. With pool->catch_signals, an interrupt (Ctrl-C) or
+// SIGTERM sent to pmake itself does the same; the process's own handlers are set
+// aside while the batch runs and put back afterwards. With pool->keep_going, only
+// the jobs that depend on a failed job are skipped.
+//
+// With pool->dispatch set, every job is handed to it right before it starts and
+// to pool->release once it is done.
+//
+// On Windows the jobs run one at a time in array order, so dependencies must
+// point to earlier jobs there.
+//
+// @param jobs   Array of jobs to run; status, output and timing are filled in
+// @param count  Number of jobs in the array
+// @param pool   Settings of the pool; peak_parallel is filled in
+// @return       Number of jobs that failed (skipped and cancelled jobs excluded)
+// --------------------------------------------------------------------------------
+int run_jobs(Job *jobs, int count, JobPool *pool);
+
+// --------------------------------------------------------------------------------
+// Free the strings owned by a job. The Job itself is not freed, so arrays of jobs
+// can be released element by element.
+// --------------------------------------------------------------------------------
+void free_job(Job *job);
+
+#endif
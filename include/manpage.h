@@ -12,6 +12,7 @@
  * ----------------------------------------------------------------------------------------------------
  * Change Log:
  * Sun 2025-06-23 File created.                                                         Version: 00.01
+ * Sun 2026-10-18 create_manpage() takes the Version and only installs the file.        Version: 00.02
  * **************************************************************************************************** */
 #ifndef MANPAGE_H
 #define MANPAGE_H
@@ -35,17 +36,14 @@ typedef struct {
 } ManPage;
 
 /* -----------------------------------------------------------------------------------------------------
- * By encapsulating the creation of manual pages within this method, we ensure a seamless and efficient
- * process for generating documentation. This not only enhances the maintainability and readability of
- * your codebase, but also guarantees that manual pages are consistently formatted and easily accessible.
+ * Install the compiled-in manual as a plain text file in the user's home directory (~/.local/share on
+ * Unix, AppData\Local on Windows). The file starts with a fixed-size version header; it is rewritten
+ * only when that header doesn't match the given version, so an up-to-date copy costs a 16 byte read.
  * 
- * Adopting the create_manpage method will streamline your documentation process, fostering better
- * organization and accessibility, and ultimately contributing to a more polished and user-friendly product.
- * 
- * @param char *filenameIn - The filename to the ManPage text file.
- * @param char *manualIn - The content of the ManPage text.
+ * @param const char *filenameIn - The filename of the ManPage text file, without extension.
+ * @param Version v              - The version of the program the manual describes.
  * ----------------------------------------------------------------------------------------------------- */
-void create_manpage(char *filenameIn, char *manualIn, int major, int minor);
+void create_manpage(const char *filenameIn, Version v);
 
 /* ----------------------------------------------------------------------------------------------------
  * By encapsulating the detection of help command triggers within this method, we ensure a seamless and
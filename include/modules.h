@@ -0,0 +1,87 @@
+/* ****************************************************************************************************
+ * modules.h - C++20 named modules for lang=c++. A unit that imports a module can only be compiled
+ * after the unit that provides it, because the compiler reads the provider's compiled interface (BMI).
+ * So a C++ build starts with a scan phase: every source is asked which module it provides and which
+ * ones it imports, in P1689 format if the compiler can produce it (gcc -fdeps-format=p1689r5 or
+ * clang-scan-deps), otherwise with pmake's own scanner. The answers form a graph, and every compile
+ * job waits for exactly the jobs of the modules it imports — everything else runs in parallel.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created.                                                         Version: 00.01
+ * Sun 2026-10-18 Module interfaces live in the object directory of the plan.           Version: 00.02
+ * Sun 2026-10-18 scan_modules() takes the command log.                                 Version: 00.03
+ * **************************************************************************************************** */
+#ifndef MODULES_H
+#define MODULES_H
+
+#include "parse.h"
+#include "build.h"
+#include "depend.h"
+#include "util.h"
+
+// Compiled module interfaces go to this directory below the object directory, one file per module.
+// gcc finds them through the mapper file in there, clang through -fprebuilt-module-path.
+#define MODULE_SUBDIR   "modules"
+#define MODULE_MAPPER   "mapper.txt"
+
+// The module side of one unit of the plan.
+typedef struct {
+    char *provides;     // Module (or partition) the unit provides, or NULL
+    char *bmi;          // Compiled interface the unit writes, or NULL
+    StrList requires;   // Modules the unit imports
+    int *deps;          // Units that provide them
+    int ndeps;
+} ModuleUnit;
+
+// The module graph of a plan.
+typedef struct {
+    ModuleUnit *units;  // One per unit of the plan, in the same order
+    int *order;         // All unit indices, every provider before its importers
+    int count;
+} ModuleGraph;
+
+// --------------------------------------------------------------------------------
+// Return the flags that point the compiler at the compiled module interfaces:
+// the mapper file for gcc, the prebuilt module path for clang.
+//
+// @param tc      Toolchain of the build
+// @param objdir  Object directory of the build
+// @return        Allocated flags (caller frees)
+// --------------------------------------------------------------------------------
+char *module_flags(const Toolchain *tc, const char *objdir);
+
+// --------------------------------------------------------------------------------
+// Return "-x c++ " for sources gcc wouldn't recognize as C++ by their extension
+// (module interfaces such as .cppm or .ixx), and "" for everything else.
+// --------------------------------------------------------------------------------
+const char *cxx_source_flag(const Toolchain *tc, const char *src);
+
+// --------------------------------------------------------------------------------
+// Scan all units of a C++ plan and build the module graph. The scans run on up to
+// jobs processes (or threads, for the built-in scanner). Afterwards the compile
+// commands of units that provide a module are completed where the compiler needs
+// to be told where the interface goes, and gcc's mapper file is written.
+//
+// A module imported but provided by no source, a module provided twice, and an
+// import cycle are configuration errors.
+//
+// @param plan    Plan of a lang=c++ build; unit commands may be extended
+// @param jobs    Number of scans to run at once
+// @param log     Command log; a .ddi is scanned again when its scan command
+//                changed, and the command of every scan is recorded
+// @param graph   Graph to fill in; release it with free_module_graph()
+// @param errmsg  Set to an allocated message on failure
+// @return        0 on success, -1 on failure
+// --------------------------------------------------------------------------------
+int scan_modules(BuildPlan *plan, int jobs, CommandLog *log, ModuleGraph *graph, char **errmsg);
+
+// --------------------------------------------------------------------------------
+// Free everything owned by a module graph. Safe to call on a zeroed graph.
+// --------------------------------------------------------------------------------
+void free_module_graph(ModuleGraph *graph);
+
+#endif
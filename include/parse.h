@@ -1,8 +1,8 @@
 /* ****************************************************************************************************
  * parse.h - This header defines a minimal interface for parsing build configuration files into
  * structured data. It includes a Makefile struct to store parsed values and functions to normalize
- * filenames, execute builds, and release associated resources. Designed for modular use in small CLI
- * tools.
+ * filenames and release associated resources. Executing the build is declared in build.h. Designed
+ * for modular use in small CLI tools.
  * ----------------------------------------------------------------------------------------------------
  * Author:      Patrik Eigenmann
  * eMail:       p.eigenmann@gmx.net
@@ -10,6 +10,16 @@
  * ----------------------------------------------------------------------------------------------------
  * Change Log:
  * Sun 2025-06-22 File created.                                                         Version: 00.01
+ * Sun 2026-10-18 Moved run() into build.h.                                             Version: 00.02
+ * Sun 2026-10-18 Added the workers field.                                              Version: 00.03
+ * Sun 2026-10-18 Added the lang field.                                                 Version: 00.04
+ * Sun 2026-10-18 Added the debug field.                                                Version: 00.05
+ * Sun 2026-10-18 Added parse_string().                                                 Version: 00.06
+ * Sun 2026-10-18 Added the objdir field.                                               Version: 00.07
+ * Sun 2026-10-18 Added the tests field.                                                Version: 00.08
+ * Sun 2026-10-18 Added the pgo field.                                                  Version: 00.09
+ * Sun 2026-10-18 Added the pkg field.                                                  Version: 00.10
+ * Sun 2026-10-18 Added the gen field.                                                  Version: 00.11
  * **************************************************************************************************** */
 #ifndef PARSE_H
 #define PARSE_H
@@ -26,6 +36,14 @@ typedef struct {
     char *bin;
     char *src;
     char *libs;
+    char *workers;  // Remote compile workers, "host[:port][/slots] ...", or NULL
+    char *lang;     // "c" or "c++"; C++ sources may use named modules
+    char *debug;    // Split DWARF options, "split [dwp] [strip]", or NULL
+    char *objdir;   // Directory for objects and other intermediates, or "tmpfs"
+    char *tests;    // Test sources, each linked into an executable of its own, or NULL
+    char *pgo;      // Training command of pmake --pgo, or NULL
+    char *pkg;      // pkg-config packages whose flags the build uses, "openssl zlib", or NULL
+    char *gen;      // Generator rules, one "outputs: inputs | command" per line, or NULL
 } Makefile;
 
 // --------------------------------------------------------------------------------
@@ -39,16 +57,14 @@ typedef struct {
 Makefile *parse(const char *filename, char **errmsg);
 
 // --------------------------------------------------------------------------------
-// Execute the build process based on the provided Makefile configuration.
-// Translates the struct fields into a compiler command and invokes it.
+// Parse a build configuration held in memory, the way parse() parses a file.
+// Embedders keep configurations around as text without writing them to disk.
 //
-// On failure, errmsg will point to an allocated string describing the issue.
-// Caller is responsible for freeing errmsg if set.
-//
-// @param mf      Parsed build configuration
-// @param errmsg  Output pointer for error messages (set to NULL on success)
+// @param text    Null-terminated configuration text
+// @param errmsg  Pointer to store error message (set to NULL on success)
+// @return        Allocated Makefile* on success, NULL on failure
 // --------------------------------------------------------------------------------
-void run(const Makefile *mf, char **errmsg);
+Makefile *parse_string(const char *text, char **errmsg);
 
 // --------------------------------------------------------------------------------
 // Free all dynamically allocated memory associated with a Makefile struct.
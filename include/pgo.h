@@ -0,0 +1,47 @@
+/* ****************************************************************************************************
+ * pgo.h - pmake --pgo, profile-guided optimization in one command. The project is built a first time
+ * with instrumentation into an object and bin directory of its own, the training command of pgo= runs
+ * the instrumented output, the profiles it leaves are merged, and the project is built a second time,
+ * into the usual directories, with the compiler optimizing along the profile.
+ *
+ * The instrumented build is an ordinary incremental build in its own directory, so it costs nothing
+ * when the sources haven't changed. If the instrumented output is the same as in the last run and so
+ * is the training command, the training is skipped as well and the last profile is used again.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created.                                                         Version: 00.01
+ * **************************************************************************************************** */
+#ifndef PGO_H
+#define PGO_H
+
+#include "parse.h"
+#include "build.h"
+
+// The environment variable that tells the training command where the instrumented output is.
+#define PGO_OUTPUT_ENV "PMAKE_PGO_OUTPUT"
+
+// --------------------------------------------------------------------------------
+// Build the project with profile-guided optimization: the instrumented build into
+// objdir/pgo, the training command of pgo= with PMAKE_PGO_OUTPUT pointing at the
+// instrumented output, the merge of the profiles and the optimized build. gcc
+// needs -fprofile-prefix-path (gcc 11), clang needs llvm-profdata. Both builds
+// compile locally: the profiles are on this machine, not on the workers.
+//
+// With opts->dry_run the commands of the instrumented build and the training
+// command are printed; the optimized build depends on the profile, so it stops
+// there.
+//
+// @param mf      Parsed build configuration with pgo=
+// @param opts    Command line options; the statistics are those of the optimized
+//                build
+// @param errmsg  Set to an allocated message on failure
+// @return        BUILD_OK on success, BUILD_PGO_FAILED if the training failed or
+//                left no profile, otherwise the kind of build failure
+// --------------------------------------------------------------------------------
+BuildResult run_pgo(const Makefile *mf, const BuildOptions *opts, char **errmsg);
+
+#endif
@@ -0,0 +1,38 @@
+/* ****************************************************************************************************
+ * pkg.h - The pkg= directive: compile and link flags of installed libraries, asked from pkg-config.
+ * pkg-config is a separate program that parses a few .pc files on every call, and a project with a
+ * handful of packages pays for that on every build. So the answer is asked once and kept under
+ * ~/.cache/pmake together with the modification time of every .pc file it was read from, the ones of
+ * the packages the listed ones require included. As long as none of them changed, a build reads the
+ * flags from the cache without starting pkg-config at all.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created.                                                         Version: 00.01
+ * **************************************************************************************************** */
+#ifndef PKG_H
+#define PKG_H
+
+// Bump whenever the cache record changes, so older records are asked again.
+#define PKG_FORMAT 1
+
+// --------------------------------------------------------------------------------
+// Resolve the packages of pkg= into flags, from the cache if none of their .pc
+// files changed, otherwise through pkg-config (or $PKG_CONFIG), caching the
+// answer. The cache is keyed on the package list, pkg-config and the variables
+// that change its search path (PKG_CONFIG_PATH, PKG_CONFIG_LIBDIR,
+// PKG_CONFIG_SYSROOT_DIR).
+//
+// @param packages  The pkg directive, package names separated by whitespace
+// @param cflags    Receives the allocated compile flags (pkg-config --cflags)
+// @param libs      Receives the allocated link flags (pkg-config --libs)
+// @param errmsg    Set to an allocated message if pkg-config fails, e.g. for a
+//                  package that isn't installed
+// @return          0 on success, -1 on failure
+// --------------------------------------------------------------------------------
+int resolve_packages(const char *packages, char **cflags, char **libs, char **errmsg);
+
+#endif
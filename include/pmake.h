@@ -0,0 +1,259 @@
+/* ****************************************************************************************************
+ * pmake.h - libpmake, the public C API of pmake. Everything the pmake command does is available to a
+ * program that links the library: load a configuration from a file or from memory, build it, ask
+ * where the outputs go, and follow the build step by step through a callback. A service that builds
+ * often keeps its projects loaded and skips the process start, the help-file check and the parse.
+ *
+ * This is the only header an embedder includes. The types are opaque or plain, the functions are
+ * prefixed pmake_, and strings the library allocates are released with pmake_free_string(), so the
+ * library and its user don't have to share an allocator.
+ *
+ * Builds run in the current working directory, exactly like the command: sources, the object
+ * directory and the bin directory are relative to it. Run one build at a time per process; a project
+ * may be built any number of times.
+ *
+ * The library leaves the process's signal handlers alone unless PmakeOptions.catch_signals is set, as
+ * the pmake command does. Then SIGINT and SIGTERM get a handler of the library while compilers and
+ * tests run, which stops them and fails the build; the previous handlers are back in place before
+ * pmake_build() and the other functions return.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created.                                                         Version: 00.01
+ * Sun 2026-10-18 pmake_get() knows objdir.                                             Version: 00.02
+ * Sun 2026-10-18 pmake_test() with shards and a timeout per test.                      Version: 00.03
+ * Sun 2026-10-18 pmake_pgo(), pmake_get() knows pgo.                                   Version: 00.04
+ * Sun 2026-10-18 pmake_get() knows pkg.                                                Version: 00.05
+ * Sun 2026-10-18 pmake_get() knows gen.                                                Version: 00.06
+ * Sun 2026-10-18 PMAKE_API marks the exported functions.                               Version: 00.07
+ * Sun 2026-10-18 PmakeOptions.catch_signals, signal handlers are opt-in.               Version: 00.08
+ * **************************************************************************************************** */
+#ifndef PMAKE_H
+#define PMAKE_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Marks the functions the shared library exports. libpmake is compiled with -fvisibility=hidden, so
+// its internals (run(), parse(), str_printf() and the rest) can't clash with the embedding program's.
+#if defined(__GNUC__) && !defined(_WIN32)
+    #define PMAKE_API __attribute__((visibility("default")))
+#else
+    #define PMAKE_API
+#endif
+
+// Raised when the API changes in a way that breaks existing callers. New functions, and new fields
+// at the end of PmakeOptions, PmakeStep and PmakeSummary, don't raise it.
+#define PMAKE_API_VERSION 1
+
+// A loaded configuration. Create it with pmake_load() or pmake_load_string().
+typedef struct PmakeProject PmakeProject;
+
+// The outcome of a build, the same values the pmake command exits with.
+typedef enum {
+    PMAKE_OK             = 0,
+    PMAKE_CONFIG_ERROR   = 2,   // The configuration or the options are unusable
+    PMAKE_COMPILE_FAILED = 3,   // At least one translation unit didn't compile
+    PMAKE_LINK_FAILED    = 4,   // Everything compiled, but the link or a debug step failed
+    PMAKE_TEST_FAILED    = 5,   // Everything was built, but a test failed or timed out
+    PMAKE_PGO_FAILED     = 6    // The training run of pmake_pgo() failed or left no profile
+} PmakeResult;
+
+// One finished step of a build: a compile, the link or a debug step, or a test of pmake_test(). The
+// strings belong to the library and are only valid during the callback.
+typedef struct {
+    const char *label;      // What the step works on, e.g. "./src/main.c" or "Linking ./bin/app"
+    const char *command;    // The command line that ran
+    int status;             // Exit code; -1 not run, -2 skipped, -3 cancelled, -4 timed out
+    const char *output;     // Everything the step printed, or NULL
+    size_t output_len;
+    double wall;            // Seconds the step took
+    int done;               // This is the done-th step of total in its batch
+    int total;
+} PmakeStep;
+
+// Called once for every finished step, on the thread that called pmake_build().
+typedef void (*PmakeProgress)(const PmakeStep *step, void *user);
+
+// How a build runs. Start from pmake_default_options() and change what you need.
+typedef struct {
+    int jobs;               // Compiler processes at once; defaults to the number of processors
+    int keep_going;         // Nonzero to build everything that doesn't depend on a failure
+    int dry_run;            // Nonzero to print the commands instead of running them
+    int explain;            // Nonzero to print why each unit is rebuilt
+    int stats;              // Nonzero to print detailed statistics after the build
+    const char *stats_json; // Append build statistics as JSON lines to this file, or NULL
+    PmakeProgress progress; // Gets every finished step; the steps then aren't printed. May be NULL.
+    void *user;             // Passed to progress
+    int shard;              // pmake_test() runs the shard-th of shards parts of the tests, from 1
+    int shards;             // 1 runs every test
+    double test_timeout;    // Seconds a test may run before it is killed, 0 for no limit
+    int catch_signals;      // Nonzero to stop on SIGINT and SIGTERM, see the top of this file
+} PmakeOptions;
+
+// What a build did.
+typedef struct {
+    double wall;            // Seconds for the whole build
+    double cpu;             // CPU seconds of all compiler and linker processes
+    int units;              // Translation units in the project
+    int compiled;           // Units compiled successfully
+    int up_to_date;         // Units whose object was current
+    int failed;             // Units whose compile failed
+    int not_built;          // Units skipped or cancelled after a failure
+    int linked;             // 1 if the output was linked
+    int tests_run;          // Tests pmake_test() ran
+    int tests_passed;
+    int tests_failed;       // Failed or crashed
+    int tests_timed_out;
+} PmakeSummary;
+
+// --------------------------------------------------------------------------------
+// Return PMAKE_API_VERSION of the library that is actually loaded, so a program
+// built against one version can check the shared library it runs with.
+// --------------------------------------------------------------------------------
+PMAKE_API int pmake_api_version(void);
+
+// --------------------------------------------------------------------------------
+// Fill the options with their defaults: one job per processor, stop at the first
+// error, no callback, every test with a timeout of 300 seconds.
+// --------------------------------------------------------------------------------
+PMAKE_API void pmake_default_options(PmakeOptions *opts);
+
+// --------------------------------------------------------------------------------
+// Turn a project name into the name of its configuration file the way the pmake
+// command does: "app" and "app.txt" both become "app.pmake".
+//
+// @param name  Project name or file name
+// @return      Allocated file name; release it with pmake_free_string()
+// --------------------------------------------------------------------------------
+PMAKE_API char *pmake_config_file(const char *name);
+
+// --------------------------------------------------------------------------------
+// Load a configuration file.
+//
+// @param path    Path of the .pmake file
+// @param errmsg  Receives an allocated message on failure (release it with
+//                pmake_free_string()), NULL on success
+// @return        The project, or NULL on failure
+// --------------------------------------------------------------------------------
+PMAKE_API PmakeProject *pmake_load(const char *path, char **errmsg);
+
+// --------------------------------------------------------------------------------
+// Load a configuration from memory, in the same format as a .pmake file.
+//
+// @param text    Null-terminated configuration text
+// @param errmsg  Receives an allocated message on failure, NULL on success
+// @return        The project, or NULL on failure
+// --------------------------------------------------------------------------------
+PMAKE_API PmakeProject *pmake_load_string(const char *text, char **errmsg);
+
+// --------------------------------------------------------------------------------
+// Release a project. NULL is ignored.
+// --------------------------------------------------------------------------------
+PMAKE_API void pmake_free(PmakeProject *project);
+
+// --------------------------------------------------------------------------------
+// Release a string the library allocated. NULL is ignored.
+// --------------------------------------------------------------------------------
+PMAKE_API void pmake_free_string(char *s);
+
+// --------------------------------------------------------------------------------
+// Return the value of a configuration key after defaults were applied: comp,
+// flags, target, project, bin, src, libs, workers, lang, debug, objdir, tests,
+// pgo, pkg or gen. gen holds every rule, one per line.
+//
+// @return  The value, owned by the project, or NULL if the key isn't set
+// --------------------------------------------------------------------------------
+PMAKE_API const char *pmake_get(const PmakeProject *project, const char *key);
+
+// --------------------------------------------------------------------------------
+// Return the i-th file a successful build leaves behind. Index 0 is the output
+// itself (bin/project with the platform's extension); debug=dwp and debug=strip
+// add the package and the debug file.
+//
+// @return  The path, owned by the project, or NULL if i is past the last output
+// --------------------------------------------------------------------------------
+PMAKE_API const char *pmake_output(const PmakeProject *project, int i);
+
+// --------------------------------------------------------------------------------
+// Build the project: compile what is stale and link the output if needed. What
+// the build prints (unless a progress callback takes the steps) goes to stdout
+// and stderr, like the command's output.
+//
+// @param project  Loaded project
+// @param opts     Options, or NULL for the defaults
+// @param summary  Receives what the build did, or NULL
+// @param errmsg   Receives an allocated message on failure, NULL on success
+// @return         PMAKE_OK or the kind of failure
+// --------------------------------------------------------------------------------
+PMAKE_API PmakeResult pmake_build(PmakeProject *project, const PmakeOptions *opts,
+                                  PmakeSummary *summary, char **errmsg);
+
+// --------------------------------------------------------------------------------
+// Build the project and the executables of its tests= directive, then run the
+// tests of the shard, up to opts->jobs at a time. A test passes when it exits
+// with 0. The slowest tests of the previous run start first.
+//
+// @param project  Loaded project
+// @param opts     Options, or NULL for the defaults
+// @param summary  Receives what the build and the tests did, or NULL
+// @param errmsg   Receives an allocated message on failure, NULL on success
+// @return         PMAKE_OK if every test passed, PMAKE_TEST_FAILED if one didn't,
+//                 otherwise the kind of build failure
+// --------------------------------------------------------------------------------
+PMAKE_API PmakeResult pmake_test(PmakeProject *project, const PmakeOptions *opts,
+                                 PmakeSummary *summary, char **errmsg);
+
+// --------------------------------------------------------------------------------
+// Build the project with profile-guided optimization: an instrumented build into
+// objdir/pgo, the training command of pgo= with the environment variable
+// PMAKE_PGO_OUTPUT set to the instrumented output, then the optimized build into
+// bin. The training is skipped while neither the instrumented output nor the
+// command changed.
+//
+// @param project  Loaded project with a pgo= directive
+// @param opts     Options, or NULL for the defaults
+// @param summary  Receives what the optimized build did, or NULL
+// @param errmsg   Receives an allocated message on failure, NULL on success
+// @return         PMAKE_OK, PMAKE_PGO_FAILED if the training failed, otherwise
+//                 the kind of build failure
+// --------------------------------------------------------------------------------
+PMAKE_API PmakeResult pmake_pgo(PmakeProject *project, const PmakeOptions *opts,
+                                PmakeSummary *summary, char **errmsg);
+
+// --------------------------------------------------------------------------------
+// Write the compilation database of the project without compiling anything.
+//
+// @param path    File to write, or NULL for compile_commands.json
+// @param errmsg  Receives an allocated message on failure, NULL on success
+// @return        PMAKE_OK or PMAKE_CONFIG_ERROR
+// --------------------------------------------------------------------------------
+PMAKE_API PmakeResult pmake_write_compdb(PmakeProject *project, const char *path, char **errmsg);
+
+// --------------------------------------------------------------------------------
+// Print what the compiler of the project can do, probed or from the cache.
+//
+// @return  PMAKE_OK, or PMAKE_CONFIG_ERROR if the compiler can't be found
+// --------------------------------------------------------------------------------
+PMAKE_API PmakeResult pmake_print_toolchain(PmakeProject *project);
+
+// --------------------------------------------------------------------------------
+// Print the headers pmake's include scanner finds for every source.
+//
+// @param threads  Number of threads to scan with
+// @param errmsg   Receives an allocated message on failure, NULL on success
+// @return         PMAKE_OK or PMAKE_CONFIG_ERROR
+// --------------------------------------------------------------------------------
+PMAKE_API PmakeResult pmake_print_scanned_deps(PmakeProject *project, int threads, char **errmsg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,134 @@
+/* ****************************************************************************************************
+ * remote.h - Distributed compilation. pmake preprocesses a translation unit locally, ships the result
+ * together with the exact compile flags to a pmake-worker daemon over TCP and gets the object file
+ * back. Preprocessing on the build machine means the workers need a compiler, but none of the project's
+ * headers. Whenever a worker can't be reached or fails, the unit is simply compiled locally.
+ *
+ * The wire format is shared with pmake-worker: every message starts with REMOTE_MAGIC, followed by
+ * fields that are a 32-bit length in network byte order and that many bytes.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created.                                                         Version: 00.01
+ * Sun 2026-10-18 The worker is chosen when a compile starts; worker_went_down().       Version: 00.02
+ * Sun 2026-10-18 An unreachable worker is reported through a pipe, not the output.     Version: 00.03
+ * **************************************************************************************************** */
+#ifndef REMOTE_H
+#define REMOTE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Port pmake-worker listens on when none is given.
+#define WORKER_DEFAULT_PORT "3733"
+
+// Compile jobs one worker gets at a time when the workers directive doesn't say.
+#define WORKER_DEFAULT_SLOTS 4
+
+// First four bytes of every request and reply; the digit is the protocol version.
+#define REMOTE_MAGIC "PMK1"
+
+// Largest field either side accepts. A preprocessed unit is rarely more than a few MiB.
+#define REMOTE_MAX_FIELD (256u * 1024u * 1024u)
+
+// Kinds of reply a worker sends.
+#define REMOTE_COMPILED     0   // The compiler ran; its exit code and output follow
+#define REMOTE_WORKER_ERROR 1   // The worker couldn't run the compiler; compile locally instead
+
+// One entry of the workers directive.
+typedef struct {
+    char *host;
+    char *port;
+    int slots;      // Compile jobs to send to this worker at the same time
+} Worker;
+
+typedef struct {
+    Worker *items;
+    int count;
+} WorkerList;
+
+// Everything a compile job needs to run on a worker, and to run locally if that fails. The strings
+// are borrowed from the build plan and must outlive the job.
+typedef struct {
+    const Worker *worker;
+    const char *comp;       // Compiler
+    const char *flags;      // Compile flags, preprocessor flags included; may be NULL
+    const char *src;
+    const char *obj;
+    const char *dep;
+    const char *local_cmd;  // The regular compile command, used as the fallback
+    int down_pipe[2];       // Tells pmake the worker couldn't be reached, see open_down_report()
+} RemoteCompile;
+
+// --------------------------------------------------------------------------------
+// Parse the workers directive: a whitespace-separated list of host[:port][/slots],
+// for example "build2 build3:4000/8 localhost:3734".
+//
+// @param spec    The raw directive (NULL or empty gives an empty list)
+// @param out     List to fill; release it with free_workers()
+// @param errmsg  Set to an allocated message if an entry is malformed
+// @return        0 on success, -1 on failure
+// --------------------------------------------------------------------------------
+int parse_workers(const char *spec, WorkerList *out, char **errmsg);
+
+// --------------------------------------------------------------------------------
+// Free everything owned by a worker list.
+// --------------------------------------------------------------------------------
+void free_workers(WorkerList *list);
+
+// --------------------------------------------------------------------------------
+// Open the channel a remote compile reports an unreachable worker through: a pipe
+// the forked child writes a byte to before it falls back to a local compile. It
+// stays apart from the job's output, which is the compiler's to fill. Called in
+// pmake right before the job starts.
+//
+// @param rc  The remote compile; down_pipe is set, to -1 if there is no pipe
+// @return    0 on success, -1 if the pipe couldn't be made
+// --------------------------------------------------------------------------------
+int open_down_report(RemoteCompile *rc);
+
+// --------------------------------------------------------------------------------
+// Tell whether the worker of a finished remote compile couldn't be reached at all,
+// as opposed to failing on this one unit, and close the channel. Such a worker is
+// left out for the rest of the build, so the other units don't wait for it again.
+//
+// @param rc  The remote compile, after open_down_report()
+// @return    1 if the worker is down, 0 otherwise
+// --------------------------------------------------------------------------------
+int worker_went_down(RemoteCompile *rc);
+
+// --------------------------------------------------------------------------------
+// Compile one unit on its worker. Meant as the fn of a Job, so it runs in the
+// forked child and whatever it prints ends up in the job's output. The unit is
+// preprocessed locally (writing the depfile as usual), sent to the worker, and
+// the object it returns is written atomically. If the worker can't be reached
+// or can't compile, a note is printed and local_cmd runs instead; an unreachable
+// worker is reported through down_pipe as well.
+//
+// @param arg  Pointer to a RemoteCompile
+// @return     Exit code of the compile
+// --------------------------------------------------------------------------------
+int remote_compile(void *arg);
+
+// --------------------------------------------------------------------------------
+// Write a 32-bit number in network byte order, or a length-prefixed field. Both
+// retry short writes.
+//
+// @return  0 on success, -1 if the connection failed
+// --------------------------------------------------------------------------------
+int wire_write_u32(int fd, uint32_t value);
+int wire_write_field(int fd, const void *data, size_t len);
+
+// --------------------------------------------------------------------------------
+// Read a 32-bit number, or a length-prefixed field into an allocated buffer that
+// is null-terminated for convenience. Fields over REMOTE_MAX_FIELD are refused.
+//
+// @return  0 on success, -1 on a closed connection or malformed data
+// --------------------------------------------------------------------------------
+int wire_read_u32(int fd, uint32_t *value);
+int wire_read_field(int fd, char **data, size_t *len);
+
+#endif
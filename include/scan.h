@@ -0,0 +1,100 @@
+/* ****************************************************************************************************
+ * scan.h - pmake's own #include scanner. It finds the headers a source file pulls in without running
+ * the preprocessor: every file is read once, its #include lines are picked out (skipping comments and
+ * string literals) and resolved against the -I paths from the flags. The result is an approximation —
+ * conditional compilation and computed includes are ignored, and system headers are left out just
+ * like -MMD leaves them out — but it is there before the first compile, and it is fast.
+ *
+ * Every header is parsed once per scan no matter how many files include it, and the sources are spread
+ * over several threads.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created.                                                         Version: 00.01
+ * Sun 2026-10-18 C++ module declarations, scan_module_decls().                         Version: 00.02
+ * Sun 2026-10-18 defines_main() for linking tests with the project's objects.          Version: 00.03
+ * **************************************************************************************************** */
+#ifndef SCAN_H
+#define SCAN_H
+
+#include "parse.h"
+#include "build.h"
+#include "util.h"
+
+// Where included files are looked up, taken from the compile flags. "file.h" is searched next to the
+// including file first, then in quote and then in angle; <file.h> only in angle.
+typedef struct {
+    StrList quote;  // -iquote directories
+    StrList angle;  // -I directories
+} IncludePaths;
+
+// --------------------------------------------------------------------------------
+// Collect the include directories from compile flags: "-I dir", "-Idir" and
+// "-iquote dir". -isystem directories are skipped, their headers don't count as
+// dependencies.
+//
+// @param flags  Compile flags (may be NULL)
+// @param out    Paths to fill in; release them with free_include_paths()
+// --------------------------------------------------------------------------------
+void include_paths_from_flags(const char *flags, IncludePaths *out);
+
+// --------------------------------------------------------------------------------
+// Free the directory lists.
+// --------------------------------------------------------------------------------
+void free_include_paths(IncludePaths *paths);
+
+// --------------------------------------------------------------------------------
+// Find every project header each source includes, directly or through other
+// headers. Headers that can't be found (system headers, mostly) are left out.
+//
+// @param sources  Source files to scan
+// @param count    Number of sources
+// @param paths    Include directories
+// @param threads  Number of threads to scan with (1 scans on the calling thread)
+// @param deps     Array of count lists; deps[i] receives the headers of sources[i]
+// @return         Number of distinct files that were read
+// --------------------------------------------------------------------------------
+int scan_includes(char *const *sources, int count, const IncludePaths *paths, int threads,
+                  StrList *deps);
+
+// --------------------------------------------------------------------------------
+// Find the C++ module declarations of each source: the module its interface or
+// partition provides, and the modules it imports. This is the fallback for
+// compilers that can't write P1689 dependency files; it has the same blind spot
+// for #if as the include scan.
+//
+// @param sources   Source files to scan
+// @param count     Number of sources
+// @param threads   Number of threads to scan with
+// @param provides  Array of count names; provides[i] is set to an allocated name
+//                  or left NULL
+// @param requires  Array of count lists; requires[i] receives the imported modules
+// --------------------------------------------------------------------------------
+void scan_module_decls(char *const *sources, int count, int threads, char **provides,
+                       StrList *requires);
+
+// --------------------------------------------------------------------------------
+// Tell whether a source file defines main() at file scope. Tests are linked with
+// the objects of the project, and the one that holds the project's own main()
+// has to stay out. Like the other scans, #if is not evaluated.
+//
+// @param src  Source file
+// @return     1 if it defines main(), 0 if not or if it can't be read
+// --------------------------------------------------------------------------------
+int defines_main(const char *src);
+
+// --------------------------------------------------------------------------------
+// Scan every source of a configuration and print one "source: headers" line per
+// unit, for pmake --scan-deps. How long the scan took goes to stderr.
+//
+// @param mf       Parsed build configuration
+// @param threads  Number of threads to scan with
+// @param errmsg   Set to an allocated message on failure
+// @return         BUILD_OK on success, BUILD_CONFIG_ERROR otherwise
+// --------------------------------------------------------------------------------
+BuildResult print_scanned_deps(const Makefile *mf, int threads, char **errmsg);
+
+#endif
@@ -0,0 +1,85 @@
+/* ****************************************************************************************************
+ * stats.h - Build statistics. Collects what happened during one build — how long it took, how much
+ * CPU it burned, how many compilers ran at once, which units were compiled or skipped, and what each
+ * compile cost in time and memory — and reports it as a human-readable summary or as JSON lines for
+ * dashboards that track build performance over time.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created.                                                         Version: 00.01
+ * Sun 2026-10-18 Count links skipped because no object's content changed.              Version: 00.02
+ * **************************************************************************************************** */
+#ifndef STATS_H
+#define STATS_H
+
+#include "jobs.h"
+
+// How many of the slowest steps the summary lists.
+#define STATS_SLOWEST 10
+
+// One step that ran during the build: a compile or the link.
+typedef struct {
+    char *label;
+    int status;         // Exit code, or one of the JOB_* values
+    double wall;
+    double cpu;
+    long max_rss_kb;
+} StepStat;
+
+// Everything measured during one build.
+typedef struct {
+    char *project;
+    double wall;        // Seconds for the whole build, planning included
+    double cpu;         // CPU seconds of all compiler and linker processes
+    int max_parallel;   // Jobs allowed at once (-j)
+    int peak_parallel;  // Jobs that actually ran at once
+    int units;          // Translation units in the project
+    int compiled;       // Units compiled successfully
+    int up_to_date;     // Units skipped because their object was current
+    int failed;         // Units whose compile failed
+    int not_built;      // Units skipped or cancelled after a failure
+    int linked;         // 1 if the output was linked, 0 if not needed or failed
+    int link_cutoff;    // 1 if objects were recompiled but came out byte-identical, so no link
+    int result;         // Exit code of the build
+    StepStat *steps;
+    int nsteps;
+} BuildStats;
+
+// --------------------------------------------------------------------------------
+// Copy the timing and outcome of every job that ran into the statistics.
+//
+// @param stats  Statistics to extend
+// @param jobs   Jobs after run_jobs() returned
+// @param count  Number of jobs
+// --------------------------------------------------------------------------------
+void stats_add_jobs(BuildStats *stats, const Job *jobs, int count);
+
+// --------------------------------------------------------------------------------
+// Print the statistics. The short form is a single line; the detailed form adds
+// CPU time, concurrency, the peak memory of the compilers and the slowest steps.
+//
+// @param stats     Statistics of a finished build
+// @param detailed  Nonzero for the full report
+// --------------------------------------------------------------------------------
+void print_stats(const BuildStats *stats, int detailed);
+
+// --------------------------------------------------------------------------------
+// Append the statistics to a file as JSON lines: one "build" record with the
+// totals, followed by one "step" record per compile or link. Appending keeps the
+// history of every build in one file.
+//
+// @param stats  Statistics of a finished build
+// @param path   File to append to
+// @return       0 on success, -1 if the file can't be written
+// --------------------------------------------------------------------------------
+int write_stats_json(const BuildStats *stats, const char *path);
+
+// --------------------------------------------------------------------------------
+// Free everything owned by the statistics.
+// --------------------------------------------------------------------------------
+void free_stats(BuildStats *stats);
+
+#endif
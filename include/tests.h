@@ -0,0 +1,66 @@
+/* ****************************************************************************************************
+ * tests.h - pmake test. The test sources of tests= are built along with the project, each into an
+ * executable of its own, and then run side by side through the job pool. A test passes when it exits
+ * with 0; one that runs past its timeout is killed and fails.
+ *
+ * How long every test took is remembered in the object directory, and the next run starts the
+ * slowest ones first: a long test that happens to start last stretches the whole run, a short one
+ * fills a gap. With a shard, only every n-th test runs, so CI can spread a suite over machines.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created.                                                         Version: 00.01
+ * **************************************************************************************************** */
+#ifndef TESTS_H
+#define TESTS_H
+
+#include "parse.h"
+#include "build.h"
+
+// Seconds a test may run unless the command line says otherwise.
+#define TEST_TIMEOUT 300
+
+// Which tests run and how long they may take.
+typedef struct {
+    int shard;          // Run the shard-th of shards parts of the tests, counted from 1
+    int shards;         // 1 runs every test
+    double timeout;     // Seconds a test may run before it is killed, 0 for no limit
+} TestOptions;
+
+// What a test run did.
+typedef struct {
+    int total;          // Tests in the configuration
+    int run;            // Tests of the shard that ran
+    int passed;
+    int failed;         // Exited with a code other than 0, or crashed
+    int timed_out;
+} TestSummary;
+
+// --------------------------------------------------------------------------------
+// Fill the test options with their defaults: every test, TEST_TIMEOUT seconds.
+// --------------------------------------------------------------------------------
+void default_test_options(TestOptions *tests);
+
+// --------------------------------------------------------------------------------
+// Build the project and its tests like run() with opts->tests, then run the tests
+// of the shard, up to opts->jobs at a time, slowest first. Passing tests print a
+// line each, failing ones their output as well. A failed build runs no tests.
+// With opts->dry_run the commands of the build and the tests are printed, in the
+// order they would run.
+//
+// @param mf       Parsed build configuration
+// @param opts     Command line options for the build; jobs and progress apply to
+//                 the tests as well
+// @param tests    Which tests run and their timeout
+// @param summary  Receives what the tests did, or NULL
+// @param errmsg   Set to an allocated message on failure
+// @return         BUILD_OK if every test passed, BUILD_TEST_FAILED if one didn't,
+//                 otherwise the kind of build failure
+// --------------------------------------------------------------------------------
+BuildResult run_tests(const Makefile *mf, const BuildOptions *opts, const TestOptions *tests,
+                      TestSummary *summary, char **errmsg);
+
+#endif
@@ -0,0 +1,82 @@
+/* ****************************************************************************************************
+ * toolchain.h - What the configured compiler can do. Finding out means running the compiler a few
+ * times — for its version, for depfile support, split DWARF, alternative linkers — which costs more
+ * than the rest of pmake's startup together. So the answers are probed once per compiler binary and
+ * kept in a small record under ~/.cache/pmake, keyed by the binary's path, size and modification
+ * time. Installing a new compiler changes the key, and the next build probes again.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created.                                                         Version: 00.01
+ * Sun 2026-10-18 Record how to scan C++ module dependencies (P1689).                   Version: 00.02
+ * Sun 2026-10-18 Record the gdb-index linker and the split DWARF tools.                Version: 00.03
+ * Sun 2026-10-18 Record what profile-guided optimization needs.                        Version: 00.04
+ * Sun 2026-10-18 Format 5: the compiler family is probed from the predefined macros.   Version: 00.05
+ * **************************************************************************************************** */
+#ifndef TOOLCHAIN_H
+#define TOOLCHAIN_H
+
+#include "util.h"
+
+// Bump whenever the record gains a field or a probe changes, so older cache files are re-probed.
+#define TOOLCHAIN_FORMAT 5
+
+// The compiler family, told apart by the macros it predefines (__clang__, __GNUC__).
+typedef enum {
+    TOOLCHAIN_UNKNOWN = 0,
+    TOOLCHAIN_GCC,
+    TOOLCHAIN_CLANG
+} ToolchainKind;
+
+// The capability record of one compiler. Fields that a probe couldn't confirm are 0 or NULL.
+typedef struct {
+    char *comp;             // The comp directive the record belongs to
+    char *path;             // Resolved path of the compiler binary, NULL if not found
+    long long size;         // Size of the binary, part of the cache key
+    long long mtime;        // Modification time of the binary, part of the cache key
+    ToolchainKind kind;
+    char *version;          // First line of "comp --version"
+    int depfiles;           // Understands -MMD -MF
+    int split_dwarf;        // Understands -gsplit-dwarf
+    StrList linkers;        // Values of -fuse-ld= that link a program
+    char *gdb_index_ld;     // Fastest of them that understands --gdb-index, or NULL
+    char *dwp;              // DWARF packager (dwp, llvm-dwp) that goes with the compiler, or NULL
+    char *objcopy;          // objcopy that goes with the compiler, or NULL
+    char *pch_ext;          // Extension of precompiled headers (".gch", ".pch"), or NULL
+    int p1689;              // Writes P1689 module dependencies itself (gcc -fdeps-format=p1689r5)
+    char *scan_deps;        // clang-scan-deps that goes with a clang, or NULL
+    int profile_prefix;     // Understands -fprofile-prefix-path (gcc 11)
+    char *profdata;         // llvm-profdata that goes with a clang, or NULL
+    int from_cache;         // The record was read from the cache, not probed
+} Toolchain;
+
+// --------------------------------------------------------------------------------
+// Fill in the capability record of a compiler, from the cache if it holds a
+// record for this exact binary, otherwise by probing it and caching the result.
+// A compiler that can't be found gives a record with path set to NULL; the
+// capabilities then default to what every gcc and clang supports.
+//
+// @param comp  The comp directive, e.g. "gcc" or "/opt/llvm/bin/clang"
+// @param tc    Record to fill in; release it with free_toolchain()
+// --------------------------------------------------------------------------------
+void probe_toolchain(const char *comp, Toolchain *tc);
+
+// --------------------------------------------------------------------------------
+// Free everything owned by a capability record.
+// --------------------------------------------------------------------------------
+void free_toolchain(Toolchain *tc);
+
+// --------------------------------------------------------------------------------
+// Tell whether -fuse-ld=<name> works with this compiler.
+// --------------------------------------------------------------------------------
+int toolchain_has_linker(const Toolchain *tc, const char *name);
+
+// --------------------------------------------------------------------------------
+// Print the record in a human-readable form, for pmake --toolchain.
+// --------------------------------------------------------------------------------
+void print_toolchain(const Toolchain *tc);
+
+#endif
@@ -0,0 +1,174 @@
+/* ****************************************************************************************************
+ * util.h - Small string and filesystem helpers shared by the build modules. Provides a growable string
+ * buffer for assembling compiler commands of any length, a simple owning string list, and a portable
+ * "mkdir -p". Nothing here knows about `.pmake` files — these are the plain tools the rest leans on.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created.                                                         Version: 00.01
+ * Sun 2026-10-18 Added sb_json_string() and write_file_atomic().                       Version: 00.02
+ * Sun 2026-10-18 Added file_mtime() and hash_bytes().                                  Version: 00.03
+ * Sun 2026-10-18 Added now_seconds().                                                  Version: 00.04
+ * Sun 2026-10-18 Added read_file().                                                    Version: 00.05
+ * Sun 2026-10-18 Added hash_file().                                                    Version: 00.06
+ * Sun 2026-10-18 Added replace_file().                                                 Version: 00.07
+ * Sun 2026-10-18 Added cache_dir(), formerly private to the toolchain probe.           Version: 00.08
+ * **************************************************************************************************** */
+#ifndef UTIL_H
+#define UTIL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// A growable, always null-terminated string. Start with StrBuf sb = {0}; and release the memory
+// with sb_free(). The data pointer can be handed over to the caller instead of being freed.
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} StrBuf;
+
+// An owning list of heap-allocated strings. Start with StrList l = {0}; and release everything
+// with strlist_free().
+typedef struct {
+    char **items;
+    int count;
+    int cap;
+} StrList;
+
+// --------------------------------------------------------------------------------
+// Allocate a new string from a printf-style format. Returns NULL on allocation
+// failure. The caller frees the result.
+// --------------------------------------------------------------------------------
+char *str_printf(const char *fmt, ...);
+
+// --------------------------------------------------------------------------------
+// Append printf-style formatted text to the buffer, growing it as needed. The
+// buffer grows geometrically, so appending in a loop stays linear.
+// --------------------------------------------------------------------------------
+void sb_printf(StrBuf *sb, const char *fmt, ...);
+
+// --------------------------------------------------------------------------------
+// Append raw bytes to the buffer. Unlike sb_printf(), the data may contain any
+// bytes, which makes it suitable for captured process output.
+// --------------------------------------------------------------------------------
+void sb_append(StrBuf *sb, const char *data, size_t len);
+
+// --------------------------------------------------------------------------------
+// Append a string as a quoted JSON string literal, escaping quotes, backslashes
+// and control characters.
+// --------------------------------------------------------------------------------
+void sb_json_string(StrBuf *sb, const char *s);
+
+// --------------------------------------------------------------------------------
+// Release the buffer's memory and reset it to the empty state.
+// --------------------------------------------------------------------------------
+void sb_free(StrBuf *sb);
+
+// --------------------------------------------------------------------------------
+// Append a string to the list. The list takes ownership of the pointer.
+// --------------------------------------------------------------------------------
+void strlist_push(StrList *l, char *s);
+
+// --------------------------------------------------------------------------------
+// Free every string in the list, then the list storage itself.
+// --------------------------------------------------------------------------------
+void strlist_free(StrList *l);
+
+// --------------------------------------------------------------------------------
+// Split a whitespace-separated string into words and append copies to the list.
+// A NULL input adds nothing.
+//
+// @param s    String to split (may be NULL)
+// @param out  List that receives the words
+// @return     Number of words appended
+// --------------------------------------------------------------------------------
+int split_words(const char *s, StrList *out);
+
+// --------------------------------------------------------------------------------
+// Create a directory and all missing parents, like "mkdir -p".
+//
+// @param path  Directory path to create
+// @return      0 on success (or if it already exists), -1 on failure
+// --------------------------------------------------------------------------------
+int make_dirs(const char *path);
+
+// --------------------------------------------------------------------------------
+// Create all missing parent directories of a file path, so the file can be written.
+//
+// @param file  Path of a file that is about to be created
+// @return      0 on success, -1 on failure
+// --------------------------------------------------------------------------------
+int make_parent_dirs(const char *file);
+
+// --------------------------------------------------------------------------------
+// Write data to a file so that readers only ever see the old or the complete new
+// content: the data goes to a temporary file next to the target, which is then
+// renamed over it.
+//
+// @param path  File to write
+// @param data  Bytes to write
+// @param len   Number of bytes
+// @return      0 on success, -1 on failure
+// --------------------------------------------------------------------------------
+int write_file_atomic(const char *path, const char *data, size_t len);
+
+// --------------------------------------------------------------------------------
+// Move a file over another one in a single step, so the target is always either
+// the old or the new file. Both must be on the same filesystem.
+//
+// @param from  File to move
+// @param to    File to replace (it may not exist yet)
+// @return      0 on success, -1 on failure
+// --------------------------------------------------------------------------------
+int replace_file(const char *from, const char *to);
+
+// --------------------------------------------------------------------------------
+// Read a whole file into a null-terminated heap buffer, so text can be parsed in
+// place; binary files work as well since the length is returned separately.
+//
+// @param path     File to read
+// @param len_out  Receives the number of bytes read (may be NULL)
+// @return         Allocated buffer (caller frees), or NULL if the file can't be read
+// --------------------------------------------------------------------------------
+char *read_file(const char *path, size_t *len_out);
+
+// --------------------------------------------------------------------------------
+// Return the modification time of a file in nanoseconds since the epoch, with the
+// best precision the platform offers. Returns -1 if the file doesn't exist.
+// --------------------------------------------------------------------------------
+long long file_mtime(const char *path);
+
+// --------------------------------------------------------------------------------
+// Hash a block of bytes with 64-bit FNV-1a. Fast, stable across platforms and
+// runs, and good enough to notice that a command or a file changed. Pass the
+// previous result as seed to hash data in pieces, or HASH_SEED to start.
+// --------------------------------------------------------------------------------
+#define HASH_SEED 14695981039346656037ULL
+uint64_t hash_bytes(const void *data, size_t len, uint64_t seed);
+
+// --------------------------------------------------------------------------------
+// Hash the content of a file with hash_bytes(), reading it in pieces.
+//
+// @return  The hash, or 0 if the file can't be read
+// --------------------------------------------------------------------------------
+uint64_t hash_file(const char *path);
+
+// --------------------------------------------------------------------------------
+// Return a monotonic timestamp in seconds. Only differences between two calls
+// are meaningful; the clock doesn't jump when the system time is changed.
+// --------------------------------------------------------------------------------
+double now_seconds(void);
+
+// --------------------------------------------------------------------------------
+// Return the directory pmake keeps its caches in: $XDG_CACHE_HOME/pmake or
+// ~/.cache/pmake, and %LOCALAPPDATA%\pmake on Windows.
+//
+// @return  Allocated path (caller frees), or NULL if there is no home directory
+// --------------------------------------------------------------------------------
+char *cache_dir(void);
+
+#endif
@@ -4,9 +4,10 @@ set -e
 
 echo "Building pmake..."
 mkdir -p bin
-gcc -Wall -Wextra -std=c99 -Iinclude src/*.c -o bin/pmake
+gcc -Wall -Wextra -std=c99 -Iinclude src/*.c -pthread -o bin/pmake
+gcc -Wall -Wextra -std=c99 -Iinclude worker/pmake-worker.c src/remote.c src/util.c -o bin/pmake-worker
 
-echo "Installing to /usr/local/bin/pmake (requires sudo)..."
-sudo cp bin/pmake /usr/local/bin/
+echo "Installing to /usr/local/bin/pmake and pmake-worker (requires sudo)..."
+sudo cp bin/pmake bin/pmake-worker /usr/local/bin/
 
 echo "Done. Type 'pmake' to begin."
\ No newline at end of file
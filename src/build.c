@@ -0,0 +1,1319 @@
+/* ****************************************************************************************************
+ * build.c — Build driver. Expands the `src` directive into single translation units, compiles each of
+ * them into an object file below the object directory, and links the objects together with the
+ * libraries into the output named by `bin` and `project`. The compiler processes run concurrently
+ * through the job pool in jobs.c, which also keeps their diagnostics readable.
+ *
+ * This used to be one combined compiler command assembled in parse.c. Splitting the build into units
+ * is what makes parallel compilation possible in the first place.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created, run() moved here from parse.c.                          Version: 00.01
+ * Sun 2026-10-18 Link is a job depending on all units; keep-going and fail-fast.       Version: 00.02
+ * Sun 2026-10-18 Split planning from execution with plan_build().                      Version: 00.03
+ * Sun 2026-10-18 Incremental builds, --dry-run and --explain.                          Version: 00.04
+ * Sun 2026-10-18 Build statistics after every build, --stats and --stats-json.         Version: 00.05
+ * Sun 2026-10-18 Units are compiled on remote workers when workers= is set.            Version: 00.06
+ * Sun 2026-10-18 Commands adapt to the probed toolchain; missing compiler is an error. Version: 00.07
+ * Sun 2026-10-18 Units without a depfile are checked against scanned headers.          Version: 00.08
+ * Sun 2026-10-18 lang=c++: module scan, compiles ordered by the module graph.          Version: 00.09
+ * Sun 2026-10-18 Link decided after the compiles, skipped if no object changed.        Version: 00.10
+ * Sun 2026-10-18 debug=split: split DWARF, gdb index, dwp and strip after the link.    Version: 00.11
+ * Sun 2026-10-18 build_outputs(), progress callback and statistics for libpmake.       Version: 00.12
+ * Sun 2026-10-18 objdir directive, links to a temporary name renamed over the output.  Version: 00.13
+ * Sun 2026-10-18 tests= built with the project, outputs and tests linked side by side. Version: 00.14
+ * Sun 2026-10-18 Compile and link with the pkg-config flags of pkg=.                   Version: 00.15
+ * Sun 2026-10-18 gen= rules run side by side before the compiles, skipped if current.  Version: 00.16
+ * Sun 2026-10-18 Workers are picked as compiles start, unreachable ones dropped.       Version: 00.17
+ * Sun 2026-10-18 Keep-going links every output that needs no failed unit.              Version: 00.18
+ * Sun 2026-10-18 objdir=tmpfs only uses a private directory of the user.               Version: 00.19
+ * Sun 2026-10-18 Library files in libs= are link inputs, a changed one relinks.       Version: 00.20
+ * Sun 2026-10-18 Links leave out -c, -S and -E from the flags.                         Version: 00.21
+ * Sun 2026-10-18 A down worker is told by its compile's pipe, not by its output.       Version: 00.22
+ * **************************************************************************************************** */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "build.h"
+#include "jobs.h"
+#include "depend.h"
+#include "stats.h"
+#include "remote.h"
+#include "scan.h"
+#include "modules.h"
+#include "pkg.h"
+#include "gen.h"
+#include "util.h"
+#include "debug.h"
+
+#ifndef _WIN32
+    #include <glob.h>
+    #include <errno.h>
+    #include <unistd.h>
+    #include <sys/stat.h>
+#endif
+
+// Where objdir=tmpfs goes when there is no /dev/shm: the default object directory, the same place
+// the repository's own Makefile uses.
+#define OBJ_DIR "./build"
+
+// The tmpfs objdir=tmpfs puts the objects on. The directory in there is named after the project.
+#define TMPFS_DIR "/dev/shm"
+
+// The command log in the object directory remembers how every object was built.
+#define COMMAND_LOG ".pmake_log"
+
+void default_build_options(BuildOptions *opts) {
+    memset(opts, 0, sizeof(*opts));
+    opts->jobs = default_job_count();
+}
+
+// --------------------------------------------------------------------------------
+// Tell whether the target asks for a shared library. The help text has always
+// called it "shared", while the code checked for "lib" — both are accepted.
+// --------------------------------------------------------------------------------
+static int is_shared(const char *target) {
+    return strcmp(target, "lib") == 0 || strcmp(target, "shared") == 0;
+}
+
+// --------------------------------------------------------------------------------
+// Expand the `src` directive into a list of source files. Each whitespace-separated
+// word is matched with glob(), so "./src/*.c" turns into every C file in the
+// directory. Words without wildcards are taken as they are.
+//
+// @param src     The raw `src` directive
+// @param out     List that receives the source files
+// @param errmsg  Set to an allocated message if a pattern matches nothing
+// @return        0 on success, -1 on failure
+// --------------------------------------------------------------------------------
+static int expand_sources(const char *src, StrList *out, char **errmsg) {
+    StrList words = {0};
+    split_words(src, &words);
+
+    for (int i = 0; i < words.count; i++) {
+        const char *w = words.items[i];
+
+#ifndef _WIN32
+        if (strpbrk(w, "*?[")) {
+            glob_t g;
+            int rc = glob(w, 0, NULL, &g);
+            if (rc != 0) {
+                *errmsg = str_printf("No source files match: %s", w);
+                globfree(&g);
+                strlist_free(&words);
+                return -1;
+            }
+            for (size_t k = 0; k < g.gl_pathc; k++) strlist_push(out, strdup(g.gl_pathv[k]));
+            globfree(&g);
+            continue;
+        }
+#endif
+        strlist_push(out, strdup(w));
+    }
+
+    strlist_free(&words);
+
+    if (out->count == 0) {
+        *errmsg = strdup("No source files to compile.");
+        return -1;
+    }
+    return 0;
+}
+
+// The tmpfs directory is named after the project and the working directory, so two
+// checkouts of one project don't share their objects. The name is predictable and
+// /dev/shm is writable for everyone, so the directory is only used if it is ours:
+// created private, or found as a real directory of this user that no one else can
+// write to. Otherwise another user could have put it there and swap objects in
+// before the link.
+char *object_dir(const Makefile *mf) {
+    if (strcmp(mf->objdir, "tmpfs") != 0) {
+        size_t len = strlen(mf->objdir);
+        while (len > 1 && mf->objdir[len - 1] == '/') len--;
+        return str_printf("%.*s", (int)len, mf->objdir);
+    }
+
+#ifndef _WIN32
+    struct stat st;
+    char cwd[4096];
+    if (stat(TMPFS_DIR, &st) == 0 && S_ISDIR(st.st_mode) && getcwd(cwd, sizeof(cwd))) {
+        uint64_t key = hash_bytes(cwd, strlen(cwd), HASH_SEED);
+        char *dir = str_printf(TMPFS_DIR "/pmake-%s-%08x", mf->project, (unsigned)(key & 0xffffffffu));
+        int made = mkdir(dir, 0700) == 0 || errno == EEXIST;
+        if (made && lstat(dir, &st) == 0 && S_ISDIR(st.st_mode) && st.st_uid == getuid()
+            && (st.st_mode & (S_IWGRP | S_IWOTH)) == 0) {
+            return dir;
+        }
+        fprintf(stderr, "Warning: %s is not a private directory of yours, using %s for objdir=tmpfs.\n",
+                dir, OBJ_DIR);
+        free(dir);
+    }
+#endif
+    return strdup(OBJ_DIR);
+}
+
+// --------------------------------------------------------------------------------
+// Return the temporary name the output is linked to: a hidden file next to it,
+// "./bin/app" becomes "./bin/.app.tmp". Being in the same directory is what lets
+// it be renamed over the output. The name is fixed, so the link command stays the
+// same from build to build.
+// --------------------------------------------------------------------------------
+static char *temp_output_path(const char *output) {
+    const char *slash = strrchr(output, '/');
+    int dir = slash ? (int)(slash + 1 - output) : 0;
+    return str_printf("%.*s.%s.tmp", dir, output, output + dir);
+}
+
+// --------------------------------------------------------------------------------
+// Map a source file to a file below the object directory. Leading "./" is
+// dropped, ".." components become "__" so nothing escapes the directory, and the
+// extension is replaced. "./src/parse.c" with ".o" becomes "./build/src/parse.o".
+//
+// @param objdir  The object directory
+// @param src     Path of the source file
+// @param ext     Extension of the derived file, including the dot
+// @return        Allocated object file path (caller frees)
+// --------------------------------------------------------------------------------
+static char *object_path(const char *objdir, const char *src, const char *ext) {
+    StrBuf sb = {0};
+    sb_printf(&sb, "%s/", objdir);
+
+    const char *p = src;
+    while (*p == '/' || (p[0] == '.' && p[1] == '/')) p += (*p == '/') ? 1 : 2;
+
+    const char *dot = strrchr(p, '.');
+    const char *slash = strrchr(p, '/');
+    const char *end = (dot && (!slash || dot > slash)) ? dot : p + strlen(p);
+
+    while (p < end) {
+        if (p[0] == '.' && p[1] == '.' && (p[2] == '/' || p + 2 == end)) {
+            sb_printf(&sb, "__");
+            p += 2;
+            continue;
+        }
+        sb_append(&sb, p, 1);
+        p++;
+    }
+
+    sb_printf(&sb, "%s", ext);
+    return sb.data;
+}
+
+// --------------------------------------------------------------------------------
+// Build the path of the final output from bin, project and the target type. The
+// extension follows the platform: .so/.dll for shared libraries, .o/.obj for
+// object targets, and .exe for Windows executables.
+//
+// @param mf  Parsed build configuration
+// @return    Allocated output path (caller frees)
+// --------------------------------------------------------------------------------
+static char *output_path(const Makefile *mf) {
+    const char *ext = "";
+#ifdef _WIN32
+    if (is_shared(mf->target))                  ext = ".dll";
+    else if (strcmp(mf->target, "obj") == 0)    ext = ".obj";
+    else                                        ext = ".exe";
+#else
+    if (is_shared(mf->target))                  ext = ".so";
+    else if (strcmp(mf->target, "obj") == 0)    ext = ".o";
+#endif
+    return str_printf("%s/%s%s", mf->bin, mf->project, ext);
+}
+
+// --------------------------------------------------------------------------------
+// Tell whether a whitespace-separated list contains a word, or with prefix set,
+// a word that starts with it.
+// --------------------------------------------------------------------------------
+static int has_word(const char *list, const char *word, int prefix) {
+    StrList words = {0};
+    split_words(list ? list : "", &words);
+
+    int found = 0;
+    size_t len = strlen(word);
+    for (int i = 0; i < words.count && !found; i++) {
+        found = prefix ? strncmp(words.items[i], word, len) == 0 : strcmp(words.items[i], word) == 0;
+    }
+    strlist_free(&words);
+    return found;
+}
+
+// --------------------------------------------------------------------------------
+// Collect the flags every translation unit is compiled with: the configured flags
+// plus -fPIC, which is only requested for shared libraries on Unix. C++ builds get
+// -std=c++20 unless the flags pick a standard, and gcc needs -fmodules-ts.
+// debug=split adds -gsplit-dwarf, and -g unless the flags pick a debug level.
+//
+// @return  Allocated flags (caller frees), or NULL if there are none
+// --------------------------------------------------------------------------------
+static char *unit_flags(const Makefile *mf, const BuildPlan *plan) {
+    StrBuf sb = {0};
+    const char *flags = mf->flags ? mf->flags : "";
+    if (flags[0]) sb_printf(&sb, "%s", flags);
+    if (plan->pkg_cflags && plan->pkg_cflags[0]) sb_printf(&sb, "%s%s", sb.len ? " " : "", plan->pkg_cflags);
+    if (plan->cxx && !strstr(flags, "-std=")) sb_printf(&sb, "%s-std=c++20", sb.len ? " " : "");
+    if (plan->cxx && plan->tc.kind != TOOLCHAIN_CLANG && !strstr(flags, "-fmodules-ts")) {
+        sb_printf(&sb, "%s-fmodules-ts", sb.len ? " " : "");
+    }
+#ifndef _WIN32
+    if (is_shared(mf->target)) sb_printf(&sb, "%s-fPIC", sb.len ? " " : "");
+#endif
+    if (plan->split_dwarf) {
+        if (!has_word(flags, "-g", 1)) sb_printf(&sb, "%s-g", sb.len ? " " : "");
+        sb_printf(&sb, "%s-gsplit-dwarf", sb.len ? " " : "");
+    }
+    return sb.data;
+}
+
+// --------------------------------------------------------------------------------
+// Assemble the compiler command for one translation unit:
+//     comp flags [-fPIC] [module flags] [-MMD -MF depfile] -c [-x c++] source -o object
+// The depfile lists the headers the unit includes, so a changed header rebuilds
+// exactly the units that use it. A compiler without depfile support leaves the
+// unit without one, and the include scanner stands in for it.
+// --------------------------------------------------------------------------------
+static char *compile_command(const BuildPlan *plan, const Makefile *mf, const char *src, const char *obj,
+                             const char *dep) {
+    StrBuf sb = {0};
+    sb_printf(&sb, "%s ", mf->comp);
+    if (plan->flags) sb_printf(&sb, "%s ", plan->flags);
+    if (plan->module_flags) sb_printf(&sb, "%s ", plan->module_flags);
+    if (plan->tc.depfiles) sb_printf(&sb, "-MMD -MF %s ", dep);
+    sb_printf(&sb, "-c %s%s -o %s", plan->cxx ? cxx_source_flag(&plan->tc, src) : "", src, obj);
+    return sb.data;
+}
+
+// --------------------------------------------------------------------------------
+// Append the configured flags to a link command, without -c, -S and -E. Those stop
+// the compiler before it links, and obj configurations used to need -c in flags=
+// when they were compiled with one combined command.
+// --------------------------------------------------------------------------------
+static void append_link_flags(StrBuf *sb, const char *flags) {
+    StrList words = {0};
+    split_words(flags ? flags : "", &words);
+    for (int i = 0; i < words.count; i++) {
+        const char *w = words.items[i];
+        if (strcmp(w, "-c") != 0 && strcmp(w, "-S") != 0 && strcmp(w, "-E") != 0) sb_printf(sb, "%s ", w);
+    }
+    strlist_free(&words);
+}
+
+// --------------------------------------------------------------------------------
+// Assemble the command that combines all objects into the output:
+//     comp flags [-shared | -r] [-fuse-ld=ld -Wl,--gdb-index] objects libs -o output
+// An "obj" target is a relocatable object that bundles all units (-r). With split
+// DWARF, a linker that can build the gdb index does so, so the debugger doesn't
+// have to index every .dwo file at startup. A linker picked in the flags is kept.
+// target is the configured one for the output, "exec" for a test.
+// --------------------------------------------------------------------------------
+static char *link_command(const BuildPlan *plan, const Makefile *mf, const char *target, const StrList *objs,
+                          const char *out) {
+    StrBuf sb = {0};
+    sb_printf(&sb, "%s ", mf->comp);
+    append_link_flags(&sb, mf->flags);
+
+    if (is_shared(target))                  sb_printf(&sb, "-shared ");
+    else if (strcmp(target, "obj") == 0)    sb_printf(&sb, "-r ");
+
+    const char *ld = plan->tc.gdb_index_ld;
+    if (plan->split_dwarf && ld && strcmp(target, "obj") != 0) {
+        char *choice = str_printf("-fuse-ld=%s", ld);
+        if (!has_word(mf->flags, "-fuse-ld=", 1)) sb_printf(&sb, "%s -Wl,--gdb-index ", choice);
+        else if (has_word(mf->flags, choice, 0))  sb_printf(&sb, "-Wl,--gdb-index ");
+        free(choice);
+    }
+
+    for (int i = 0; i < objs->count; i++) sb_printf(&sb, "%s ", objs->items[i]);
+    if (mf->libs && mf->libs[0]) sb_printf(&sb, "%s ", mf->libs);
+    if (plan->pkg_libs && plan->pkg_libs[0]) sb_printf(&sb, "%s ", plan->pkg_libs);
+
+    sb_printf(&sb, "-o %s", out);
+    return sb.data;
+}
+
+// --------------------------------------------------------------------------------
+// Add the files named in libs= to the inputs of a link: static libraries and
+// objects given by path. A changed library has to relink the output just like a
+// changed object; -l and the other flags are left to the linker.
+// --------------------------------------------------------------------------------
+static void add_library_files(const Makefile *mf, StrList *inputs) {
+    StrList words = {0};
+    split_words(mf->libs ? mf->libs : "", &words);
+    for (int i = 0; i < words.count; i++) {
+        if (words.items[i][0] != '-' && file_mtime(words.items[i]) >= 0) {
+            strlist_push(inputs, strdup(words.items[i]));
+        }
+    }
+    strlist_free(&words);
+}
+
+// --------------------------------------------------------------------------------
+// Work out the debug steps for the output from the debug directive: dwp packs
+// the .dwo files into output.dwp, strip moves the debug info into output.debug
+// and leaves a debug link behind. Both need their tool, found by the toolchain
+// probe. A relocatable "obj" output isn't final, so it gets neither.
+//
+// @return  0 on success, -1 if a tool is missing
+// --------------------------------------------------------------------------------
+static int plan_debug_steps(const Makefile *mf, BuildPlan *plan, char **errmsg) {
+    if (!plan->tc.path || strcmp(mf->target, "obj") == 0) return 0;
+
+    if (plan->split_dwarf && !plan->tc.split_dwarf) {
+        *errmsg = str_printf("debug=split: %s doesn't support -gsplit-dwarf.", mf->comp);
+        return -1;
+    }
+    if (has_word(mf->debug, "dwp", 0)) {
+        if (!plan->tc.dwp) {
+            *errmsg = strdup("debug=dwp: neither dwp nor llvm-dwp was found.");
+            return -1;
+        }
+        plan->debug.dwp_cmd = str_printf("%s -e %s -o %s.dwp", plan->tc.dwp, plan->link_output, plan->output);
+        for (int i = 0; i < plan->count; i++) {
+            strlist_push(&plan->debug.dwo, object_path(plan->objdir, plan->units[i].src, ".dwo"));
+        }
+    }
+    if (has_word(mf->debug, "strip", 0)) {
+        if (!plan->tc.objcopy) {
+            *errmsg = strdup("debug=strip: objcopy was not found.");
+            return -1;
+        }
+        plan->debug.keep_cmd = str_printf("%s --only-keep-debug %s %s.debug", plan->tc.objcopy,
+                                          plan->link_output, plan->output);
+        plan->debug.strip_cmd = str_printf("%s --strip-debug --add-gnu-debuglink=%s.debug %s",
+                                           plan->tc.objcopy, plan->output, plan->link_output);
+    }
+    return 0;
+}
+
+int plan_build(const Makefile *mf, BuildPlan *plan, char **errmsg) {
+    StrList srcs = {0};
+    memset(plan, 0, sizeof(*plan));
+
+    if (expand_sources(mf->src, &srcs, errmsg) != 0) {
+        strlist_free(&srcs);
+        return -1;
+    }
+
+    if (mf->gen && parse_gen_rules(mf->gen, &plan->gens, &plan->ngens, errmsg) != 0) {
+        strlist_free(&srcs);
+        return -1;
+    }
+
+    // Generated sources are compiled like the others, unless src= lists them already.
+    for (int i = 0; i < plan->ngens; i++) {
+        const StrList *outputs = &plan->gens[i].outputs;
+        for (int o = 0; o < outputs->count; o++) {
+            int listed = !is_generated_source(outputs->items[o]);
+            for (int k = 0; k < srcs.count && !listed; k++) listed = strcmp(srcs.items[k], outputs->items[o]) == 0;
+            if (!listed) strlist_push(&srcs, strdup(outputs->items[o]));
+        }
+    }
+
+    probe_toolchain(mf->comp, &plan->tc);
+    if (mf->pkg && resolve_packages(mf->pkg, &plan->pkg_cflags, &plan->pkg_libs, errmsg) != 0) {
+        strlist_free(&srcs);
+        return -1;
+    }
+    plan->cxx = mf->lang && strcmp(mf->lang, "c++") == 0;
+    plan->split_dwarf = has_word(mf->debug, "split", 0);
+    plan->objdir = object_dir(mf);
+    plan->flags = unit_flags(mf, plan);
+    if (plan->cxx) plan->module_flags = module_flags(&plan->tc, plan->objdir);
+    plan->units = calloc((size_t)srcs.count, sizeof(Unit));
+    if (!plan->units) {
+        *errmsg = strdup("Memory allocation failed for the build plan.");
+        strlist_free(&srcs);
+        return -1;
+    }
+
+    // The unit takes over the source string, so the list only frees its storage.
+    for (int i = 0; i < srcs.count; i++) {
+        Unit *u = &plan->units[plan->count++];
+        u->src = srcs.items[i];
+        u->obj = object_path(plan->objdir, u->src, ".o");
+        u->dep = object_path(plan->objdir, u->src, ".d");
+        u->cmd = compile_command(plan, mf, u->src, u->obj, u->dep);
+        strlist_push(&plan->inputs, strdup(u->obj));
+    }
+    free(srcs.items);
+
+    plan->output = output_path(mf);
+    plan->link_output = temp_output_path(plan->output);
+    plan->link_cmd = link_command(plan, mf, mf->target, &plan->inputs, plan->link_output);
+    return plan_debug_steps(mf, plan, errmsg);
+}
+
+void build_outputs(const Makefile *mf, StrList *out) {
+    char *output = output_path(mf);
+    int final = strcmp(mf->target, "obj") != 0;
+
+    strlist_push(out, output);
+    if (final && has_word(mf->debug, "dwp", 0)) {
+        strlist_push(out, str_printf("%s.dwp", output));
+    }
+    if (final && has_word(mf->debug, "strip", 0)) strlist_push(out, str_printf("%s.debug", output));
+}
+
+// --------------------------------------------------------------------------------
+// Return the executable a test source is linked into: the file name of the source
+// without its extension, in the bin directory.
+// --------------------------------------------------------------------------------
+static char *test_output_path(const Makefile *mf, const char *src) {
+    const char *slash = strrchr(src, '/');
+    const char *name = slash ? slash + 1 : src;
+    const char *dot = strrchr(name, '.');
+    int len = dot ? (int)(dot - name) : (int)strlen(name);
+#ifdef _WIN32
+    return str_printf("%s/%.*s.exe", mf->bin, len, name);
+#else
+    return str_printf("%s/%.*s", mf->bin, len, name);
+#endif
+}
+
+// --------------------------------------------------------------------------------
+// Expand the tests directive like src.
+// --------------------------------------------------------------------------------
+static int expand_tests(const Makefile *mf, StrList *out, char **errmsg) {
+    if (!mf->tests || !mf->tests[0]) {
+        *errmsg = str_printf("%s has no tests= to build.", mf->project);
+        return -1;
+    }
+    return expand_sources(mf->tests, out, errmsg);
+}
+
+int list_tests(const Makefile *mf, StrList *out, char **errmsg) {
+    StrList srcs = {0};
+    int rc = expand_tests(mf, &srcs, errmsg);
+    for (int i = 0; rc == 0 && i < srcs.count; i++) strlist_push(out, test_output_path(mf, srcs.items[i]));
+    strlist_free(&srcs);
+    return rc;
+}
+
+int plan_tests(const Makefile *mf, BuildPlan *plan, char **errmsg) {
+    StrList srcs = {0};
+    StrList project = {0};
+    int rc = -1;
+
+    if (expand_tests(mf, &srcs, errmsg) != 0) goto done;
+
+    Unit *units = realloc(plan->units, sizeof(Unit) * (size_t)(plan->count + srcs.count));
+    if (units) plan->units = units;
+    plan->tests = calloc((size_t)srcs.count, sizeof(TestLink));
+    if (!units || !plan->tests) {
+        *errmsg = strdup("Memory allocation failed for the tests.");
+        goto done;
+    }
+
+    // Every test gets the project's objects, except the one with the program's
+    // own main() — the test brings its own.
+    for (int i = 0; i < plan->count; i++) {
+        if (!defines_main(plan->units[i].src)) strlist_push(&project, strdup(plan->units[i].obj));
+    }
+
+    for (int t = 0; t < srcs.count; t++) {
+        const char *src = srcs.items[t];
+        char *output = test_output_path(mf, src);
+        char *problem = NULL;
+
+        for (int i = 0; i < plan->count && !problem; i++) {
+            if (strcmp(plan->units[i].src, src) == 0) problem = str_printf("%s is in src and in tests.", src);
+        }
+        for (int k = 0; k < plan->ntests && !problem; k++) {
+            if (strcmp(plan->tests[k].output, output) != 0) continue;
+            problem = str_printf("Two tests build %s.", output);
+        }
+        if (problem) {
+            *errmsg = problem;
+            free(output);
+            goto done;
+        }
+
+        Unit *u = &plan->units[plan->count++];
+        memset(u, 0, sizeof(*u));
+        u->src = strdup(src);
+        u->obj = object_path(plan->objdir, src, ".o");
+        u->dep = object_path(plan->objdir, src, ".d");
+        u->cmd = compile_command(plan, mf, u->src, u->obj, u->dep);
+
+        TestLink *test = &plan->tests[plan->ntests++];
+        test->unit = plan->count - 1;
+        test->output = output;
+        test->link_output = temp_output_path(output);
+        strlist_push(&test->inputs, strdup(u->obj));
+        for (int i = 0; i < project.count; i++) strlist_push(&test->inputs, strdup(project.items[i]));
+        test->link_cmd = link_command(plan, mf, "exec", &test->inputs, test->link_output);
+        add_library_files(mf, &test->inputs);
+    }
+    rc = 0;
+
+done:
+    strlist_free(&srcs);
+    strlist_free(&project);
+    return rc;
+}
+
+void free_plan(BuildPlan *plan) {
+    for (int i = 0; i < plan->count; i++) {
+        free(plan->units[i].src);
+        free(plan->units[i].obj);
+        free(plan->units[i].dep);
+        free(plan->units[i].cmd);
+    }
+    free(plan->units);
+    free(plan->objdir);
+    free(plan->flags);
+    free(plan->pkg_cflags);
+    free(plan->pkg_libs);
+    free(plan->module_flags);
+    strlist_free(&plan->inputs);
+    free(plan->output);
+    free(plan->link_output);
+    free(plan->link_cmd);
+    free(plan->debug.dwp_cmd);
+    free(plan->debug.keep_cmd);
+    free(plan->debug.strip_cmd);
+    strlist_free(&plan->debug.dwo);
+    for (int t = 0; t < plan->ntests; t++) {
+        free(plan->tests[t].output);
+        free(plan->tests[t].link_output);
+        free(plan->tests[t].link_cmd);
+        strlist_free(&plan->tests[t].inputs);
+    }
+    free(plan->tests);
+    free_gen_rules(plan->gens, plan->ngens);
+    free_toolchain(&plan->tc);
+    memset(plan, 0, sizeof(*plan));
+}
+
+// Where the compile jobs of a build with workers= run, kept up to date while they run: the units
+// in flight on this machine and on every worker, and the workers that couldn't be reached.
+typedef struct {
+    const WorkerList *workers;
+    int local;              // Compile jobs the local machine runs at once
+    int local_busy;
+    int *busy;              // Units in flight per worker
+    int *down;              // Nonzero for a worker that couldn't be reached
+    RemoteCompile *remote;  // Per job, what a remote compile needs
+} Placement;
+
+// --------------------------------------------------------------------------------
+// Decide where a compile job runs, right before it starts: on a free local
+// processor if there is one, otherwise on the live worker with a free slot that
+// is least busy for its size. With everything busy the job waits for the next one to finish; with
+// nothing running at all it compiles locally. Windows always compiles locally.
+// The dispatch hook of the pool.
+// --------------------------------------------------------------------------------
+static int place_compile(Job *job, int index, void *ctx) {
+    Placement *p = ctx;
+    int pick = -1, running = p->local_busy;
+#ifndef _WIN32
+    const WorkerList *workers = p->workers;
+    for (int i = 0; i < workers->count; i++) {
+        running += p->busy[i];
+        if (p->local_busy < p->local || p->down[i] || p->busy[i] >= workers->items[i].slots) continue;
+        if (pick < 0 || p->busy[i] * workers->items[pick].slots < p->busy[pick] * workers->items[i].slots) {
+            pick = i;
+        }
+    }
+#endif
+    if (pick < 0 && p->local_busy >= p->local && running > 0) return 1;
+
+    if (pick < 0) {
+        p->local_busy++;
+        return 0;
+    }
+
+    RemoteCompile *r = &p->remote[index];
+    r->worker = &p->workers->items[pick];
+    open_down_report(r);
+    p->busy[pick]++;
+    job->fn = remote_compile;
+    job->arg = r;
+    free(job->label);
+    job->label = str_printf("%s -> %s:%s", r->src, r->worker->host, r->worker->port);
+    return 0;
+}
+
+// --------------------------------------------------------------------------------
+// Give back the slot a compile job took. A worker that couldn't be reached gets
+// no more units in this build; the local fallback already built this one. The
+// release hook of the pool.
+// --------------------------------------------------------------------------------
+static void release_compile(Job *job, int index, void *ctx) {
+    Placement *p = ctx;
+    if (!job->fn) {
+        p->local_busy--;
+        return;
+    }
+
+    int w = (int)(p->remote[index].worker - p->workers->items);
+    p->busy[w]--;
+    if (worker_went_down(&p->remote[index]) && !p->down[w]) {
+        p->down[w] = 1;
+        debug("worker %s:%s is down, not used for the rest of the build\n",
+              p->workers->items[w].host, p->workers->items[w].port);
+    }
+}
+
+// --------------------------------------------------------------------------------
+// Turn the debug steps of the plan into jobs: packaging and extracting the debug
+// info run side by side, stripping depends on both.
+//
+// @param plan  The build plan
+// @param jobs  Room for three jobs; deps are indices within it
+// @return      Number of jobs added
+// --------------------------------------------------------------------------------
+static int add_debug_jobs(const BuildPlan *plan, Job *jobs) {
+    int n = 0;
+    if (plan->debug.dwp_cmd) {
+        jobs[n].cmd = strdup(plan->debug.dwp_cmd);
+        jobs[n++].label = str_printf("Packaging %s.dwp", plan->output);
+    }
+    if (plan->debug.keep_cmd) {
+        jobs[n].cmd = strdup(plan->debug.keep_cmd);
+        jobs[n++].label = str_printf("Extracting %s.debug", plan->output);
+    }
+    if (plan->debug.strip_cmd) {
+        Job *strip = &jobs[n];
+        strip->cmd = strdup(plan->debug.strip_cmd);
+        strip->label = str_printf("Stripping %s", plan->output);
+        strip->deps = malloc(sizeof(int) * 2);
+        for (int i = 0; strip->deps && i < n; i++) strip->deps[strip->ndeps++] = i;
+        n++;
+    }
+    return n;
+}
+
+// --------------------------------------------------------------------------------
+// Run the include scanner over the units that have an object but no depfile: the
+// compiler can't write depfiles, or a build was interrupted after the compile.
+// Without the scan those units would all be recompiled just to be safe.
+//
+// @param plan     The build plan
+// @param threads  Number of threads to scan with
+// @return         Array of plan->count header lists (empty for units that weren't
+//                 scanned), or NULL if no unit needed a scan
+// --------------------------------------------------------------------------------
+static StrList *scan_without_depfiles(const BuildPlan *plan, int threads) {
+    char **srcs = malloc(sizeof(char *) * (size_t)(plan->count + 1));
+    int *index = malloc(sizeof(int) * (size_t)(plan->count + 1));
+    StrList *deps = NULL;
+    int n = 0;
+
+    for (int i = 0; srcs && index && i < plan->count; i++) {
+        const Unit *u = &plan->units[i];
+        if (file_mtime(u->obj) >= 0 && (!plan->tc.depfiles || file_mtime(u->dep) < 0)) {
+            srcs[n] = u->src;
+            index[n++] = i;
+        }
+    }
+
+    StrList *found = n > 0 ? calloc((size_t)n, sizeof(StrList)) : NULL;
+    deps = found ? calloc((size_t)plan->count, sizeof(StrList)) : NULL;
+    if (deps) {
+        IncludePaths paths;
+        include_paths_from_flags(plan->flags, &paths);
+        scan_includes(srcs, n, &paths, threads, found);
+        free_include_paths(&paths);
+
+        // The lists move over to their units.
+        for (int k = 0; k < n; k++) deps[index[k]] = found[k];
+    }
+    else if (found) {
+        for (int k = 0; k < n; k++) strlist_free(&found[k]);
+    }
+
+    free(found);
+    free(srcs);
+    free(index);
+    return deps;
+}
+
+// --------------------------------------------------------------------------------
+// Check the modules a C++ unit imports: it must be recompiled when a provider is
+// recompiled in this build, or when a provider's interface is newer than the
+// unit's object. A provider whose interface is gone is stale itself.
+//
+// @param graph   Module graph of the plan
+// @param unit    Index of the unit
+// @param obj     Object file of the unit
+// @param job_of  Compile job of every unit visited so far, -1 if it has none
+// @param detail  Receives an allocated description of the culprit or NULL
+// @return        The reason to rebuild, or STALE_NONE
+// --------------------------------------------------------------------------------
+static StaleReason check_imports(const ModuleGraph *graph, int unit, const char *obj, const int *job_of,
+                                 char **detail) {
+    const ModuleUnit *m = &graph->units[unit];
+    if (m->bmi && file_mtime(m->bmi) < 0) {
+        *detail = strdup(m->bmi);
+        return STALE_MISSING_OUTPUT;
+    }
+
+    long long obj_time = file_mtime(obj);
+    for (int d = 0; d < m->ndeps; d++) {
+        const ModuleUnit *dep = &graph->units[m->deps[d]];
+        if (job_of[m->deps[d]] >= 0 || file_mtime(dep->bmi) > obj_time) {
+            *detail = strdup(dep->provides);
+            return STALE_CHANGED_MODULE;
+        }
+    }
+    return STALE_NONE;
+}
+
+// --------------------------------------------------------------------------------
+// Print one line of --explain output: the file, whether it is rebuilt, and why.
+// --------------------------------------------------------------------------------
+static void explain(const char *what, StaleReason reason, const char *detail) {
+    if (reason == STALE_NONE) printf("explain: %s is up to date\n", what);
+    else if (detail)          printf("explain: %s is stale: %s (%s)\n", what, stale_reason_text(reason), detail);
+    else                      printf("explain: %s is stale: %s\n", what, stale_reason_text(reason));
+}
+
+// --------------------------------------------------------------------------------
+// Run the rules of gen= whose outputs are out of date, before anything else looks
+// at the sources. A rule is out of date if one of its outputs is missing, older
+// than one of its inputs or was written by a different command, or if a rule it
+// depends on runs. The rules run through the pool like the compiles, each one as
+// soon as the rules it depends on succeeded. What a failed rule wrote is removed,
+// so the next build runs it again instead of taking a half-written file for
+// current. With opts->dry_run the commands are printed instead.
+//
+// @param plan    The build plan
+// @param log     Command log; gets the command of every rule that succeeded
+// @param opts    Command line options for this build
+// @param stats   Statistics that get the rules that ran
+// @param ran     Receives the number of rules that ran (or would run)
+// @param errmsg  Set to an allocated message on failure
+// @return        BUILD_OK, or the kind of failure
+// --------------------------------------------------------------------------------
+static BuildResult run_generators(const BuildPlan *plan, CommandLog *log, const BuildOptions *opts,
+                                  BuildStats *stats, int *ran, char **errmsg) {
+    *ran = 0;
+    if (plan->ngens == 0) return BUILD_OK;
+
+    BuildResult result = BUILD_OK;
+    Job *jobs = calloc((size_t)plan->ngens, sizeof(Job));
+    int *job_of = malloc(sizeof(int) * (size_t)plan->ngens);
+    int *rule_of = malloc(sizeof(int) * (size_t)plan->ngens);
+    int njobs = 0;
+    if (!jobs || !job_of || !rule_of) {
+        *errmsg = strdup("Memory allocation failed for build jobs.");
+        result = BUILD_CONFIG_ERROR;
+        goto done;
+    }
+
+    for (int i = 0; i < plan->ngens; i++) {
+        const GenRule *g = &plan->gens[i];
+        char *detail = NULL;
+        StaleReason reason = STALE_NONE;
+        for (int o = 0; o < g->outputs.count && reason == STALE_NONE; o++) {
+            reason = check_output(log, g->outputs.items[o], &g->inputs, g->cmd, &detail);
+        }
+        for (int d = 0; d < g->ndeps && reason == STALE_NONE; d++) {
+            if (job_of[g->deps[d]] < 0) continue;
+            reason = STALE_NEWER_INPUT;
+            detail = str_printf("%s is generated again", plan->gens[g->deps[d]].outputs.items[0]);
+        }
+
+        job_of[i] = -1;
+        if (opts->explain) explain(g->outputs.items[0], reason, detail);
+        free(detail);
+        if (reason == STALE_NONE) continue;
+
+        for (int o = 0; o < g->outputs.count && !opts->dry_run; o++) {
+            if (make_parent_dirs(g->outputs.items[o]) != 0) {
+                *errmsg = str_printf("Could not create the directory of: %s", g->outputs.items[o]);
+                result = BUILD_CONFIG_ERROR;
+                goto done;
+            }
+        }
+
+        Job *job = &jobs[njobs];
+        job->cmd = strdup(g->cmd);
+        job->label = str_printf("Generating %s", g->outputs.items[0]);
+        job->deps = malloc(sizeof(int) * ((size_t)g->ndeps + 1));
+        for (int d = 0; job->deps && d < g->ndeps; d++) {
+            if (job_of[g->deps[d]] >= 0) job->deps[job->ndeps++] = job_of[g->deps[d]];
+        }
+        job_of[i] = njobs;
+        rule_of[njobs++] = i;
+    }
+    *ran = njobs;
+
+    if (opts->dry_run) {
+        for (int i = 0; i < njobs; i++) printf("%s\n", jobs[i].cmd);
+        goto done;
+    }
+    if (njobs == 0) goto done;
+
+    JobPool pool = { opts->jobs, opts->keep_going, 0, opts->progress, opts->progress_ctx,
+                     NULL, NULL, NULL, opts->catch_signals };
+    run_jobs(jobs, njobs, &pool);
+    stats_add_jobs(stats, jobs, njobs);
+    if (pool.peak_parallel > stats->peak_parallel) stats->peak_parallel = pool.peak_parallel;
+
+    // Rules that never started left their old outputs alone, those stay.
+    int failed = -1, unfinished = 0;
+    for (int i = 0; i < njobs; i++) {
+        const GenRule *g = &plan->gens[rule_of[i]];
+        int status = jobs[i].status;
+        if (status == 0) {
+            for (int o = 0; o < g->outputs.count; o++) record_command(log, g->outputs.items[o], g->cmd);
+            continue;
+        }
+
+        if (status != JOB_NOT_RUN && status != JOB_SKIPPED) {
+            for (int o = 0; o < g->outputs.count; o++) remove(g->outputs.items[o]);
+        }
+        if (status > 0 && failed < 0) failed = rule_of[i];
+        unfinished++;
+    }
+    save_command_log(log);
+
+    if (failed >= 0) {
+        *errmsg = str_printf("Generating %s failed.", plan->gens[failed].outputs.items[0]);
+        result = BUILD_COMPILE_FAILED;
+    }
+    else if (unfinished > 0) {
+        *errmsg = str_printf("%d of %d gen= rule(s) didn't finish.", unfinished, njobs);
+        result = BUILD_COMPILE_FAILED;
+    }
+
+done:
+    for (int i = 0; jobs && i < njobs; i++) free_job(&jobs[i]);
+    free(jobs);
+    free(job_of);
+    free(rule_of);
+    return result;
+}
+
+// One output the build may link: the project's own or a test. job is its link job
+// while the link is pending, -1 once the output is known to be current.
+typedef struct {
+    const char *output;
+    const char *link_output;
+    const char *cmd;
+    const StrList *inputs;
+    int job;
+} LinkStep;
+
+// --------------------------------------------------------------------------------
+// Construct and execute the build using the given Makefile configuration. The
+// build is planned first, then every unit is checked against its object file:
+// only units that are stale get a compile job. A link job depends on all of them
+// and runs if anything was recompiled or the output itself is out of date.
+// Everything runs through the pool with at most opts->jobs at the same time. By
+// default the first compiler error stops the build; with opts->keep_going every
+// unit is still compiled and only the links that need a failed unit are skipped. The link and the debug
+// steps work on a temporary file, which replaces the output once all succeeded.
+//
+// The rules of gen= come first, so the compiles see the sources they generate; a
+// rule that fails stops the build before anything is compiled.
+//
+// With opts->tests the tests are compiled along with the project, and after the
+// compiles every test is linked side by side with the output, each checked on its
+// own like the output is.
+//
+// With opts->dry_run the commands are printed instead of run, with opts->explain
+// the reason behind every rebuild decision is printed first. When the workers
+// directive lists remote workers, part of the units is compiled there and the
+// pool grows by their slots.
+//
+// A lang=c++ build scans the sources for modules first. Units are then visited
+// providers first, and every compile job depends on the jobs of the modules it
+// imports; units that don't import each other still compile side by side.
+//
+// If a step fails, errmsg is set to a descriptive message allocated on the heap.
+// On success, errmsg remains NULL.
+//
+// @param mf       Pointer to a fully populated Makefile configuration
+// @param opts     Command line options for this build
+// @param errmsg   Output parameter to store an error string if the build fails (NULL on success)
+// @return         BUILD_OK on success, otherwise the kind of failure
+// --------------------------------------------------------------------------------
+BuildResult run(const Makefile *mf, const BuildOptions *opts, char **errmsg) {
+    BuildResult result = BUILD_OK;
+    BuildPlan plan;
+    CommandLog log;
+    BuildStats stats;
+    WorkerList workers;
+    Job *jobs = NULL;
+    int *unit_of = NULL;
+    RemoteCompile *remote = NULL;
+    int *busy = NULL, *down = NULL;
+    StrList *scanned = NULL;
+    ModuleGraph graph;
+    int *job_of = NULL;
+    StrList link_inputs;
+    StrList broken;
+    LinkStep *links = NULL;
+    int nlinks = 0;
+    int njobs = 0;
+    int generated = 0;
+    int report = 0;
+
+    memset(&stats, 0, sizeof(stats));
+    memset(&log, 0, sizeof(log));
+    memset(&link_inputs, 0, sizeof(link_inputs));
+    memset(&broken, 0, sizeof(broken));
+    memset(&workers, 0, sizeof(workers));
+    memset(&graph, 0, sizeof(graph));
+    double start = now_seconds();
+    stats.project = strdup(mf->project);
+
+    if (plan_build(mf, &plan, errmsg) != 0 || (opts->tests && plan_tests(mf, &plan, errmsg) != 0)
+        || parse_workers(mf->workers, &workers, errmsg) != 0) {
+        result = BUILD_CONFIG_ERROR;
+        goto cleanup;
+    }
+
+    char *log_file = str_printf("%s/" COMMAND_LOG, plan.objdir);
+    load_command_log(&log, log_file);
+    free(log_file);
+
+    // The generated sources have to be there before they are scanned or checked.
+    if (!opts->dry_run && plan.ngens > 0 && make_dirs(plan.objdir) != 0) {
+        *errmsg = str_printf("Could not create object directory: %s", plan.objdir);
+        result = BUILD_CONFIG_ERROR;
+        goto cleanup;
+    }
+    result = run_generators(&plan, &log, opts, &stats, &generated, errmsg);
+    if (result != BUILD_OK) {
+        report = result != BUILD_CONFIG_ERROR && !opts->dry_run;
+        goto cleanup;
+    }
+
+    // Workers get preprocessed sources, which can't carry module imports.
+    if (plan.cxx) {
+        if (workers.count > 0) fprintf(stderr, "Warning: workers= is ignored for lang=c++.\n");
+        free_workers(&workers);
+        if (scan_modules(&plan, opts->jobs, &log, &graph, errmsg) != 0) {
+            result = BUILD_CONFIG_ERROR;
+            goto cleanup;
+        }
+    }
+
+    // A remote compile only sends the object back, the .dwo file would stay behind.
+    if (plan.split_dwarf && workers.count > 0) {
+        fprintf(stderr, "Warning: workers= is ignored for debug=split.\n");
+        free_workers(&workers);
+    }
+
+    // Every worker slot is one more job that may run at the same time; the local
+    // processors only preprocess for those.
+    int max_parallel = opts->jobs;
+    for (int i = 0; i < workers.count; i++) max_parallel += workers.items[i].slots;
+    stats.max_parallel = max_parallel;
+
+    // At most one job per unit, then a link job for the output and every test and
+    // up to three debug steps. unit_of maps a job back to the unit it compiles,
+    // remote holds what a remote compile needs, busy and down track the workers.
+    jobs = calloc((size_t)(plan.count + plan.ntests) + 4, sizeof(Job));
+    unit_of = calloc((size_t)plan.count + 1, sizeof(int));
+    remote = calloc((size_t)plan.count + 1, sizeof(RemoteCompile));
+    job_of = malloc(sizeof(int) * ((size_t)plan.count + 1));
+    busy = calloc((size_t)workers.count + 1, sizeof(int));
+    down = calloc((size_t)workers.count + 1, sizeof(int));
+    if (!jobs || !unit_of || !remote || !job_of || !busy || !down) {
+        *errmsg = strdup("Memory allocation failed for build jobs.");
+        result = BUILD_CONFIG_ERROR;
+        goto cleanup;
+    }
+
+    // Depfiles are the real record of a unit's headers. Where one is missing, a scan
+    // of the #include lines is good enough to tell that nothing changed.
+    scanned = scan_without_depfiles(&plan, opts->jobs);
+
+    for (int k = 0; k < plan.count; k++) {
+        int i = graph.order ? graph.order[k] : k;
+        const Unit *u = &plan.units[i];
+        char *detail = NULL;
+        StaleReason reason = check_object(&log, u->src, u->obj, u->dep, u->cmd,
+                                          scanned ? &scanned[i] : NULL, &detail);
+        if (reason == STALE_NONE && graph.units) reason = check_imports(&graph, i, u->obj, job_of, &detail);
+
+        job_of[i] = -1;
+        if (opts->explain) explain(u->src, reason, detail);
+        free(detail);
+        if (reason == STALE_NONE) continue;
+
+        if (!opts->dry_run && make_parent_dirs(u->obj) != 0) {
+            *errmsg = str_printf("Could not create object directory for: %s", u->obj);
+            result = BUILD_CONFIG_ERROR;
+            goto cleanup;
+        }
+        jobs[njobs].cmd = strdup(u->cmd);
+        unit_of[njobs] = i;
+        job_of[i] = njobs;
+
+        // Wait for the interfaces this unit imports, if they are being compiled.
+        if (graph.units && graph.units[i].ndeps > 0) {
+            const ModuleUnit *m = &graph.units[i];
+            jobs[njobs].deps = malloc(sizeof(int) * (size_t)m->ndeps);
+            for (int d = 0; jobs[njobs].deps && d < m->ndeps; d++) {
+                if (job_of[m->deps[d]] >= 0) jobs[njobs].deps[jobs[njobs].ndeps++] = job_of[m->deps[d]];
+            }
+        }
+
+        // Whether the unit goes to a worker is decided when the job starts.
+        RemoteCompile *r = &remote[njobs];
+        r->comp = mf->comp;
+        r->flags = plan.flags;
+        r->src = u->src;
+        r->obj = u->obj;
+        r->dep = u->dep;
+        r->local_cmd = u->cmd;
+        r->down_pipe[0] = r->down_pipe[1] = -1;
+        jobs[njobs].label = strdup(u->src);
+        njobs++;
+    }
+    int compiles = njobs;
+    stats.units = plan.count;
+    stats.up_to_date = plan.count - compiles;
+
+    // With debug=dwp the .dwo files end up in the output as well: a change that
+    // only touches debug info leaves the object as it is, but not the package.
+    // The library files in libs= are linked in like the objects.
+    for (int i = 0; i < plan.inputs.count; i++) strlist_push(&link_inputs, strdup(plan.inputs.items[i]));
+    for (int i = 0; i < plan.debug.dwo.count; i++) strlist_push(&link_inputs, strdup(plan.debug.dwo.items[i]));
+    add_library_files(mf, &link_inputs);
+
+    // The output comes first, then the tests.
+    nlinks = 1 + plan.ntests;
+    links = calloc((size_t)nlinks, sizeof(LinkStep));
+    if (!links) {
+        *errmsg = strdup("Memory allocation failed for build jobs.");
+        result = BUILD_CONFIG_ERROR;
+        goto cleanup;
+    }
+    links[0] = (LinkStep){ plan.output, plan.link_output, plan.link_cmd, &link_inputs, -1 };
+    for (int t = 0; t < plan.ntests; t++) {
+        const TestLink *test = &plan.tests[t];
+        links[1 + t] = (LinkStep){ test->output, test->link_output, test->link_cmd, &test->inputs, -1 };
+    }
+
+    // Relink if the output is missing, was linked with a different command, or an
+    // object's content changed since. With recompiles pending that last part can
+    // only be answered once they are done, so for now the link is assumed. Every
+    // link runs on its own after the compiles, not as a job that waits for them.
+    for (int l = 0; l < nlinks; l++) {
+        LinkStep *k = &links[l];
+        char *detail = NULL;
+        StaleReason reason = STALE_NEWER_INPUT;
+        if (compiles == 0) reason = check_output(&log, k->output, k->inputs, k->cmd, &detail);
+        else detail = str_printf("%d object(s) recompiled", compiles);
+        if (opts->explain && (compiles == 0 || opts->dry_run)) explain(k->output, reason, detail);
+        free(detail);
+        if (reason == STALE_NONE) continue;
+
+        k->job = njobs;
+        jobs[njobs].cmd = strdup(k->cmd);
+        jobs[njobs++].label = str_printf("Linking %s", k->output);
+        debug("link command: %s\n", k->cmd);
+    }
+    int post = njobs;
+    if (links[0].job >= 0) njobs += add_debug_jobs(&plan, &jobs[post]);
+
+    if (opts->dry_run) {
+        for (int i = 0; i < njobs; i++) printf("%s\n", jobs[i].cmd);
+        goto cleanup;
+    }
+
+    // Without this check every unit would fail on its own with "not found".
+    if (!plan.tc.path) {
+        *errmsg = str_printf("Compiler not found: %s", mf->comp);
+        result = BUILD_CONFIG_ERROR;
+        goto cleanup;
+    }
+
+    report = 1;
+    if (njobs == 0) {
+        if (generated == 0) printf("Nothing to do, %s is up to date.\n", plan.output);
+        goto cleanup;
+    }
+
+    if (make_dirs(mf->bin) != 0) {
+        *errmsg = str_printf("Could not create output directory: %s", mf->bin);
+        result = BUILD_CONFIG_ERROR;
+        goto cleanup;
+    }
+    if (make_dirs(plan.objdir) != 0) {
+        *errmsg = str_printf("Could not create object directory: %s", plan.objdir);
+        result = BUILD_CONFIG_ERROR;
+        goto cleanup;
+    }
+
+    // Workers are picked as the compiles start, so none gets more units at a time
+    // than its slots, whatever order the pool starts them in.
+    JobPool pool = { max_parallel, opts->keep_going, 0, opts->progress, opts->progress_ctx,
+                     NULL, NULL, NULL, opts->catch_signals };
+    Placement placement = { &workers, opts->jobs, 0, busy, down, remote };
+    if (workers.count > 0) {
+        pool.dispatch = place_compile;
+        pool.release = release_compile;
+        pool.dispatch_ctx = &placement;
+    }
+    run_jobs(jobs, compiles, &pool);
+    pool.dispatch = NULL;
+    pool.release = NULL;
+    stats_add_jobs(&stats, jobs, compiles);
+    stats.peak_parallel = pool.peak_parallel;
+
+    // Remember the command of everything that was built successfully, so the next
+    // run can tell whether the flags changed.
+    int failed = 0, unfinished = 0;
+    for (int i = 0; i < compiles; i++) {
+        const Unit *u = &plan.units[unit_of[i]];
+        if (jobs[i].status == 0) {
+            record_command(&log, u->obj, u->cmd);
+            continue;
+        }
+        if (jobs[i].status > 0) failed++;
+        else                    unfinished++;
+        strlist_push(&broken, strdup(u->obj));
+    }
+
+    // Early cutoff: a comment edit or a touched header recompiles objects into the
+    // same bytes, and then the output they were linked into is still current. The
+    // links that remain move to the front, so they run as one batch. After a
+    // failure only keep-going links anything, and only what doesn't need a unit
+    // that failed or wasn't built.
+    int nrun = 0;
+    for (int l = 0; l < nlinks; l++) {
+        LinkStep *k = &links[l];
+        if (k->job < 0) continue;
+        int blocked = broken.count > 0 && !opts->keep_going;
+        for (int i = 0; i < k->inputs->count && !blocked; i++) {
+            for (int b = 0; b < broken.count && !blocked; b++) {
+                blocked = strcmp(k->inputs->items[i], broken.items[b]) == 0;
+            }
+        }
+        if (blocked) {
+            k->job = -1;
+            continue;
+        }
+
+        if (compiles > 0) {
+            char *detail = NULL;
+            StaleReason reason = check_output(&log, k->output, k->inputs, k->cmd, &detail);
+            if (opts->explain) explain(k->output, reason, detail);
+            free(detail);
+            if (reason == STALE_NONE) {
+                if (l == 0) stats.link_cutoff = 1;
+                k->job = -1;
+                continue;
+            }
+        }
+
+        // Everything between here and the job was cut off, so nothing is lost.
+        Job moved = jobs[compiles + nrun];
+        jobs[compiles + nrun] = jobs[k->job];
+        jobs[k->job] = moved;
+        k->job = compiles + nrun++;
+    }
+    if (nrun > 0) {
+        run_jobs(&jobs[compiles], nrun, &pool);
+        stats_add_jobs(&stats, &jobs[compiles], nrun);
+        if (pool.peak_parallel > stats.peak_parallel) stats.peak_parallel = pool.peak_parallel;
+    }
+    int linked = links[0].job >= 0 && jobs[links[0].job].status == 0;
+
+    // The debug steps work on the output as it was just linked.
+    int debug_failed = 0;
+    if (linked && njobs > post) {
+        run_jobs(&jobs[post], njobs - post, &pool);
+        stats_add_jobs(&stats, &jobs[post], njobs - post);
+        if (pool.peak_parallel > stats.peak_parallel) stats.peak_parallel = pool.peak_parallel;
+        for (int i = post; i < njobs; i++) debug_failed |= jobs[i].status != 0;
+    }
+
+    // Only a complete output replaces the old one. What a failed link or debug
+    // step left behind is removed, the old output stays as it was. The digest of
+    // the objects goes with every output that was replaced, for the next cutoff;
+    // the others are left unrecorded, so they are linked again.
+    char *link_error = NULL;
+    for (int l = 0; l < nlinks; l++) {
+        const LinkStep *k = &links[l];
+        if (k->job < 0) continue;
+
+        int complete = jobs[k->job].status == 0 && !(l == 0 && debug_failed);
+        if (complete && replace_file(k->link_output, k->output) == 0) {
+            record_command(&log, k->output, k->cmd);
+            record_content(&log, k->output, inputs_digest(&log, k->inputs), file_mtime(k->output));
+            continue;
+        }
+        remove(k->link_output);
+
+        if (link_error) continue;
+        if (complete)               link_error = str_printf("Could not replace %s.", k->output);
+        else if (l > 0 || !linked)  link_error = str_printf("Linking %s failed.", k->output);
+        else                        link_error = str_printf("Processing the debug info of %s failed.", k->output);
+    }
+    save_command_log(&log);
+
+    stats.compiled = compiles - failed - unfinished;
+    stats.failed = failed;
+    stats.not_built = unfinished;
+    stats.linked = linked;
+
+    if (failed > 0 || unfinished > 0) {
+        if (unfinished > 0) {
+            *errmsg = str_printf("%d of %d translation unit(s) failed to compile, %d not built.",
+                                 failed, compiles, unfinished);
+        } else {
+            *errmsg = str_printf("%d of %d translation unit(s) failed to compile.", failed, compiles);
+        }
+        result = BUILD_COMPILE_FAILED;
+    } else if (link_error) {
+        *errmsg = link_error;
+        link_error = NULL;
+        result = BUILD_LINK_FAILED;
+    }
+    free(link_error);
+
+cleanup:
+    // Report on every build that got as far as deciding what to do — a no-op
+    // build is a data point too. Dry runs and broken configurations aren't.
+    stats.wall = now_seconds() - start;
+    stats.result = result;
+    if (report) {
+        if (njobs + generated > 0 || opts->stats) print_stats(&stats, opts->stats);
+        if (opts->stats_json && write_stats_json(&stats, opts->stats_json) != 0) {
+            fprintf(stderr, "Warning: Could not write statistics to %s\n", opts->stats_json);
+        }
+    }
+
+    if (jobs) {
+        for (int i = 0; i < njobs; i++) free_job(&jobs[i]);
+        free(jobs);
+    }
+    free(unit_of);
+    free(job_of);
+    free(links);
+    free(remote);
+    free(busy);
+    free(down);
+    free_module_graph(&graph);
+    if (scanned) {
+        for (int i = 0; i < plan.count; i++) strlist_free(&scanned[i]);
+        free(scanned);
+    }
+    free_workers(&workers);
+    strlist_free(&link_inputs);
+    strlist_free(&broken);
+    free_plan(&plan);
+    free_command_log(&log);
+
+    // The caller takes over the statistics, steps and all.
+    if (opts->report) {
+        *opts->report = stats;
+        memset(&stats, 0, sizeof(stats));
+    }
+    free_stats(&stats);
+    return result;
+}
@@ -0,0 +1,83 @@
+/* ****************************************************************************************************
+ * compdb.c - Implementation of the compilation database writer. The whole file is assembled in one
+ * buffer and written with a single call, so even projects with thousands of sources take no more
+ * than a few milliseconds — cheap enough to regenerate after every change of the `.pmake` file.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created.                                                         Version: 00.01
+ * Sun 2026-10-18 Test sources of tests= get their entries too.                         Version: 00.02
+ * **************************************************************************************************** */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "compdb.h"
+#include "util.h"
+
+#ifdef _WIN32
+    #include <direct.h>
+    #define _getcwd_buf(b, n) _getcwd(b, n)
+#else
+    #include <unistd.h>
+    #define _getcwd_buf(b, n) getcwd(b, n)
+#endif
+
+// --------------------------------------------------------------------------------
+// Write the compilation database for the configuration. The build is planned but
+// not executed; the plan's units become the entries, in the order the sources
+// were expanded, followed by the test sources, so editors know their flags too.
+//
+// @param mf      Parsed build configuration
+// @param path    File to write, usually COMPDB_FILE
+// @param errmsg  Set to an allocated message on failure
+// @return        BUILD_OK on success, BUILD_CONFIG_ERROR otherwise
+// --------------------------------------------------------------------------------
+BuildResult write_compdb(const Makefile *mf, const char *path, char **errmsg) {
+    char cwd[4096];
+    if (!_getcwd_buf(cwd, sizeof(cwd))) {
+        *errmsg = strdup("Could not determine the current directory.");
+        return BUILD_CONFIG_ERROR;
+    }
+
+    BuildPlan plan;
+    if (plan_build(mf, &plan, errmsg) != 0 || (mf->tests && plan_tests(mf, &plan, errmsg) != 0)) {
+        free_plan(&plan);
+        return BUILD_CONFIG_ERROR;
+    }
+
+    // Every entry shares the same directory, so escape it once up front.
+    StrBuf dir = {0};
+    sb_json_string(&dir, cwd);
+
+    StrBuf sb = {0};
+    sb_printf(&sb, "[\n");
+    for (int i = 0; i < plan.count; i++) {
+        const Unit *u = &plan.units[i];
+        sb_printf(&sb, "  {\n    \"directory\": %s,\n    \"file\": ", dir.data);
+        sb_json_string(&sb, u->src);
+        sb_printf(&sb, ",\n    \"output\": ");
+        sb_json_string(&sb, u->obj);
+        sb_printf(&sb, ",\n    \"command\": ");
+        sb_json_string(&sb, u->cmd);
+        sb_printf(&sb, "\n  }%s\n", i + 1 < plan.count ? "," : "");
+    }
+    sb_printf(&sb, "]\n");
+
+    BuildResult result = BUILD_OK;
+    if (!sb.data || write_file_atomic(path, sb.data, sb.len) != 0) {
+        *errmsg = str_printf("Could not write %s", path);
+        result = BUILD_CONFIG_ERROR;
+    } else {
+        printf("Wrote %s with %d entr%s.\n", path, plan.count, plan.count == 1 ? "y" : "ies");
+    }
+
+    sb_free(&sb);
+    sb_free(&dir);
+    free_plan(&plan);
+    return result;
+}
@@ -0,0 +1,385 @@
+/* ****************************************************************************************************
+ * depend.c - Implementation of the rebuild decisions. The command log is a plain text file with one
+ * "hash path" line per produced file, small enough to read and write completely on every build. The
+ * depfile reader understands the subset of Makefile syntax compilers emit: one rule, continuation
+ * lines, and backslash-escaped spaces in file names.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created.                                                         Version: 00.01
+ * Sun 2026-10-18 read_all() moved to util.c as read_file().                            Version: 00.02
+ * Sun 2026-10-18 check_object() checks scanned headers when the depfile is missing.    Version: 00.03
+ * Sun 2026-10-18 Text for STALE_CHANGED_MODULE.                                        Version: 00.04
+ * Sun 2026-10-18 Content hashes and inputs digest for early-cutoff relinking.          Version: 00.05
+ * **************************************************************************************************** */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "depend.h"
+#include "debug.h"
+
+// qsort() has no user pointer in C99, so the paths are sorted through an index
+// array and the hashes are rearranged to match afterwards.
+static const CommandLog *sort_log;
+
+static int compare_index(const void *a, const void *b) {
+    int ia = *(const int *)a, ib = *(const int *)b;
+    return strcmp(sort_log->paths[ia], sort_log->paths[ib]);
+}
+
+static void sort_command_log(CommandLog *log) {
+    if (log->sorted == log->count) return;
+
+    int *idx = malloc(sizeof(int) * (size_t)log->count);
+    char **paths = malloc(sizeof(char *) * (size_t)log->count);
+    uint64_t *hashes = malloc(sizeof(uint64_t) * (size_t)log->count);
+    uint64_t *contents = malloc(sizeof(uint64_t) * (size_t)log->count);
+    long long *stamps = malloc(sizeof(long long) * (size_t)log->count);
+    if (!idx || !paths || !hashes || !contents || !stamps) {
+        free(idx);
+        free(paths);
+        free(hashes);
+        free(contents);
+        free(stamps);
+        return;
+    }
+
+    for (int i = 0; i < log->count; i++) idx[i] = i;
+    sort_log = log;
+    qsort(idx, (size_t)log->count, sizeof(int), compare_index);
+
+    for (int i = 0; i < log->count; i++) {
+        paths[i] = log->paths[idx[i]];
+        hashes[i] = log->hashes[idx[i]];
+        contents[i] = log->contents[idx[i]];
+        stamps[i] = log->stamps[idx[i]];
+    }
+
+    free(log->paths);
+    free(log->hashes);
+    free(log->contents);
+    free(log->stamps);
+    free(idx);
+    log->paths = paths;
+    log->hashes = hashes;
+    log->contents = contents;
+    log->stamps = stamps;
+    log->cap = log->count;
+    log->sorted = log->count;
+}
+
+// --------------------------------------------------------------------------------
+// Find the entry of a path: a binary search over the sorted front of the log and
+// a plain scan over the entries recorded since it was last sorted.
+// --------------------------------------------------------------------------------
+static int find_entry(const CommandLog *log, const char *path) {
+    int lo = 0, hi = log->sorted - 1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        int c = strcmp(log->paths[mid], path);
+        if (c == 0) return mid;
+        if (c < 0) lo = mid + 1;
+        else       hi = mid - 1;
+    }
+    for (int i = log->sorted; i < log->count; i++) {
+        if (strcmp(log->paths[i], path) == 0) return i;
+    }
+    return -1;
+}
+
+static void append_entry(CommandLog *log, char *path, uint64_t hash, uint64_t content, long long stamp) {
+    if (log->count == log->cap) {
+        int cap = log->cap ? log->cap * 2 : 64;
+        char **paths = realloc(log->paths, sizeof(char *) * (size_t)cap);
+        if (!paths) {
+            free(path);
+            return;
+        }
+        log->paths = paths;
+        uint64_t *hashes = realloc(log->hashes, sizeof(uint64_t) * (size_t)cap);
+        if (!hashes) {
+            free(path);
+            return;
+        }
+        log->hashes = hashes;
+        uint64_t *contents = realloc(log->contents, sizeof(uint64_t) * (size_t)cap);
+        if (!contents) {
+            free(path);
+            return;
+        }
+        log->contents = contents;
+        long long *stamps = realloc(log->stamps, sizeof(long long) * (size_t)cap);
+        if (!stamps) {
+            free(path);
+            return;
+        }
+        log->stamps = stamps;
+        log->cap = cap;
+    }
+    log->paths[log->count] = path;
+    log->hashes[log->count] = hash;
+    log->contents[log->count] = content;
+    log->stamps[log->count] = stamp;
+    log->count++;
+}
+
+void load_command_log(CommandLog *log, const char *file) {
+    memset(log, 0, sizeof(*log));
+    log->file = strdup(file);
+
+    char *data = read_file(file, NULL);
+    if (!data) return;
+
+    char *line = data;
+    while (*line) {
+        char *end = strchr(line, '\n');
+        if (end) *end = '\0';
+
+        // "command path" or "command:content:stamp path"; logs from before
+        // content hashes only have the first form.
+        uint64_t hash, content = 0;
+        long long stamp = 0;
+        int consumed = 0;
+        if (sscanf(line, "%" SCNx64 ":%" SCNx64 ":%lld %n", &hash, &content, &stamp, &consumed) == 3
+            && consumed > 0) {
+            if (line[consumed]) append_entry(log, strdup(line + consumed), hash, content, stamp);
+        }
+        else if (sscanf(line, "%" SCNx64 " %n", &hash, &consumed) == 1 && consumed > 0 && line[consumed]) {
+            append_entry(log, strdup(line + consumed), hash, 0, 0);
+        }
+
+        if (!end) break;
+        line = end + 1;
+    }
+
+    free(data);
+    sort_command_log(log);
+}
+
+void record_command(CommandLog *log, const char *path, const char *cmd) {
+    uint64_t hash = hash_bytes(cmd, strlen(cmd), HASH_SEED);
+
+    int i = find_entry(log, path);
+    if (i >= 0) {
+        log->hashes[i] = hash;
+        return;
+    }
+
+    append_entry(log, strdup(path), hash, 0, 0);
+}
+
+void record_content(CommandLog *log, const char *path, uint64_t content, long long stamp) {
+    int i = find_entry(log, path);
+    if (i < 0) {
+        append_entry(log, strdup(path), 0, content, stamp);
+        return;
+    }
+    log->contents[i] = content;
+    log->stamps[i] = stamp;
+}
+
+uint64_t inputs_digest(CommandLog *log, const StrList *inputs) {
+    uint64_t digest = HASH_SEED;
+    for (int i = 0; i < inputs->count; i++) {
+        const char *path = inputs->items[i];
+        int k = find_entry(log, path);
+        long long stamp = file_mtime(path);
+        uint64_t content = k >= 0 && log->stamps[k] == stamp ? log->contents[k] : 0;
+
+        if (content == 0) {
+            content = hash_file(path);
+            record_content(log, path, content, stamp);
+        }
+        digest = hash_bytes(&content, sizeof(content), digest);
+    }
+    return digest;
+}
+
+int save_command_log(CommandLog *log) {
+    if (!log->file) return -1;
+    sort_command_log(log);
+
+    StrBuf sb = {0};
+    for (int i = 0; i < log->count; i++) {
+        if (log->contents[i]) {
+            sb_printf(&sb, "%016" PRIx64 ":%016" PRIx64 ":%lld %s\n", log->hashes[i], log->contents[i],
+                      log->stamps[i], log->paths[i]);
+        }
+        else {
+            sb_printf(&sb, "%016" PRIx64 " %s\n", log->hashes[i], log->paths[i]);
+        }
+    }
+
+    int rc = write_file_atomic(log->file, sb.data ? sb.data : "", sb.len);
+    sb_free(&sb);
+    return rc;
+}
+
+void free_command_log(CommandLog *log) {
+    for (int i = 0; i < log->count; i++) free(log->paths[i]);
+    free(log->paths);
+    free(log->hashes);
+    free(log->contents);
+    free(log->stamps);
+    free(log->file);
+    memset(log, 0, sizeof(*log));
+}
+
+// --------------------------------------------------------------------------------
+// Tell whether the command differs from the one that last produced path. A file
+// pmake has never recorded counts as changed.
+// --------------------------------------------------------------------------------
+static int command_changed(const CommandLog *log, const char *path, const char *cmd) {
+    int i = find_entry(log, path);
+    if (i < 0) return 1;
+    return log->hashes[i] != hash_bytes(cmd, strlen(cmd), HASH_SEED);
+}
+
+int read_depfile(const char *depfile, StrList *out) {
+    char *data = read_file(depfile, NULL);
+    if (!data) return -1;
+
+    // Skip the target: everything up to the first colon that is followed by
+    // whitespace. That leaves drive letters like "C:\" alone.
+    char *p = data;
+    while (*p && !(p[0] == ':' && (p[1] == ' ' || p[1] == '\t' || p[1] == '\n' || p[1] == '\r' || !p[1]))) p++;
+    if (*p) p++;
+
+    StrBuf word = {0};
+    for (;;) {
+        int end_of_rule = (*p == '\0') || (*p == '\n');
+        int separator = end_of_rule || *p == ' ' || *p == '\t' || *p == '\r';
+
+        if (p[0] == '\\' && (p[1] == '\n' || (p[1] == '\r' && p[2] == '\n'))) {
+            p += (p[1] == '\r') ? 3 : 2;
+            separator = 1;
+            end_of_rule = 0;
+        }
+        else if (p[0] == '\\' && p[1] == ' ') {
+            sb_append(&word, " ", 1);
+            p += 2;
+            continue;
+        }
+        else if (p[0] == '$' && p[1] == '$') {
+            sb_append(&word, "$", 1);
+            p += 2;
+            continue;
+        }
+
+        if (separator) {
+            if (word.len > 0) {
+                strlist_push(out, strdup(word.data));
+                word.len = 0;
+                word.data[0] = '\0';
+            }
+            if (end_of_rule) break;
+            if (*p == ' ' || *p == '\t' || *p == '\r') p++;
+            continue;
+        }
+
+        sb_append(&word, p, 1);
+        p++;
+    }
+
+    sb_free(&word);
+    free(data);
+    return 0;
+}
+
+StaleReason check_object(const CommandLog *log, const char *src, const char *obj,
+                         const char *dep, const char *cmd, const StrList *scanned, char **detail) {
+    *detail = NULL;
+
+    long long obj_time = file_mtime(obj);
+    if (obj_time < 0) return STALE_MISSING_OUTPUT;
+
+    long long src_time = file_mtime(src);
+    if (src_time < 0 || src_time > obj_time) return STALE_NEWER_SOURCE;
+
+    if (command_changed(log, obj, cmd)) return STALE_CHANGED_FLAGS;
+
+    StrList prereqs = {0};
+    if (read_depfile(dep, &prereqs) != 0) {
+        if (!scanned) {
+            *detail = strdup(dep);
+            return STALE_NO_DEPFILE;
+        }
+
+        // No depfile, but the include scanner knows the headers well enough to
+        // save a compile when none of them changed.
+        for (int i = 0; i < scanned->count; i++) {
+            long long t = file_mtime(scanned->items[i]);
+            if (t < 0 || t > obj_time) {
+                *detail = strdup(scanned->items[i]);
+                return STALE_CHANGED_HEADER;
+            }
+        }
+        return STALE_NONE;
+    }
+
+    StaleReason reason = STALE_NONE;
+    for (int i = 0; i < prereqs.count; i++) {
+        long long t = file_mtime(prereqs.items[i]);
+
+        // A header that vanished counts as changed — the source will now either
+        // pick up a different one or fail, and both need a compile to find out.
+        if (t < 0 || t > obj_time) {
+            reason = strcmp(prereqs.items[i], src) == 0 ? STALE_NEWER_SOURCE : STALE_CHANGED_HEADER;
+            *detail = strdup(prereqs.items[i]);
+            break;
+        }
+    }
+
+    strlist_free(&prereqs);
+    return reason;
+}
+
+StaleReason check_output(CommandLog *log, const char *output, const StrList *inputs,
+                         const char *cmd, char **detail) {
+    *detail = NULL;
+
+    long long out_time = file_mtime(output);
+    if (out_time < 0) return STALE_MISSING_OUTPUT;
+
+    if (command_changed(log, output, cmd)) return STALE_CHANGED_FLAGS;
+
+    // Early cutoff: objects that were recompiled into the same bytes don't count.
+    int k = find_entry(log, output);
+    if (k >= 0 && log->contents[k] != 0) {
+        if (inputs_digest(log, inputs) == log->contents[k]) return STALE_NONE;
+        for (int i = 0; i < inputs->count && !*detail; i++) {
+            if (file_mtime(inputs->items[i]) > out_time) *detail = strdup(inputs->items[i]);
+        }
+        return STALE_NEWER_INPUT;
+    }
+
+    for (int i = 0; i < inputs->count; i++) {
+        long long t = file_mtime(inputs->items[i]);
+        if (t < 0 || t > out_time) {
+            *detail = strdup(inputs->items[i]);
+            return STALE_NEWER_INPUT;
+        }
+    }
+
+    return STALE_NONE;
+}
+
+const char *stale_reason_text(StaleReason reason) {
+    switch (reason) {
+        case STALE_NONE:            return "up to date";
+        case STALE_MISSING_OUTPUT:  return "missing output";
+        case STALE_NEWER_SOURCE:    return "newer source";
+        case STALE_CHANGED_HEADER:  return "changed header";
+        case STALE_CHANGED_FLAGS:   return "changed flags";
+        case STALE_NO_DEPFILE:      return "missing depfile";
+        case STALE_NEWER_INPUT:     return "newer input";
+        case STALE_CHANGED_MODULE:  return "changed module";
+    }
+    return "unknown";
+}
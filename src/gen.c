@@ -0,0 +1,211 @@
+/* ****************************************************************************************************
+ * gen.c - Implementation of the parser for gen=. Running the rules is the build's business and lives
+ * in build.c, next to the compiles that wait for them; here the lines become rules, the rules learn
+ * which of the others they wait for, and they are put in an order the build can run them in.
+ *
+ * Files are matched by their spelling: "./gen/lexer.c" and "gen/lexer.c" are two different files to
+ * the dependency check, the same way they are two different sources in src=.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created.                                                         Version: 00.01
+ * **************************************************************************************************** */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "gen.h"
+#include "util.h"
+
+// The extensions of generated files that are compiled: C, C++ and C++ module units.
+static const char *const SOURCE_EXTS[] = {
+    ".c", ".cc", ".cpp", ".cxx", ".c++", ".cppm", ".ccm", ".cxxm", ".c++m", ".ixx", ".mpp"
+};
+
+int is_generated_source(const char *path) {
+    const char *slash = strrchr(path, '/');
+    const char *dot = strrchr(slash ? slash : path, '.');
+    if (!dot) return 0;
+
+    for (size_t i = 0; i < sizeof(SOURCE_EXTS) / sizeof(SOURCE_EXTS[0]); i++) {
+        if (strcmp(dot, SOURCE_EXTS[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+// --------------------------------------------------------------------------------
+// Split one line of gen= into a rule. The line is changed in the process.
+//
+// @param line    One rule, "outputs: inputs | command"
+// @param rule    Rule to fill in
+// @param errmsg  Set to an allocated message if the line isn't a rule
+// @return        0 on success, -1 on failure
+// --------------------------------------------------------------------------------
+static int parse_rule(char *line, GenRule *rule, char **errmsg) {
+    char *colon = line;
+    while ((colon = strchr(colon, ':')) && colon[1] && !isspace((unsigned char)colon[1])) colon++;
+    char *bar = colon ? strchr(colon, '|') : NULL;
+    if (!bar) {
+        *errmsg = str_printf("gen= needs outputs, a colon, inputs, a bar and a command: %s", line);
+        return -1;
+    }
+
+    *colon = '\0';
+    *bar = '\0';
+    char *cmd = bar + 1;
+    while (isspace((unsigned char)*cmd)) cmd++;
+    size_t len = strlen(cmd);
+    while (len > 0 && isspace((unsigned char)cmd[len - 1])) cmd[--len] = '\0';
+
+    split_words(line, &rule->outputs);
+    split_words(colon + 1, &rule->inputs);
+    rule->cmd = strdup(cmd);
+    if (rule->outputs.count == 0 || len == 0) {
+        *errmsg = str_printf("gen= rule without %s: %s", rule->outputs.count ? "a command" : "an output",
+                             rule->outputs.count ? rule->outputs.items[0] : cmd);
+        return -1;
+    }
+    return 0;
+}
+
+// --------------------------------------------------------------------------------
+// Find the rule that writes a file.
+//
+// @return  Index of the rule, -1 if the file isn't generated
+// --------------------------------------------------------------------------------
+static int find_writer(const GenRule *rules, int count, const char *path) {
+    for (int i = 0; i < count; i++) {
+        for (int o = 0; o < rules[i].outputs.count; o++) {
+            if (strcmp(rules[i].outputs.items[o], path) == 0) return i;
+        }
+    }
+    return -1;
+}
+
+// --------------------------------------------------------------------------------
+// Fill in the deps of every rule and reorder the rules so every one follows the
+// rules it depends on; the order of gen= is kept where it doesn't matter.
+//
+// @return  0 on success, -1 if the rules depend on each other in a cycle
+// --------------------------------------------------------------------------------
+static int order_rules(GenRule *rules, int count, char **errmsg) {
+    for (int j = 0; j < count; j++) {
+        GenRule *r = &rules[j];
+        r->deps = malloc(sizeof(int) * ((size_t)r->inputs.count + 1));
+        for (int i = 0; r->deps && i < r->inputs.count; i++) {
+            int w = find_writer(rules, count, r->inputs.items[i]);
+            int known = 0;
+            for (int d = 0; d < r->ndeps && !known; d++) known = r->deps[d] == w;
+            if (w >= 0 && !known) r->deps[r->ndeps++] = w;
+        }
+    }
+
+    // Take the first rule whose dependencies are all placed, until none is left.
+    int *order = malloc(sizeof(int) * ((size_t)count + 1));
+    int *position = malloc(sizeof(int) * ((size_t)count + 1));
+    if (!order || !position) {
+        free(order);
+        free(position);
+        *errmsg = strdup("Memory allocation failed for the gen= rules.");
+        return -1;
+    }
+    for (int i = 0; i < count; i++) position[i] = -1;
+
+    for (int placed = 0; placed < count; placed++) {
+        int next = -1;
+        for (int j = 0; j < count && next < 0; j++) {
+            if (position[j] >= 0) continue;
+            int ready = 1;
+            for (int d = 0; d < rules[j].ndeps && ready; d++) ready = position[rules[j].deps[d]] >= 0;
+            if (ready) next = j;
+        }
+        if (next < 0) {
+            for (int j = 0; j < count && next < 0; j++) if (position[j] < 0) next = j;
+            *errmsg = str_printf("gen= rules depend on each other in a cycle: %s",
+                                 rules[next].outputs.items[0]);
+            free(order);
+            free(position);
+            return -1;
+        }
+        position[next] = placed;
+        order[placed] = next;
+    }
+
+    GenRule *sorted = malloc(sizeof(GenRule) * ((size_t)count + 1));
+    if (sorted) {
+        for (int i = 0; i < count; i++) {
+            sorted[i] = rules[order[i]];
+            for (int d = 0; d < sorted[i].ndeps; d++) sorted[i].deps[d] = position[sorted[i].deps[d]];
+        }
+        memcpy(rules, sorted, sizeof(GenRule) * (size_t)count);
+        free(sorted);
+    }
+    free(order);
+    free(position);
+    return 0;
+}
+
+int parse_gen_rules(const char *gen, GenRule **rules, int *count, char **errmsg) {
+    *rules = NULL;
+    *count = 0;
+
+    int lines = 1;
+    for (const char *p = gen; *p; p++) lines += *p == '\n';
+    GenRule *list = calloc((size_t)lines, sizeof(GenRule));
+    if (!list) {
+        *errmsg = strdup("Memory allocation failed for the gen= rules.");
+        return -1;
+    }
+
+    int n = 0, rc = 0;
+    for (const char *p = gen; *p && rc == 0;) {
+        size_t len = strcspn(p, "\n");
+        char *line = str_printf("%.*s", (int)len, p);
+        char *start = line;
+        while (isspace((unsigned char)*start)) start++;
+        if (*start) rc = parse_rule(start, &list[n++], errmsg);
+        free(line);
+        p += len;
+        if (*p) p++;
+    }
+
+    // A file written by two rules would be whatever the later one left.
+    for (int i = 0; i < n && rc == 0; i++) {
+        for (int o = 0; o < list[i].outputs.count && rc == 0; o++) {
+            const char *out = list[i].outputs.items[o];
+            int w = find_writer(list, n, out);
+            for (int k = o + 1; k < list[i].outputs.count && w == i; k++) {
+                if (strcmp(list[i].outputs.items[k], out) == 0) w = -1;
+            }
+            if (w != i) {
+                *errmsg = str_printf("gen= rules write the same file twice: %s", out);
+                rc = -1;
+            }
+        }
+    }
+    if (rc == 0) rc = order_rules(list, n, errmsg);
+
+    if (rc != 0) {
+        free_gen_rules(list, n);
+        return -1;
+    }
+    *rules = list;
+    *count = n;
+    return 0;
+}
+
+void free_gen_rules(GenRule *rules, int count) {
+    if (!rules) return;
+    for (int i = 0; i < count; i++) {
+        free(rules[i].cmd);
+        free(rules[i].deps);
+        strlist_free(&rules[i].outputs);
+        strlist_free(&rules[i].inputs);
+    }
+    free(rules);
+}
@@ -0,0 +1,501 @@
+/* ****************************************************************************************************
+ * jobs.c - Implementation of the concurrent job pool. On Unix-like systems every job is forked into a
+ * "/bin/sh -c" child whose stdout and stderr share one pipe. The parent waits on all pipes with poll(),
+ * so no child ever blocks on a full pipe, and collects the output in memory until the job is done.
+ * poll() rather than epoll keeps this working on MacOS as well as Linux; with a few dozen pipes the
+ * difference doesn't matter.
+ *
+ * Every child becomes the leader of its own process group. That way a SIGTERM sent to the group
+ * reaches the compiler itself and not just the shell that started it, which is what lets fail-fast
+ * mode stop all running compilers within milliseconds of the first error.
+ *
+ * Windows has no fork() and no poll() on pipes, so there the jobs run one after the other through
+ * system() and their output goes straight to the console.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created.                                                         Version: 00.01
+ * Sun 2026-10-18 Job dependencies, fail-fast cancellation and keep-going mode.         Version: 00.02
+ * Sun 2026-10-18 Children are reaped with wait4() to record their resource usage.      Version: 00.03
+ * Sun 2026-10-18 Jobs may run a function in the child instead of a shell command.      Version: 00.04
+ * Sun 2026-10-18 Finished jobs can go to a progress callback instead of stdout.        Version: 00.05
+ * Sun 2026-10-18 Jobs that run past their timeout are killed.                          Version: 00.06
+ * Sun 2026-10-18 The pool's dispatch hook places every job right before it starts.     Version: 00.07
+ * Sun 2026-10-18 SIGINT and SIGTERM are only caught with pool->catch_signals.          Version: 00.08
+ * **************************************************************************************************** */
+#define _POSIX_C_SOURCE 200809L
+
+// wait4() isn't POSIX, but it is the only way to get the resource usage of one
+// particular child while others are still running. Both glibc and MacOS hide it
+// in strict mode unless asked.
+#define _DEFAULT_SOURCE
+#define _DARWIN_C_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "jobs.h"
+#include "util.h"
+#include "debug.h"
+
+// --------------------------------------------------------------------------------
+// Write the progress line of a finished job and everything the job printed. The
+// progress line goes to stdout, the compiler's diagnostics to stderr. Both are
+// flushed right away so the next job's output can't get in between. A progress
+// callback of the pool gets the job instead.
+// --------------------------------------------------------------------------------
+static void report_job(const JobPool *pool, const Job *job, int done, int count) {
+    if (pool->progress) {
+        pool->progress(job, done, count, pool->progress_ctx);
+        return;
+    }
+
+    printf("[%d/%d] %s\n", done, count, job->label);
+    fflush(stdout);
+
+    if (job->output_len > 0) {
+        fwrite(job->output, 1, job->output_len, stderr);
+        if (job->output[job->output_len - 1] != '\n') fputc('\n', stderr);
+    }
+    if (job->status == JOB_TIMED_OUT) {
+        fprintf(stderr, "TIMED OUT after %gs: %s\n", job->timeout, job->cmd);
+    }
+    else if (job->status != 0) {
+        fprintf(stderr, "FAILED: %s\n", job->cmd);
+    }
+    fflush(stderr);
+}
+
+void free_job(Job *job) {
+    free(job->cmd);
+    free(job->label);
+    free(job->deps);
+    free(job->output);
+    job->cmd = NULL;
+    job->label = NULL;
+    job->deps = NULL;
+    job->ndeps = 0;
+    job->output = NULL;
+    job->output_len = 0;
+}
+
+#ifdef _WIN32
+
+#include <windows.h>
+
+int default_job_count(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+}
+
+int run_jobs(Job *jobs, int count, JobPool *pool) {
+    int failed = 0;
+
+    for (int i = 0; i < count; i++) jobs[i].status = JOB_NOT_RUN;
+    pool->peak_parallel = count > 0 ? 1 : 0;
+
+    for (int i = 0; i < count && (pool->keep_going || failed == 0); i++) {
+        int blocked = 0;
+        for (int d = 0; d < jobs[i].ndeps; d++) blocked |= (jobs[jobs[i].deps[d]].status != 0);
+        if (blocked) {
+            jobs[i].status = JOB_SKIPPED;
+            continue;
+        }
+
+        // Nothing else runs, so dispatch can't hold the job back.
+        if (pool->dispatch) pool->dispatch(&jobs[i], i, pool->dispatch_ctx);
+        fflush(stdout);
+        double start = now_seconds();
+        jobs[i].status = jobs[i].fn ? jobs[i].fn(jobs[i].arg) : system(jobs[i].cmd);
+        jobs[i].wall = now_seconds() - start;
+        if (pool->release) pool->release(&jobs[i], i, pool->dispatch_ctx);
+        report_job(pool, &jobs[i], i + 1, count);
+        if (jobs[i].status != 0) failed++;
+    }
+
+    return failed;
+}
+
+#else
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+// A job that is currently running: its process id, the read end of its output
+// pipe, the index of the job it belongs to, and the output collected so far.
+typedef struct {
+    pid_t pid;
+    int fd;
+    int job;
+    int cancelled;
+    int timed_out;
+    double start;
+    StrBuf out;
+} Slot;
+
+// Set by the signal handler when pmake itself is asked to stop. The main loop
+// notices it as soon as poll() is interrupted.
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_stop_signal(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+int default_job_count(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n > 0) return (int)n;
+#endif
+    return 1;
+}
+
+// --------------------------------------------------------------------------------
+// Fork a child that runs the job's command through /bin/sh, or its function, with
+// stdout and stderr redirected into a fresh pipe. The child gets its own process
+// group so it can be terminated together with everything it started. The read end
+// is marked close-on-exec so later children don't inherit it.
+//
+// @param job     Job to run
+// @param fd_out  Receives the read end of the output pipe
+// @return        Process id of the child, or -1 on failure
+// --------------------------------------------------------------------------------
+static pid_t spawn_job(const Job *job, int *fd_out) {
+    int fds[2];
+    if (pipe(fds) != 0) return -1;
+
+    // A function job returns through stdio in the child; anything still buffered
+    // here would be written a second time into its pipe.
+    if (job->fn) fflush(NULL);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+
+    if (pid == 0) {
+        setpgid(0, 0);
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        close(fds[0]);
+        dup2(fds[1], STDOUT_FILENO);
+        dup2(fds[1], STDERR_FILENO);
+        close(fds[1]);
+        if (job->fn) {
+            int rc = job->fn(job->arg);
+            fflush(NULL);
+            _exit(rc);
+        }
+        execl("/bin/sh", "sh", "-c", job->cmd, (char *)NULL);
+        _exit(127);
+    }
+
+    // Set the group from the parent side as well, so a kill() right after the
+    // fork can't miss a child that hasn't run setpgid() yet.
+    setpgid(pid, pid);
+    close(fds[1]);
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    *fd_out = fds[0];
+    return pid;
+}
+
+// --------------------------------------------------------------------------------
+// Store what the kernel accounted for a finished child in the job. ru_maxrss is
+// in KiB on Linux and in bytes on MacOS.
+// --------------------------------------------------------------------------------
+static void record_usage(Job *job, const struct rusage *ru) {
+    job->cpu = (double)ru->ru_utime.tv_sec + ru->ru_utime.tv_usec / 1e6
+             + (double)ru->ru_stime.tv_sec + ru->ru_stime.tv_usec / 1e6;
+#ifdef __APPLE__
+    job->max_rss_kb = (long)(ru->ru_maxrss / 1024);
+#else
+    job->max_rss_kb = (long)ru->ru_maxrss;
+#endif
+}
+
+// --------------------------------------------------------------------------------
+// Turn a wait() status into a plain exit code. A child killed by a signal counts
+// as failed with 128 + signal number, the same convention the shell uses.
+// --------------------------------------------------------------------------------
+static int exit_code(int wstatus) {
+    if (WIFEXITED(wstatus)) return WEXITSTATUS(wstatus);
+    if (WIFSIGNALED(wstatus)) return 128 + WTERMSIG(wstatus);
+    return 1;
+}
+
+// The dependency graph turned around: for every job, the jobs that wait for it.
+// Stored as one flat array with an offset table, like a compressed sparse row.
+typedef struct {
+    int *start;     // count + 1 offsets into list
+    int *list;      // dependent job indices
+    int *waiting;   // number of unfinished dependencies per job
+} Graph;
+
+static int build_graph(Graph *g, const Job *jobs, int count) {
+    int edges = 0;
+    for (int i = 0; i < count; i++) edges += jobs[i].ndeps;
+
+    g->start = calloc((size_t)count + 1, sizeof(int));
+    g->list = malloc(sizeof(int) * (size_t)(edges > 0 ? edges : 1));
+    g->waiting = calloc((size_t)count + 1, sizeof(int));
+    int *fill = calloc((size_t)count + 1, sizeof(int));
+    if (!g->start || !g->list || !g->waiting || !fill) {
+        free(fill);
+        return -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        g->waiting[i] = jobs[i].ndeps;
+        for (int d = 0; d < jobs[i].ndeps; d++) g->start[jobs[i].deps[d] + 1]++;
+    }
+    for (int i = 0; i < count; i++) g->start[i + 1] += g->start[i];
+    for (int i = 0; i < count; i++) {
+        for (int d = 0; d < jobs[i].ndeps; d++) {
+            int dep = jobs[i].deps[d];
+            g->list[g->start[dep] + fill[dep]++] = i;
+        }
+    }
+
+    free(fill);
+    return 0;
+}
+
+static void free_graph(Graph *g) {
+    free(g->start);
+    free(g->list);
+    free(g->waiting);
+}
+
+// --------------------------------------------------------------------------------
+// Mark everything that (directly or indirectly) depends on a failed job as
+// skipped. Returns the number of jobs that were newly skipped.
+// --------------------------------------------------------------------------------
+static int skip_dependents(Job *jobs, const Graph *g, int failed_job) {
+    int skipped = 0;
+    for (int k = g->start[failed_job]; k < g->start[failed_job + 1]; k++) {
+        int d = g->list[k];
+        if (jobs[d].status != JOB_NOT_RUN) continue;
+        jobs[d].status = JOB_SKIPPED;
+        skipped += 1 + skip_dependents(jobs, g, d);
+    }
+    return skipped;
+}
+
+// --------------------------------------------------------------------------------
+// Terminate every running job by signalling its whole process group. The slots
+// stay in place so the main loop can still reap the children.
+// --------------------------------------------------------------------------------
+static void cancel_running(Slot *slots, int running) {
+    for (int i = 0; i < running; i++) {
+        if (slots[i].cancelled) continue;
+        slots[i].cancelled = 1;
+        kill(-slots[i].pid, SIGTERM);
+        debug("cancelled job %d (pid %d)\n", slots[i].job, (int)slots[i].pid);
+    }
+}
+
+// --------------------------------------------------------------------------------
+// Kill the running jobs that are past their timeout and return how long poll()
+// may wait for the next one to expire: milliseconds, or -1 if no running job has
+// a timeout. SIGKILL rather than SIGTERM, a hanging test may ignore the latter.
+// --------------------------------------------------------------------------------
+static int expire_timeouts(Slot *slots, int running, const Job *jobs) {
+    double now = now_seconds();
+    double wait = -1;
+
+    for (int i = 0; i < running; i++) {
+        Slot *s = &slots[i];
+        double timeout = jobs[s->job].timeout;
+        if (timeout <= 0 || s->cancelled || s->timed_out) continue;
+
+        double left = s->start + timeout - now;
+        if (left <= 0) {
+            s->timed_out = 1;
+            kill(-s->pid, SIGKILL);
+            debug("job %d (pid %d) timed out\n", s->job, (int)s->pid);
+        }
+        else if (wait < 0 || left < wait) wait = left;
+    }
+    if (wait < 0) return -1;
+    return wait > 86400 ? 86400 * 1000 : (int)(wait * 1000) + 1;
+}
+
+int run_jobs(Job *jobs, int count, JobPool *pool) {
+    pool->peak_parallel = 0;
+    if (count <= 0) return 0;
+
+    int keep_going = pool->keep_going;
+    int max_parallel = pool->max_parallel;
+    if (max_parallel < 1) max_parallel = 1;
+    if (max_parallel > count) max_parallel = count;
+
+    Graph g = {0};
+    Slot *slots = calloc((size_t)max_parallel, sizeof(Slot));
+    struct pollfd *pfds = calloc((size_t)max_parallel, sizeof(struct pollfd));
+    int *ready = malloc(sizeof(int) * (size_t)count);
+    if (!slots || !pfds || !ready || build_graph(&g, jobs, count) != 0) {
+        free(slots);
+        free(pfds);
+        free(ready);
+        free_graph(&g);
+        return count;
+    }
+
+    // Catch interrupts while children are running, if the caller wants that; a
+    // program that embeds libpmake keeps its own handlers. No SA_RESTART, so a
+    // signal wakes up poll() with EINTR and the loop can react right away.
+    struct sigaction sa, old_int, old_term;
+    stop_requested = 0;
+    if (pool->catch_signals) {
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = on_stop_signal;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGINT, &sa, &old_int);
+        sigaction(SIGTERM, &sa, &old_term);
+    }
+
+    // The ready queue holds jobs whose dependencies are all done, in array order
+    // to begin with. Every job enters it at most once, so it never overflows.
+    int head = 0, tail = 0;
+    for (int i = 0; i < count; i++) {
+        jobs[i].status = JOB_NOT_RUN;
+        if (g.waiting[i] == 0) ready[tail++] = i;
+    }
+
+    // settled counts every job whose fate is decided, done only those that actually
+    // ran — the progress line shouldn't jump ahead because of skipped jobs.
+    int running = 0, settled = 0, done = 0, failed = 0, stopping = 0;
+    char buf[8192];
+
+    while (settled < count) {
+
+        if (stop_requested && !stopping) {
+            stopping = 1;
+            cancel_running(slots, running);
+        }
+
+        // Fill every free slot with the next job that is ready to go.
+        while (!stopping && running < max_parallel && head < tail) {
+            // A job held back waits at the head of the queue for the next free slot.
+            if (pool->dispatch && pool->dispatch(&jobs[ready[head]], ready[head], pool->dispatch_ctx) != 0) {
+                break;
+            }
+
+            Slot *s = &slots[running];
+            memset(s, 0, sizeof(*s));
+            s->job = ready[head++];
+            s->start = now_seconds();
+            s->pid = spawn_job(&jobs[s->job], &s->fd);
+            if (s->pid < 0) {
+                jobs[s->job].status = 127;
+                if (pool->release) pool->release(&jobs[s->job], s->job, pool->dispatch_ctx);
+                report_job(pool, &jobs[s->job], ++done, count);
+                settled += 1 + skip_dependents(jobs, &g, s->job);
+                failed++;
+                if (!keep_going) stopping = 1;
+                continue;
+            }
+            debug("started job %d (pid %d): %s\n", s->job, (int)s->pid, jobs[s->job].cmd);
+            running++;
+            if (running > pool->peak_parallel) pool->peak_parallel = running;
+        }
+        if (running <= 0) break;
+
+        for (int i = 0; i < running; i++) {
+            pfds[i].fd = slots[i].fd;
+            pfds[i].events = POLLIN;
+            pfds[i].revents = 0;
+        }
+
+        if (poll(pfds, (nfds_t)running, expire_timeouts(slots, running, jobs)) < 0) {
+            if (errno == EINTR) continue;
+            perror("poll");
+            cancel_running(slots, running);
+            stopping = 1;
+            continue;
+        }
+
+        // Drain every pipe that has something to say. A read of zero bytes means
+        // the child closed its end — the job is finished and can be reaped.
+        for (int i = running - 1; i >= 0; i--) {
+            if (!pfds[i].revents) continue;
+
+            ssize_t n = read(slots[i].fd, buf, sizeof(buf));
+            if (n > 0) {
+                sb_append(&slots[i].out, buf, (size_t)n);
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+
+            Slot *s = &slots[i];
+            Job *job = &jobs[s->job];
+            int wstatus = 0;
+            struct rusage ru;
+
+            close(s->fd);
+            memset(&ru, 0, sizeof(ru));
+            while (wait4(s->pid, &wstatus, 0, &ru) < 0 && errno == EINTR) {}
+            job->wall = now_seconds() - s->start;
+            record_usage(job, &ru);
+            settled++;
+
+            if (s->cancelled) {
+                // Whatever a terminated compiler managed to print is noise.
+                job->status = JOB_CANCELLED;
+                sb_free(&s->out);
+                if (pool->release) pool->release(job, s->job, pool->dispatch_ctx);
+            } else {
+                job->status = s->timed_out ? JOB_TIMED_OUT : exit_code(wstatus);
+                job->output = s->out.data;
+                job->output_len = s->out.len;
+                if (pool->release) pool->release(job, s->job, pool->dispatch_ctx);
+                report_job(pool, job, ++done, count);
+
+                if (job->status != 0) {
+                    failed++;
+                    settled += skip_dependents(jobs, &g, s->job);
+                    if (!keep_going && !stopping) {
+                        stopping = 1;
+                        cancel_running(slots, running);
+                    }
+                } else {
+                    for (int k = g.start[s->job]; k < g.start[s->job + 1]; k++) {
+                        int d = g.list[k];
+                        if (--g.waiting[d] == 0 && jobs[d].status == JOB_NOT_RUN) ready[tail++] = d;
+                    }
+                }
+            }
+
+            // Keep the running slots packed at the front of the array.
+            slots[i] = slots[running - 1];
+            pfds[i] = pfds[running - 1];
+            running--;
+        }
+    }
+
+    if (pool->catch_signals) {
+        sigaction(SIGINT, &old_int, NULL);
+        sigaction(SIGTERM, &old_term, NULL);
+    }
+
+    free(slots);
+    free(pfds);
+    free(ready);
+    free_graph(&g);
+    return failed;
+}
+
+#endif
@@ -0,0 +1,275 @@
+/* ****************************************************************************************************
+ * libpmake.c - Implementation of the public API in pmake.h. The functions are thin wrappers around the
+ * parser and the build: a PmakeProject is a parsed Makefile plus the list of outputs worked out once
+ * at load time, and the public option, step and summary structs are translated into the internal
+ * ones at the border, so the internal headers can change without breaking embedders.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created.                                                         Version: 00.01
+ * Sun 2026-10-18 pmake_get() knows objdir.                                             Version: 00.02
+ * Sun 2026-10-18 pmake_test(), pmake_get() knows tests.                                Version: 00.03
+ * Sun 2026-10-18 pmake_pgo(), pmake_get() knows pgo.                                   Version: 00.04
+ * Sun 2026-10-18 pmake_get() knows pkg.                                                Version: 00.05
+ * Sun 2026-10-18 pmake_get() knows gen.                                                Version: 00.06
+ * Sun 2026-10-18 Passes catch_signals on to the build.                                 Version: 00.07
+ * **************************************************************************************************** */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include "pmake.h"
+#include "parse.h"
+#include "build.h"
+#include "compdb.h"
+#include "toolchain.h"
+#include "scan.h"
+#include "tests.h"
+#include "pgo.h"
+#include "util.h"
+
+struct PmakeProject {
+    Makefile *mf;
+    StrList outputs;
+};
+
+// The progress callback of the caller, reached through the job pool's context pointer.
+typedef struct {
+    PmakeProgress fn;
+    void *user;
+} ProgressBridge;
+
+int pmake_api_version(void) {
+    return PMAKE_API_VERSION;
+}
+
+void pmake_default_options(PmakeOptions *opts) {
+    BuildOptions defaults;
+    TestOptions tests;
+    default_build_options(&defaults);
+    default_test_options(&tests);
+
+    memset(opts, 0, sizeof(*opts));
+    opts->jobs = defaults.jobs;
+    opts->shard = tests.shard;
+    opts->shards = tests.shards;
+    opts->test_timeout = tests.timeout;
+}
+
+char *pmake_config_file(const char *name) {
+    return normalize_filename(name);
+}
+
+// --------------------------------------------------------------------------------
+// Wrap a freshly parsed configuration into a project.
+// --------------------------------------------------------------------------------
+static PmakeProject *make_project(Makefile *mf, char **errmsg) {
+    if (!mf) return NULL;
+
+    PmakeProject *project = calloc(1, sizeof(PmakeProject));
+    if (!project) {
+        *errmsg = strdup("Memory allocation failed for the project.");
+        free_makefile(mf);
+        return NULL;
+    }
+    project->mf = mf;
+    build_outputs(mf, &project->outputs);
+    return project;
+}
+
+PmakeProject *pmake_load(const char *path, char **errmsg) {
+    *errmsg = NULL;
+    return make_project(parse(path, errmsg), errmsg);
+}
+
+PmakeProject *pmake_load_string(const char *text, char **errmsg) {
+    *errmsg = NULL;
+    return make_project(parse_string(text, errmsg), errmsg);
+}
+
+void pmake_free(PmakeProject *project) {
+    if (!project) return;
+    free_makefile(project->mf);
+    strlist_free(&project->outputs);
+    free(project);
+}
+
+void pmake_free_string(char *s) {
+    free(s);
+}
+
+const char *pmake_get(const PmakeProject *project, const char *key) {
+    const Makefile *mf = project->mf;
+    if (strcmp(key, "comp") == 0)    return mf->comp;
+    if (strcmp(key, "flags") == 0)   return mf->flags;
+    if (strcmp(key, "target") == 0)  return mf->target;
+    if (strcmp(key, "project") == 0) return mf->project;
+    if (strcmp(key, "bin") == 0)     return mf->bin;
+    if (strcmp(key, "src") == 0)     return mf->src;
+    if (strcmp(key, "libs") == 0)    return mf->libs;
+    if (strcmp(key, "workers") == 0) return mf->workers;
+    if (strcmp(key, "lang") == 0)    return mf->lang;
+    if (strcmp(key, "debug") == 0)   return mf->debug;
+    if (strcmp(key, "objdir") == 0)  return mf->objdir;
+    if (strcmp(key, "tests") == 0)   return mf->tests;
+    if (strcmp(key, "pgo") == 0)     return mf->pgo;
+    if (strcmp(key, "pkg") == 0)     return mf->pkg;
+    if (strcmp(key, "gen") == 0)     return mf->gen;
+    return NULL;
+}
+
+const char *pmake_output(const PmakeProject *project, int i) {
+    return i >= 0 && i < project->outputs.count ? project->outputs.items[i] : NULL;
+}
+
+// --------------------------------------------------------------------------------
+// Hand a finished job to the caller's callback as a PmakeStep.
+// --------------------------------------------------------------------------------
+static void forward_progress(const Job *job, int done, int count, void *ctx) {
+    const ProgressBridge *bridge = ctx;
+    PmakeStep step;
+    step.label = job->label;
+    step.command = job->cmd;
+    step.status = job->status;
+    step.output = job->output;
+    step.output_len = job->output_len;
+    step.wall = job->wall;
+    step.done = done;
+    step.total = count;
+    bridge->fn(&step, bridge->user);
+}
+
+// --------------------------------------------------------------------------------
+// Translate the public options into the build's. The statistics of the build go
+// to stats, steps to the caller's callback through bridge.
+// --------------------------------------------------------------------------------
+static void to_build_options(const PmakeOptions *opts, BuildOptions *build, BuildStats *stats,
+                             ProgressBridge *bridge) {
+    default_build_options(build);
+    memset(stats, 0, sizeof(*stats));
+    if (opts->jobs > 0) build->jobs = opts->jobs;
+    build->keep_going = opts->keep_going;
+    build->dry_run = opts->dry_run;
+    build->explain = opts->explain;
+    build->stats = opts->stats;
+    build->stats_json = opts->stats_json;
+    build->catch_signals = opts->catch_signals;
+    if (opts->progress) {
+        bridge->fn = opts->progress;
+        bridge->user = opts->user;
+        build->progress = forward_progress;
+        build->progress_ctx = bridge;
+    }
+    build->report = stats;
+}
+
+// --------------------------------------------------------------------------------
+// Fill the public summary from the statistics of a build and what its tests did.
+// --------------------------------------------------------------------------------
+static void to_summary(const BuildStats *stats, const TestSummary *tests, PmakeSummary *summary) {
+    memset(summary, 0, sizeof(*summary));
+    summary->wall = stats->wall;
+    summary->cpu = stats->cpu;
+    summary->units = stats->units;
+    summary->compiled = stats->compiled;
+    summary->up_to_date = stats->up_to_date;
+    summary->failed = stats->failed;
+    summary->not_built = stats->not_built;
+    summary->linked = stats->linked;
+    if (tests) {
+        summary->tests_run = tests->run;
+        summary->tests_passed = tests->passed;
+        summary->tests_failed = tests->failed;
+        summary->tests_timed_out = tests->timed_out;
+    }
+}
+
+PmakeResult pmake_build(PmakeProject *project, const PmakeOptions *opts, PmakeSummary *summary,
+                        char **errmsg) {
+    PmakeOptions defaults;
+    if (!opts) {
+        pmake_default_options(&defaults);
+        opts = &defaults;
+    }
+    *errmsg = NULL;
+
+    BuildOptions build;
+    BuildStats stats;
+    ProgressBridge bridge;
+    to_build_options(opts, &build, &stats, &bridge);
+
+    BuildResult result = run(project->mf, &build, errmsg);
+
+    if (summary) to_summary(&stats, NULL, summary);
+    free_stats(&stats);
+    return (PmakeResult)result;
+}
+
+PmakeResult pmake_test(PmakeProject *project, const PmakeOptions *opts, PmakeSummary *summary,
+                       char **errmsg) {
+    PmakeOptions defaults;
+    if (!opts) {
+        pmake_default_options(&defaults);
+        opts = &defaults;
+    }
+    *errmsg = NULL;
+
+    BuildOptions build;
+    BuildStats stats;
+    ProgressBridge bridge;
+    TestOptions tests;
+    TestSummary done;
+    to_build_options(opts, &build, &stats, &bridge);
+    tests.shard = opts->shard;
+    tests.shards = opts->shards;
+    tests.timeout = opts->test_timeout;
+
+    BuildResult result = run_tests(project->mf, &build, &tests, &done, errmsg);
+
+    if (summary) to_summary(&stats, &done, summary);
+    free_stats(&stats);
+    return (PmakeResult)result;
+}
+
+PmakeResult pmake_pgo(PmakeProject *project, const PmakeOptions *opts, PmakeSummary *summary,
+                      char **errmsg) {
+    PmakeOptions defaults;
+    if (!opts) {
+        pmake_default_options(&defaults);
+        opts = &defaults;
+    }
+    *errmsg = NULL;
+
+    BuildOptions build;
+    BuildStats stats;
+    ProgressBridge bridge;
+    to_build_options(opts, &build, &stats, &bridge);
+
+    BuildResult result = run_pgo(project->mf, &build, errmsg);
+
+    if (summary) to_summary(&stats, NULL, summary);
+    free_stats(&stats);
+    return (PmakeResult)result;
+}
+
+PmakeResult pmake_write_compdb(PmakeProject *project, const char *path, char **errmsg) {
+    *errmsg = NULL;
+    return (PmakeResult)write_compdb(project->mf, path ? path : COMPDB_FILE, errmsg);
+}
+
+PmakeResult pmake_print_toolchain(PmakeProject *project) {
+    Toolchain tc;
+    probe_toolchain(project->mf->comp, &tc);
+    print_toolchain(&tc);
+    PmakeResult result = tc.path ? PMAKE_OK : PMAKE_CONFIG_ERROR;
+    free_toolchain(&tc);
+    return result;
+}
+
+PmakeResult pmake_print_scanned_deps(PmakeProject *project, int threads, char **errmsg) {
+    *errmsg = NULL;
+    return (PmakeResult)print_scanned_deps(project->mf, threads, errmsg);
+}
@@ -3,6 +3,10 @@
  * to format and write help text, manage versioned documentation, and handle user-facing guidance in a
  * cross-platform way. Designed to operate with minimal dependencies while supporting consistency
  * across command-line tools. Compatible with both Unix-like and Windows environments.
+ *
+ * The manual is a constant compiled into the binary. Showing it costs no formatting at all: the text
+ * goes straight into a pipe to the pager. The copy installed in the home directory starts with a
+ * fixed-size version header, so checking whether it is current means reading 16 bytes, not the file.
  * ----------------------------------------------------------------------------------------------------
  * Author:      Patrik Eigenmann
  * eMail:       p.eigenmann@gmx.net
@@ -10,264 +14,461 @@
  * ----------------------------------------------------------------------------------------------------
  * Change Log:
  * Sun 2025-06-23 File created.                                                         Version: 00.01
+ * Sun 2026-10-18 Documented -j/--jobs.                                                 Version: 00.02
+ * Sun 2026-10-18 Documented -k/--keep-going and the exit codes.                        Version: 00.03
+ * Sun 2026-10-18 Documented --compdb.                                                  Version: 00.04
+ * Sun 2026-10-18 Documented -n/--dry-run and --explain.                                Version: 00.05
+ * Sun 2026-10-18 Documented --stats and --stats-json.                                  Version: 00.06
+ * Sun 2026-10-18 Manual compiled in as a constant, shown through $PAGER.               Version: 00.07
+ * Sun 2026-10-18 Documented the workers directive and pmake-worker.                    Version: 00.08
+ * Sun 2026-10-18 Documented --toolchain.                                               Version: 00.09
+ * Sun 2026-10-18 Documented --scan-deps and the include scanner.                       Version: 00.10
+ * Sun 2026-10-18 Documented lang=c++ and C++20 modules.                                Version: 00.11
+ * Sun 2026-10-18 Documented the relink cutoff on unchanged objects.                    Version: 00.12
+ * Sun 2026-10-18 Documented debug=split, dwp and strip.                                Version: 00.13
+ * Sun 2026-10-18 Documented objdir= and the atomic replacement of the output.          Version: 00.14
+ * Sun 2026-10-18 Documented tests= and pmake test.                                     Version: 00.15
+ * Sun 2026-10-18 Documented pgo= and --pgo.                                            Version: 00.16
+ * Sun 2026-10-18 Documented pkg=.                                                      Version: 00.17
+ * Sun 2026-10-18 Documented gen=.                                                      Version: 00.18
+ * Sun 2026-10-18 workers=: units go to free slots, unreachable workers are dropped.    Version: 00.19
+ * Sun 2026-10-18 The installed manual is written to a temporary file and renamed.      Version: 00.20
  * **************************************************************************************************** */
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <stdarg.h>
+#include <errno.h>
 #include "manpage.h"
 #include "version.h"
-
-#define MAX_LINE_LENGTH 256
+#include "util.h"
 
 const char *FILE_EXTENTION = ".man";
 
+// Every installed manual starts with this header followed by the version as "MM.mm" and a newline,
+// 16 bytes in total. The version always sits at the same offset, so one small read tells whether the
+// installed copy belongs to this build.
+#define MANUAL_MAGIC "pmake-man "
+#define MANUAL_HEADER_SIZE (sizeof(MANUAL_MAGIC) - 1 + 6)
+
 #ifdef _WIN32
-    
+
     // Include Windows relevant libraries
     #include <io.h>
-    
-    #define _home() getenv("USERPROFILE")
+    #include <process.h>
 
-    /* ----------------------------------------------------------------------------------------------------
-     * Windows version:
-     * By encapsulating the file existence check within this method, we ensure a seamless and efficient way
-     * to verify the presence of files. This method not only enhances the maintainability and readability of
-     * your codebase, but also guarantees that file existence checks are performed consistently and reliably.
-     * 
-     * Adopting the doesFileExist method will streamline your file handling processes, fostering better
-     * organization and error handling, and ultimately contributing to a more robust and user-friendly product.
-     * 
-     * @param char *filename    - The name of the file to check for existence.
-     * @param int major         - The major # of the verison number.
-     * @param int minor         - The minor # of the version number.
-     * @return int              - Returns 1 if the file exists, and 0 if it does not.
-     * ---------------------------------------------------------------------------------------------------- */
-    static int doesFileExist(char *filename, int major, int minor) {
-
-        // First check if the file even exist
-        int i = (_access(filename, 0) != -1);
-
-        // If it does,
-        if(i > 0) {
-
-            FILE *file;
-            char *buffer;
-            char version[100] = "\0";
-            long file_size;
-
-            // Open the file for reading
-            file = fopen(filename, "r");
-                        
-            // Determine the file size
-            fseek(file, 0, SEEK_END);
-            file_size = ftell(file);
-            rewind(file);
-            
-            // Allocate memory for the buffer
-            buffer = (char *)malloc(sizeof(char) * (file_size + 1));
-            
-            if (buffer == NULL) {
-                printf("Memory allocation failed.\n");
-                fclose(file);
-                return 1;
-            }
-            
-            // Read the file content into the buffer
-            fread(buffer, sizeof(char), file_size, file);
-            
-            // Null-terminate the string
-            buffer[file_size] = '\0';
-            
-            
-            // Close the file
-            fclose(file);
-
-            sprintf(version, "%02d.%02d", major, minor);
-
-            i &= (strstr(buffer, version) != NULL);
-        }
+    #define _home() getenv("USERPROFILE")
+    #define _pid() _getpid()
 
-        return i;
-    }
-    
-    // The command I use under Windows is more. More is the equivalent
+    // The pager I use under Windows is more. More is the equivalent
     // of the UNIX less command.
-    char command[255] = "more ";
+    #define DEFAULT_PAGER "more"
 
-    char *PATH = "\\AppData\\Local\\";
+    const char *PATH = "\\AppData\\Local\\";
 #else
     // Include Unix relevant libraries
     #include <unistd.h>
+    #include <spawn.h>
+    #include <signal.h>
+    #include <sys/wait.h>
+
+    extern char **environ;
 
     #define _home() getenv("HOME")
+    #define _pid() getpid()
 
-    /* -------------------------------------------------------------------------------------------------
-     * MacOS version:
-     * By encapsulating the file existence check within this method, we ensure a seamless and efficient
-     * way to verify the presence of files. This method not only enhances the maintainability and
-     * readability of your codebase, but also guarantees that file existence checks are performed
-     * consistently and reliably.
-     * 
-     * Adopting the doesFileExist method will streamline your file handling processes, fostering better
-     * organization and error handling, and ultimately contributing to a more robust and user-friendly product.
-     * 
-     * @param char *filename    - The name of the file to check for existence.
-     * @param int major         - The major # of the verison number.
-     * @param int minor         - The minor # of the version number.
-     * @return int              - Returns 1 if the file exists, and 0 if it does not.
-     * ------------------------------------------------------------------------------------------------- */
-    static int doesFileExist(char *filename, int major, int minor) {
-
-        int i = (access(filename, F_OK) != -1);
-
-        if(i > 0) {
-            FILE *file;
-            char *buffer;
-            char version[100] = "\0";
-            long file_size;
-
-            // Open the file for reading
-            file = fopen(filename, "r");
-                        
-            // Determine the file size
-            fseek(file, 0, SEEK_END);
-            file_size = ftell(file);
-            rewind(file);
-            
-            // Allocate memory for the buffer
-            buffer = (char *)malloc(sizeof(char) * (file_size + 1));
-            
-            if (buffer == NULL) {
-                printf("Memory allocation failed.\n");
-                fclose(file);
-                return 1;
-            }
-            
-            // Read the file content into the buffer
-            fread(buffer, sizeof(char), file_size, file);
-            
-            // Null-terminate the string
-            buffer[file_size] = '\0';
-            
-            
-            // Close the file
-            fclose(file);
-
-            sprintf(version, "%02d.%02d", major, minor);
-
-            i &= (strstr(buffer, version) != NULL);
-        }
+    // The pager I use under MacOS/Unix is less. Less is the equivalent
+    // of the Windows more command.
+    #define DEFAULT_PAGER "less"
+
+    const char *PATH = "/.local/share/";
+#endif
 
-        return i; 
+// The manual, split around the version number — the only part that isn't known at compile time.
+static const char MANUAL_NAME[] =
+    "NAME\n"
+    "       pmake Version: ";
+
+static const char MANUAL_BODY[] =
+    "\n"
+    "       Our custom \"pmake\" program is designed to empower developers by\n"
+    "       streamlining the build process with simplicity and efficiency.\n"
+    "       Tailored specifically for flexibility, it reads configuration files,\n"
+    "       interprets instructions, and executes commands to compile and build\n"
+    "       projects seamlessly. By offering an intuitive and robust solution,\n"
+    "       our pmake program not only enhances productivity but also ensures\n"
+    "       consistency across various development environments. This tool is\n"
+    "       an essential asset for any development team, enabling faster\n"
+    "       turnaround times and improved project management.\n"
+    "\n"
+    "SYNOPSIS\n"
+    "       pmake [-j N] [-k] [-n] [--explain] [--stats] [--stats-json=FILE]\n"
+    "             <projectname>\n"
+    "       pmake test [-j N] [--shard=I/N] [--timeout=SECONDS] <projectname>\n"
+    "       pmake --pgo [-j N] [-n] <projectname>\n"
+    "       pmake --compdb <projectname>\n"
+    "       pmake --toolchain <projectname>\n"
+    "       pmake --scan-deps [-j N] <projectname>\n"
+    "       pmake <{empty}\\-h\\-help\\-H\\-Help>\n"
+    "       pmake --version\n"
+    "\n"
+    "DESCRIPTION\n"
+    "       <pmake> The name of the makefile with the build instructions\n"
+    "       to be processed.\n"
+    "\n"
+    "           Example Makefile myproject.pmake:\n"
+    "           ---------------------------------------\n"
+    "           # Define the compiler and flags\n"
+    "           comp=gcc\n"
+    "           cflags=-Wall -Wextra -std=c11 (optional)\n"
+    "\n"
+    "           # Define the target executable or object or shared.\n"
+    "           target=exec or\n"
+    "           target=shared or\n"
+    "           target=obj\n"
+    "\n"
+    "           # Define the folder for the binaries.\n"
+    "           bin=./bin or\n"
+    "\n"
+    "           # Define the source files\n"
+    "           src=./src/main.c (optional)\n"
+    "\n"
+    "           # Define the project name\n"
+    "           project=myproject\n"
+    "\n"
+    "           # Define the library files\n"
+    "           libs=../mylibs/lib1.o ../mylibs/lib2.o\n"
+    "\n"
+    "           # Libraries found by pkg-config (optional)\n"
+    "           pkg=openssl zlib\n"
+    "\n"
+    "           # Generate sources before compiling (optional)\n"
+    "           gen=./gen/lexer.c: ./src/lexer.l | flex -o gen/lexer.c src/lexer.l\n"
+    "\n"
+    "           # Compile on pmake-worker daemons (optional)\n"
+    "           workers=buildbox2 buildbox3:3733/8\n"
+    "\n"
+    "           # Build C++ with named modules (optional)\n"
+    "           lang=c++\n"
+    "\n"
+    "           # Split debug info, packed and stripped (optional)\n"
+    "           debug=split dwp strip\n"
+    "           ---------------------------------------\n"
+    "\n"
+    "       workers=host[:port][/slots] ...\n"
+    "              Preprocess every unit locally and compile it on one of the\n"
+    "              listed pmake-worker daemons, which only need the compiler.\n"
+    "              The port defaults to 3733, slots (units a worker gets at a\n"
+    "              time) to 4. A unit goes to a free local processor, else to\n"
+    "              the least busy worker with a free slot. If a worker can't\n"
+    "              compile, the unit is compiled locally; one that can't be\n"
+    "              reached gets no more units in that build. Start a worker with\n"
+    "              pmake-worker [--listen ADDR] [--port N] [--jobs N]; it\n"
+    "              listens on 127.0.0.1 unless --listen says otherwise, so\n"
+    "              several can be tried on one machine with different ports.\n"
+    "       pkg=package ...\n"
+    "              Compile with pkg-config --cflags and link with\n"
+    "              pkg-config --libs of the packages ($PKG_CONFIG instead of\n"
+    "              pkg-config if set). The answer is cached in ~/.cache/pmake\n"
+    "              with the modification times of the .pc files it came from,\n"
+    "              those of required packages included, and pkg-config is only\n"
+    "              asked again when one of them changed, or PKG_CONFIG_PATH,\n"
+    "              PKG_CONFIG_LIBDIR or PKG_CONFIG_SYSROOT_DIR did.\n"
+    "       gen=output ...: [input ...] | command\n"
+    "              A rule that generates files before anything is compiled;\n"
+    "              every gen= line adds one. The command runs through the\n"
+    "              shell when an output is missing or older than an input, or\n"
+    "              the command changed. Rules run side by side like compiles;\n"
+    "              a rule that reads another's output waits for it and runs\n"
+    "              whenever it runs. Generated .c, .cpp, .cc, .cxx and module\n"
+    "              files join the sources. A failed rule's outputs are removed\n"
+    "              and the build stops with exit status 3.\n"
+    "       lang=c|c++\n"
+    "              With lang=c++ (comp defaults to g++) the sources may be C++20\n"
+    "              module units such as .cppm files. pmake scans them first -\n"
+    "              with gcc -fdeps-format=p1689r5 or clang-scan-deps when the\n"
+    "              compiler has it, otherwise with its own scanner - and\n"
+    "              compiles every unit as soon as the modules it imports are\n"
+    "              compiled. Module interfaces go to modules/ in objdir.\n"
+    "              -std=c++20 is added unless flags choose a standard.\n"
+    "              workers= is ignored for C++.\n"
+    "       debug=split [dwp] [strip]\n"
+    "              split compiles with -g -gsplit-dwarf, which leaves most of\n"
+    "              the debug info in .dwo files next to the objects, and links\n"
+    "              with -Wl,--gdb-index when a linker that builds the index\n"
+    "              (mold, lld, gold) is installed. After every link, dwp packs\n"
+    "              the .dwo files into bin/project.dwp (with llvm-dwp if found,\n"
+    "              otherwise dwp), and strip copies the remaining debug info\n"
+    "              to bin/project.debug and strips the output. Packing and\n"
+    "              copying run at the same time, stripping afterwards. The\n"
+    "              tools found are shown by --toolchain. workers= is ignored\n"
+    "              with split.\n"
+    "       objdir=DIR|tmpfs\n"
+    "              Directory for the objects, depfiles, module interfaces and\n"
+    "              the command log; defaults to ./build. objdir=tmpfs keeps\n"
+    "              them in memory, in /dev/shm/pmake-project-XXXXXXXX (one\n"
+    "              directory per project and working directory), and falls\n"
+    "              back to ./build where there is no /dev/shm. A tmpfs is\n"
+    "              emptied on reboot, so the first build after one compiles\n"
+    "              everything. The output itself is linked to bin/.project.tmp\n"
+    "              and renamed over bin/project only after the link and the\n"
+    "              debug steps succeeded, so a failed or interrupted build\n"
+    "              never leaves a half-written output behind.\n"
+    "       tests=./tests/*.c ...\n"
+    "              Test sources for pmake test. Each is compiled with the flags\n"
+    "              of the project and linked with the project's objects, all\n"
+    "              but the one that defines main(), into an executable of its\n"
+    "              own in bin, named after the source: ./tests/test_parse.c\n"
+    "              becomes bin/test_parse. A test passes when it exits with 0.\n"
+    "       test <projectname>\n"
+    "              Build the project and its tests, all compiles and links\n"
+    "              side by side, then run the tests, up to -j at a time. Tests\n"
+    "              that took longest last time start first; how long every\n"
+    "              test took is kept in objdir/.pmake_test_times. A passing\n"
+    "              test prints one line, a failing one its output as well.\n"
+    "       --shard=I/N\n"
+    "              With pmake test, run only the I-th of N parts of the tests,\n"
+    "              counted from 1. The parts are cut by test name, so N CI\n"
+    "              machines with --shard=1/N to N/N run every test once.\n"
+    "       --timeout=SECONDS\n"
+    "              With pmake test, kill a test that runs longer than this, and\n"
+    "              everything it started; it counts as failed. Defaults to 300,\n"
+    "              0 means no limit. Not enforced on Windows.\n"
+    "       pgo=COMMAND\n"
+    "              Training command for --pgo, run by the shell with\n"
+    "              PMAKE_PGO_OUTPUT set to the instrumented output, e.g.\n"
+    "              pgo=$PMAKE_PGO_OUTPUT --benchmark data/sample.txt\n"
+    "       --pgo\n"
+    "              Build with profile-guided optimization: build the project\n"
+    "              instrumented into objdir/pgo/bin, run the pgo= command,\n"
+    "              merge the profiles it leaves (llvm-profdata for clang; gcc\n"
+    "              11 or newer merges its .gcda files itself) and build again\n"
+    "              into bin with the profile. The instrumented build is\n"
+    "              incremental like any other, and the training is skipped\n"
+    "              while neither the instrumented output nor the command\n"
+    "              changed. A new profile recompiles every unit. Both builds\n"
+    "              compile locally, workers= is ignored. A plain build after\n"
+    "              it compiles without the profile again.\n"
+    "       -j N, --jobs=N\n"
+    "              Compile up to N translation units at the same time. Defaults\n"
+    "              to the number of processors. Each unit's compiler output is\n"
+    "              printed in one piece when it finishes, after a progress line\n"
+    "              like [37/412] src/foo.c. Objects are placed in objdir.\n"
+    "       -k, --keep-going\n"
+    "              Keep compiling everything that doesn't depend on a failed\n"
+    "              unit. Without it, the first compiler error terminates all\n"
+    "              running compilers and the build stops right away.\n"
+    "       -n, --dry-run\n"
+    "              Print the exact commands pmake would run, without running\n"
+    "              them.\n"
+    "       --explain\n"
+    "              Print for every source file and the output whether it is\n"
+    "              stale and why: missing output, newer source, changed header,\n"
+    "              changed flags or missing depfile. Only stale units are\n"
+    "              compiled; header dependencies come from -MMD depfiles next to\n"
+    "              the objects and commands are remembered in objdir/.pmake_log.\n"
+    "              An object without a depfile is checked against the headers\n"
+    "              pmake's own include scanner finds instead. The log also keeps\n"
+    "              a hash of every object, so when recompiling only changed\n"
+    "              comments or whitespace and the objects come out the same,\n"
+    "              the output is not linked again.\n"
+    "       --stats\n"
+    "              After the build, print wall and CPU time, the peak number of\n"
+    "              concurrent jobs, compiled and up-to-date units, the peak\n"
+    "              memory of the compilers and the 10 slowest steps. Without it\n"
+    "              only a one-line summary is printed.\n"
+    "       --stats-json=FILE\n"
+    "              Append the same statistics to FILE as JSON lines: one build\n"
+    "              record followed by one step record per compile or link.\n"
+    "       --compdb\n"
+    "              Write compile_commands.json with the exact compiler command\n"
+    "              of every source file, for clangd, clang-tidy and other tools.\n"
+    "              Nothing is compiled.\n"
+    "       --toolchain\n"
+    "              Show what the compiler in comp can do: kind, version, depfile\n"
+    "              and split DWARF support, working -fuse-ld linkers. pmake\n"
+    "              probes a compiler once and caches the answers per binary in\n"
+    "              ~/.cache/pmake (or $XDG_CACHE_HOME/pmake); a changed binary\n"
+    "              is probed again. Nothing is compiled.\n"
+    "       --scan-deps\n"
+    "              Print the project headers every source file includes,\n"
+    "              directly or through other headers, as found by the built-in\n"
+    "              include scanner. It follows the -I and -iquote directories\n"
+    "              in flags, skips comments and string literals, and ignores\n"
+    "              #if, so the list is an approximation. Nothing is compiled.\n"
+    "       -h, -help -H -Help\n"
+    "              Display this help and exit.\n"
+    "       --version\n"
+    "              Display the version number and exit.\n"
+    "\n"
+    "EXIT STATUS\n"
+    "       0      The build succeeded.\n"
+    "       2      Configuration error: unusable .pmake file or command line.\n"
+    "       3      A gen= rule failed or at least one translation unit failed\n"
+    "              to compile.\n"
+    "       4      All units compiled, but linking failed.\n"
+    "       5      pmake test: everything was built, but a test failed.\n"
+    "       6      pmake --pgo: the training command failed or left no\n"
+    "              profile.\n"
+    "\n"
+    "ENVIRONMENT\n"
+    "       PAGER  Program that displays this help when it goes to a terminal;\n"
+    "              defaults to less. Without a terminal the help is written to\n"
+    "              standard output as is.\n"
+    "\n"
+    "AUTHOR\n"
+    "       Patrik Eigenmann (p.eigenmann@gmx.net)\n"
+    "\n"
+    "COPYRIGHT\n"
+    "      Copyright 2024 Free Software Foundation, Inc. License GPLv3+:\n"
+    "      GNU GPL version 3 or later <https://gnu.org/licenses/gpl.html>.\n"
+    "      This is free software: you are free to change and redistribute it.\n"
+    "      There is NO WARRANTY, to the extent permitted by law.\n";
+
+/* --------------------------------------------------------------------------------------------------------
+ * Write the manual to a stream: the versioned header when asked for, then the text with the version
+ * number in the NAME section. Nothing is formatted — the pieces are written as they are.
+ *
+ * @param FILE *out         - The stream to write to.
+ * @param const char *ver   - The version as "MM.mm".
+ * @param int with_header   - Write the version header in front, for the installed copy.
+ * @return int              - Returns 0 on success, and -1 if the stream reported an error.
+ * -------------------------------------------------------------------------------------------------------- */
+static int write_manual(FILE *out, const char *ver, int with_header) {
+    if (with_header) {
+        fputs(MANUAL_MAGIC, out);
+        fputs(ver, out);
+        fputc('\n', out);
     }
+    fwrite(MANUAL_NAME, 1, sizeof(MANUAL_NAME) - 1, out);
+    fputs(ver, out);
+    fwrite(MANUAL_BODY, 1, sizeof(MANUAL_BODY) - 1, out);
+    return ferror(out) ? -1 : 0;
+}
 
-    // The command I use under MacOS/Unix is less. Less is the equivalent
-    // of the Windows more command.
-    char command[255] = "less ";
+/* --------------------------------------------------------------------------------------------------------
+ * Tell whether the installed manual belongs to this version by comparing its header. Only the header is
+ * read, so the check stays cheap even when the home directory lives on a slow network share.
+ *
+ * @param const char *filename  - The installed manual.
+ * @param const char *ver       - The version as "MM.mm".
+ * @return int                  - Returns 1 if the file exists and carries this version, and 0 otherwise.
+ * -------------------------------------------------------------------------------------------------------- */
+static int is_manual_current(const char *filename, const char *ver) {
+    char expected[MANUAL_HEADER_SIZE + 1];
+    char header[MANUAL_HEADER_SIZE];
 
-    char *PATH = "/.local/share/";
-#endif
+    snprintf(expected, sizeof(expected), "%s%s\n", MANUAL_MAGIC, ver);
+
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL) return 0;
+
+    size_t n = fread(header, 1, MANUAL_HEADER_SIZE, file);
+    fclose(file);
+
+    return n == MANUAL_HEADER_SIZE && memcmp(header, expected, MANUAL_HEADER_SIZE) == 0;
+}
 
 /* --------------------------------------------------------------------------------------------------------
- * By encapsulating the process of appending formatted content within this method, we ensure a seamless and
- * efficient way to dynamically build strings. This method not only enhances the maintainability and
- * readability of your codebase, but also guarantees that formatted content is appended consistently and
- * effectively.
- * 
- * Adopting the append_format method will streamline your string manipulation tasks, fostering better
- * organization and flexibility, and ultimately contributing to a more polished and efficient product.
- * 
- * @param char **dest - The destination string to which formatted content will be appended.
- * @param const char *format - The format string.
- * @param ... - Additional arguments to format and append to the destination string.
+ * Pipe the manual into the user's pager. $PAGER may carry options ("less -R"), so it runs through the
+ * shell. If the pager can't be started, the manual is written to standard output instead.
+ *
+ * @param const char *ver   - The version as "MM.mm".
  * -------------------------------------------------------------------------------------------------------- */
-static void append_format(char **dest, const char *format, ...) {
-    va_list args;
-    va_start(args, format);
-    
-    va_list args_copy;
-    va_copy(args_copy, args);
-    int size = vsnprintf(NULL, 0, format, args_copy) + 1;
-    va_end(args_copy);
-
-    char *temp = malloc(size);
-    if (temp == NULL) {
-        perror("malloc failed");
-        va_end(args);
+static void page_manual(const char *ver) {
+    const char *pager = getenv("PAGER");
+    if (pager == NULL || *pager == '\0') pager = DEFAULT_PAGER;
+
+#ifdef _WIN32
+    FILE *pipe = _popen(pager, "w");
+    if (pipe == NULL) {
+        write_manual(stdout, ver, 0);
+        return;
+    }
+    write_manual(pipe, ver, 0);
+    _pclose(pipe);
+#else
+    int fds[2];
+    if (pipe(fds) != 0) {
+        write_manual(stdout, ver, 0);
         return;
     }
-    
-    vsprintf(temp, format, args);
-    va_end(args);
-
-    // printf("append_format received: format=\"%s\" → result=\"%s\"\n", format, temp);
 
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[0], STDIN_FILENO);
+    posix_spawn_file_actions_addclose(&actions, fds[0]);
+    posix_spawn_file_actions_addclose(&actions, fds[1]);
+
+    char *const args[] = { "sh", "-c", (char *)pager, NULL };
+    pid_t pid;
+    int rc = posix_spawn(&pid, "/bin/sh", &actions, NULL, args, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[0]);
+
+    if (rc != 0) {
+        close(fds[1]);
+        write_manual(stdout, ver, 0);
+        return;
+    }
 
-    if (*dest == NULL) {
-        *dest = malloc(size);
-        if (*dest == NULL) {
-            perror("malloc failed");
-            free(temp);
-            return;
-        }
+    // Quitting the pager before the end closes the pipe; that must not kill pmake.
+    void (*old_handler)(int) = signal(SIGPIPE, SIG_IGN);
 
-        strcpy(*dest, temp);
-    } else {
-        *dest = realloc(*dest, strlen(*dest) + size);
-        if (*dest == NULL) {
-            perror("realloc failed");
-            free(temp);
-            return;
-        }
-        strcat(*dest, temp);
+    FILE *out = fdopen(fds[1], "w");
+    if (out != NULL) {
+        write_manual(out, ver, 0);
+        fclose(out);
     }
-    
-    free(temp);
+    else {
+        close(fds[1]);
+    }
+
+    while (waitpid(pid, NULL, 0) < 0 && errno == EINTR) {}
+    signal(SIGPIPE, old_handler);
+#endif
 }
 
 /* -----------------------------------------------------------------------------------------------------
- * By encapsulating the creation of manual pages within this method, we ensure a seamless and efficient
- * process for generating documentation. This not only enhances the maintainability and readability of
- * your codebase, but also guarantees that manual pages are consistently formatted and easily accessible.
- * 
- * Adopting the create_manpage method will streamline your documentation process, fostering better
- * organization and accessibility, and ultimately contributing to a more polished and user-friendly product.
- * 
- * @param char *filenameIn - The filename to the ManPage text file.
- * @param char *manualIn - The content of the ManPage text.
+ * Install the manual as a plain text file in the user's home directory, so it can be read without
+ * running pmake. The file is only written when it is missing or belongs to another version; every
+ * other call costs a single small read.
+ *
+ * @param const char *filenameIn - The filename of the ManPage text file, without extension.
+ * @param Version v              - The version of the program the manual describes.
  * ----------------------------------------------------------------------------------------------------- */
-void create_manpage(char *filenameIn, char *manualIn, int major, int minor) {
-
-    ManPage mp;
+void create_manpage(const char *filenameIn, Version v) {
 
-    mp.filename = NULL;
-    append_format(&mp.filename, _home());
-    append_format(&mp.filename, PATH);
-    append_format(&mp.filename, filenameIn);
-    append_format(&mp.filename, FILE_EXTENTION);
+    const char *home = _home();
+    if (home == NULL) return;
 
-    mp.manual = NULL;
-    append_format(&mp.manual, manualIn);
+    char ver[6];
+    to_string(v, ver);
 
-    if(!doesFileExist(mp.filename, major, minor)) {
-        
-        FILE *file = fopen(mp.filename, "w");
-    
-        if (file == NULL) {
-            printf("Error opening file!\n");
-            return;
-        }
+    size_t size = strlen(home) + strlen(PATH) + strlen(filenameIn) + strlen(FILE_EXTENTION) + 1;
+    char *filename = malloc(size);
+    if (filename == NULL) return;
+    snprintf(filename, size, "%s%s%s%s", home, PATH, filenameIn, FILE_EXTENTION);
 
-        fprintf(file, "%s", mp.manual);
+    if (!is_manual_current(filename, ver)) {
 
-        // Now we can close the file.
-        fclose(file);
+        // The manual goes to a file of this process first and is renamed over the installed one once
+        // it is complete. is_manual_current() only reads the header, so a manual cut short by an
+        // interrupt or by a second pmake -h writing at the same time would otherwise stay forever.
+        char *tmp = str_printf("%s.tmp.%d", filename, (int)_pid());
+        FILE *file = tmp ? fopen(tmp, "wb") : NULL;
 
+        // A read-only or missing directory is no reason to withhold the help.
+        if (file != NULL) {
+            int ok = write_manual(file, ver, 1) == 0;
+            ok &= fclose(file) == 0;
+            if (!ok || replace_file(tmp, filename) != 0) remove(tmp);
+        }
+        free(tmp);
     }
 
-    strcat(command, mp.filename);
-    system(command);
+    free(filename);
 }
 
 /* ----------------------------------------------------------------------------------------------------
@@ -319,82 +520,25 @@ int isHelpTriggered(int argcIn, char *argvIn) {
  * ------------------------------------------------------------------------------------------------------- */
 void print_help(Version v) {
 
-    // Version control implemented
-    // Version v = create_version(0, 19);
-    
     // The buffer is needed to write
     // the correct formated version number.
     char buffer[6];
-    
+
     // Format the buffer with the
     // correct version number.
     to_string(v, buffer);
 
-    char *manpage = NULL;
-
-    // Write the ManPage style help file.
-    append_format(&manpage, "NAME\n");
-    append_format(&manpage, "       pmake Version: %s\n", buffer);
-    append_format(&manpage, "       Our custom \"pmake\" program is designed to empower developers by\n");
-    append_format(&manpage, "       streamlining the build process with simplicity and efficiency.\n");
-    append_format(&manpage, "       Tailored specifically for flexibility, it reads configuration files,\n");
-    append_format(&manpage, "       interprets instructions, and executes commands to compile and build\n");
-    append_format(&manpage, "       projects seamlessly. By offering an intuitive and robust solution,\n");
-    append_format(&manpage, "       our pmake program not only enhances productivity but also ensures\n");
-    append_format(&manpage, "       consistency across various development environments. This tool is\n");
-    append_format(&manpage, "       an essential asset for any development team, enabling faster\n");
-    append_format(&manpage, "       turnaround times and improved project management.\n");
-    append_format(&manpage, "\n");
-    append_format(&manpage, "SYNOPSIS\n");
-    append_format(&manpage, "       pmake <projectname>\n");
-    append_format(&manpage, "       pmake <{empty}\\-h\\-help\\-H\\-Help>\n");
-    append_format(&manpage, "       pmake --version\n"); 
-    append_format(&manpage, "\n");
-    append_format(&manpage, "DESCRIPTION\n");
-    append_format(&manpage, "       <pmake> The name of the makefile with the build instructions\n");
-    append_format(&manpage, "       to be processed.\n");
-    append_format(&manpage, "\n");
-    append_format(&manpage, "           Example Makefile myproject.pmake:\n");
-    append_format(&manpage, "           ---------------------------------------\n");
-    append_format(&manpage, "           # Define the compiler and flags\n");
-    append_format(&manpage, "           comp=gcc\n");
-    append_format(&manpage, "           cflags=-Wall -Wextra -std=c11 (optional)\n");
-    append_format(&manpage, "\n");
-    append_format(&manpage, "           # Define the target executable or object or shared.\n");
-    append_format(&manpage, "           target=exec or\n");
-    append_format(&manpage, "           target=shared or\n");
-    append_format(&manpage, "           target=obj\n");
-    append_format(&manpage, "\n");
-    append_format(&manpage, "           # Define the folder for the binaries.\n");
-    append_format(&manpage, "           bin=./bin or\n");
-    append_format(&manpage, "\n");
-    append_format(&manpage, "           # Define the source files\n");
-    append_format(&manpage, "           src=./src/main.c (optional)\n");
-    append_format(&manpage, "\n");
-    append_format(&manpage, "           # Define the project name\n");
-    append_format(&manpage, "           project=myproject\n");
-    append_format(&manpage, "\n");
-    append_format(&manpage, "           # Define the library files\n");
-    append_format(&manpage, "           libs=../mylibs/lib1.o ../mylibs/lib2.o\n");
-    append_format(&manpage, "           ---------------------------------------\n");
-    append_format(&manpage, "\n");
-    append_format(&manpage, "       -h, -help -H -Help\n");
-    append_format(&manpage, "              Display this help and exit.\n");
-    append_format(&manpage, "       --version\n");
-    append_format(&manpage, "              Display the version number and exit.\n");
-    append_format(&manpage, "\n");
-    append_format(&manpage, "AUTHOR\n");
-    append_format(&manpage, "       Patrik Eigenmann (p.eigenmann@gmx.net)\n");
-    append_format(&manpage, "\n");
-    append_format(&manpage, "COPYRIGHT\n");
-    append_format(&manpage, "      Copyright 2024 Free Software Foundation, Inc. License GPLv3+:\n");
-    append_format(&manpage, "      GNU GPL version 3 or later <https://gnu.org/licenses/gpl.html>.\n");
-    append_format(&manpage, "      This is free software: you are free to change and redistribute it.\n");
-    append_format(&manpage, "      There is NO WARRANTY, to the extent permitted by law.\n");
-
-    // Create the manpage in the file
-    create_manpage("pmake", manpage, v.major, v.minor);
-
-    // Free up the memory.
-    free(manpage);
-}
\ No newline at end of file
+    // Keep the installed copy in step with this version.
+    create_manpage("pmake", v);
+
+#ifdef _WIN32
+    int interactive = _isatty(_fileno(stdout));
+#else
+    int interactive = isatty(STDOUT_FILENO);
+#endif
+
+    // A pager only makes sense for a human in front of a terminal. Redirected
+    // into a file or another program, the text goes out unchanged.
+    if (interactive) page_manual(buffer);
+    else             write_manual(stdout, buffer, 0);
+}
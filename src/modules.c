@@ -0,0 +1,540 @@
+/* ****************************************************************************************************
+ * modules.c - Implementation of the C++ module scan. P1689 scans run as ordinary jobs through the pool
+ * and leave one .ddi file next to each object; a .ddi newer than its source is reused, so an
+ * incremental build only rescans what was edited. The JSON reader below understands just enough of
+ * P1689 to pull out the logical names of provided and required modules and skips everything else.
+ *
+ * The module graph is a plain adjacency list per unit, ordered with Kahn's algorithm. The order is
+ * what the compile jobs are created in, so on Windows, where the pool runs jobs one after another,
+ * every provider is compiled before its importers as well.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created.                                                         Version: 00.01
+ * Sun 2026-10-18 Module directory and mapper below the object directory of the plan.   Version: 00.02
+ * Sun 2026-10-18 .ddi files are scanned again when the scan command changed.           Version: 00.03
+ * **************************************************************************************************** */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "modules.h"
+#include "jobs.h"
+#include "depend.h"
+#include "scan.h"
+#include "util.h"
+#include "debug.h"
+
+#ifdef _WIN32
+    #define NULL_DEVICE "NUL"
+#else
+    #define NULL_DEVICE "/dev/null"
+#endif
+
+char *module_flags(const Toolchain *tc, const char *objdir) {
+    if (tc->kind == TOOLCHAIN_CLANG) return str_printf("-fprebuilt-module-path=%s/" MODULE_SUBDIR, objdir);
+    return str_printf("-fmodule-mapper=%s/" MODULE_SUBDIR "/" MODULE_MAPPER, objdir);
+}
+
+const char *cxx_source_flag(const Toolchain *tc, const char *src) {
+    static const char *const exts[] = { ".cppm", ".ccm", ".cxxm", ".c++m", ".ixx", ".mpp" };
+    const char *dot = strrchr(src, '.');
+    if (tc->kind == TOOLCHAIN_CLANG || !dot) return "";
+
+    for (size_t i = 0; i < sizeof(exts) / sizeof(exts[0]); i++) {
+        if (strcmp(dot, exts[i]) == 0) return "-x c++ ";
+    }
+    return "";
+}
+
+// --------------------------------------------------------------------------------
+// Return the path of the compiled interface of a module. clang looks partitions
+// up as "module-part.pcm", and gcc is told the same names through the mapper.
+// --------------------------------------------------------------------------------
+static char *bmi_path(const Toolchain *tc, const char *dir, const char *name) {
+    char *path = str_printf("%s/%s%s", dir, name, tc->kind == TOOLCHAIN_CLANG ? ".pcm" : ".gcm");
+    for (char *p = path + strlen(dir) + 1; p && *p; p++) {
+        if (*p == ':') *p = '-';
+    }
+    return path;
+}
+
+// --------------------------------------------------------------------------------
+// Return the P1689 file of a unit: the object path with .ddi instead of .o.
+// --------------------------------------------------------------------------------
+static char *ddi_path(const char *obj) {
+    const char *dot = strrchr(obj, '.');
+    int len = dot ? (int)(dot - obj) : (int)strlen(obj);
+    return str_printf("%.*s.ddi", len, obj);
+}
+
+// --------------------------------------------------------------------------------
+// Minimal JSON reader. Every function takes p at the start of a value and returns
+// the position right after it, or NULL if the text isn't valid JSON.
+// --------------------------------------------------------------------------------
+typedef const char *(*JsonMember)(const char *key, const char *value, void *ctx);
+typedef const char *(*JsonElement)(const char *value, void *ctx);
+
+static const char *json_skip(const char *p);
+
+static const char *json_ws(const char *p) {
+    while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') p++;
+    return p;
+}
+
+// Read a string; escapes other than \uXXXX are decoded, which is all P1689 names need.
+static const char *json_string(const char *p, char **out) {
+    if (*p != '"') return NULL;
+    StrBuf sb = {0};
+    sb_append(&sb, "", 0);
+
+    for (p++; *p && *p != '"'; p++) {
+        char c = *p;
+        if (c == '\\') {
+            c = *++p;
+            if (c == 'n') c = '\n';
+            else if (c == 't') c = '\t';
+            else if (c == 'u') {
+                for (int i = 0; i < 4 && p[1]; i++) p++;
+                c = '?';
+            }
+            else if (!c) break;
+        }
+        sb_append(&sb, &c, 1);
+    }
+    if (*p != '"') {
+        sb_free(&sb);
+        return NULL;
+    }
+
+    if (out) *out = sb.data;
+    else sb_free(&sb);
+    return p + 1;
+}
+
+// Walk the members of an object; member() must consume the value, NULL skips all.
+static const char *json_object(const char *p, JsonMember member, void *ctx) {
+    p = json_ws(p);
+    if (*p != '{') return NULL;
+    p = json_ws(p + 1);
+    if (*p == '}') return p + 1;
+
+    for (;;) {
+        char *key = NULL;
+        p = json_string(p, &key);
+        if (!p) return NULL;
+        p = json_ws(p);
+        if (*p != ':') {
+            free(key);
+            return NULL;
+        }
+        p = json_ws(p + 1);
+        p = member ? member(key, p, ctx) : json_skip(p);
+        free(key);
+        if (!p) return NULL;
+
+        p = json_ws(p);
+        if (*p == '}') return p + 1;
+        if (*p != ',') return NULL;
+        p = json_ws(p + 1);
+    }
+}
+
+// Walk the elements of an array; element() must consume the value, NULL skips all.
+static const char *json_array(const char *p, JsonElement element, void *ctx) {
+    p = json_ws(p);
+    if (*p != '[') return NULL;
+    p = json_ws(p + 1);
+    if (*p == ']') return p + 1;
+
+    for (;;) {
+        p = element ? element(p, ctx) : json_skip(p);
+        if (!p) return NULL;
+
+        p = json_ws(p);
+        if (*p == ']') return p + 1;
+        if (*p != ',') return NULL;
+        p = json_ws(p + 1);
+    }
+}
+
+static const char *json_skip(const char *p) {
+    p = json_ws(p);
+    if (*p == '"') return json_string(p, NULL);
+    if (*p == '{') return json_object(p, NULL, NULL);
+    if (*p == '[') return json_array(p, NULL, NULL);
+
+    // Numbers, true, false and null.
+    const char *start = p;
+    while (*p && strchr("+-.0123456789eEtrufalsn", *p)) p++;
+    return p > start ? p : NULL;
+}
+
+// --------------------------------------------------------------------------------
+// The pieces of P1689 pmake reads: rules[].provides[].logical-name and
+// rules[].requires[].logical-name.
+// --------------------------------------------------------------------------------
+typedef struct {
+    char **provides;
+    StrList *requires;
+} P1689;
+
+static const char *name_member(const char *key, const char *value, void *ctx) {
+    char **name = ctx;
+    if (strcmp(key, "logical-name") != 0 || *name) return json_skip(value);
+    return json_string(value, name);
+}
+
+static const char *provide_element(const char *value, void *ctx) {
+    P1689 *d = ctx;
+    char *name = NULL;
+    const char *end = json_object(value, name_member, &name);
+    if (name) {
+        free(*d->provides);
+        *d->provides = name;
+    }
+    return end;
+}
+
+static const char *require_element(const char *value, void *ctx) {
+    P1689 *d = ctx;
+    char *name = NULL;
+    const char *end = json_object(value, name_member, &name);
+    if (name) strlist_push(d->requires, name);
+    return end;
+}
+
+static const char *rule_member(const char *key, const char *value, void *ctx) {
+    if (strcmp(key, "provides") == 0) return json_array(value, provide_element, ctx);
+    if (strcmp(key, "requires") == 0) return json_array(value, require_element, ctx);
+    return json_skip(value);
+}
+
+static const char *rule_element(const char *value, void *ctx) {
+    return json_object(value, rule_member, ctx);
+}
+
+static const char *top_member(const char *key, const char *value, void *ctx) {
+    if (strcmp(key, "rules") == 0) return json_array(value, rule_element, ctx);
+    return json_skip(value);
+}
+
+// --------------------------------------------------------------------------------
+// Read the provided and required modules out of a P1689 file.
+//
+// @return  0 on success, -1 if the file is missing or not valid P1689
+// --------------------------------------------------------------------------------
+static int read_p1689(const char *path, char **provides, StrList *requires) {
+    char *text = read_file(path, NULL);
+    if (!text) return -1;
+
+    P1689 d = { provides, requires };
+    const char *end = json_object(text, top_member, &d);
+    free(text);
+    return end ? 0 : -1;
+}
+
+// --------------------------------------------------------------------------------
+// Run the P1689 scans of all units whose .ddi is missing, older than the source or
+// was made by a different scan command, then read every .ddi. A -D in flags can
+// guard an import, so a .ddi of other flags can't be trusted.
+//
+// @return  0 on success, -1 if a scan failed or its output can't be read
+// --------------------------------------------------------------------------------
+static int scan_p1689(const BuildPlan *plan, int jobs, CommandLog *log, char **provides, StrList *requires,
+                      char **errmsg) {
+    char **ddis = calloc((size_t)plan->count + 1, sizeof(char *));
+    Job *scans = calloc((size_t)plan->count + 1, sizeof(Job));
+    int *unit_of = calloc((size_t)plan->count + 1, sizeof(int));
+    int nscans = 0, rc = 0;
+
+    if (!ddis || !scans || !unit_of) {
+        *errmsg = strdup("Memory allocation failed for the module scan.");
+        rc = -1;
+        goto done;
+    }
+
+    for (int i = 0; i < plan->count; i++) {
+        const Unit *u = &plan->units[i];
+        const char *flags = plan->flags ? plan->flags : "";
+        char *cmd;
+        ddis[i] = ddi_path(u->obj);
+        if (plan->tc.p1689) {
+            cmd = str_printf("%s %s -E -fdeps-format=p1689r5 -fdeps-file=%s -fdeps-target=%s %s%s -o %s",
+                             plan->tc.comp, flags, ddis[i], u->obj, cxx_source_flag(&plan->tc, u->src),
+                             u->src, NULL_DEVICE);
+        }
+        else {
+            cmd = str_printf("%s -format=p1689 -- %s %s -c %s -o %s > %s", plan->tc.scan_deps,
+                             plan->tc.comp, flags, u->src, u->obj, ddis[i]);
+        }
+
+        StrList src = {0};
+        char *detail = NULL;
+        strlist_push(&src, strdup(u->src));
+        StaleReason reason = check_output(log, ddis[i], &src, cmd, &detail);
+        strlist_free(&src);
+        free(detail);
+        if (reason == STALE_NONE) {
+            free(cmd);
+            continue;
+        }
+
+        make_parent_dirs(ddis[i]);
+        scans[nscans].cmd = cmd;
+        scans[nscans].label = str_printf("Scanning %s", u->src);
+        unit_of[nscans++] = i;
+    }
+
+    if (nscans > 0) {
+        JobPool pool = { jobs, 0, 0, NULL, NULL, NULL, NULL, NULL, 0 };
+        run_jobs(scans, nscans, &pool);
+
+        // A failed scan may leave half a file behind; it must not count as fresh.
+        for (int k = 0; k < nscans; k++) {
+            if (scans[k].status == 0) {
+                record_command(log, ddis[unit_of[k]], scans[k].cmd);
+                continue;
+            }
+            remove(ddis[unit_of[k]]);
+            rc = -1;
+        }
+        if (rc != 0) {
+            *errmsg = strdup("Scanning the module dependencies failed.");
+            goto done;
+        }
+    }
+
+    for (int i = 0; i < plan->count; i++) {
+        if (read_p1689(ddis[i], &provides[i], &requires[i]) != 0) {
+            *errmsg = str_printf("Could not read the module dependencies of %s from %s",
+                                 plan->units[i].src, ddis[i]);
+            remove(ddis[i]);
+            rc = -1;
+            goto done;
+        }
+    }
+
+done:
+    for (int k = 0; scans && k < nscans; k++) free_job(&scans[k]);
+    for (int i = 0; ddis && i < plan->count; i++) free(ddis[i]);
+    free(scans);
+    free(ddis);
+    free(unit_of);
+    return rc;
+}
+
+// A provided module and the unit providing it, sorted by name for lookups.
+typedef struct {
+    const char *name;
+    int unit;
+} Provider;
+
+static int compare_providers(const void *a, const void *b) {
+    return strcmp(((const Provider *)a)->name, ((const Provider *)b)->name);
+}
+
+// --------------------------------------------------------------------------------
+// Resolve the imports of every unit to the units providing them and order the
+// units so that providers come first.
+//
+// @return  0 on success, -1 on a missing or doubly provided module or a cycle
+// --------------------------------------------------------------------------------
+static int link_graph(const BuildPlan *plan, ModuleGraph *g, char **errmsg) {
+    Provider *providers = calloc((size_t)g->count + 1, sizeof(Provider));
+    int *waiting = calloc((size_t)g->count + 1, sizeof(int));
+    int *first = NULL, *importers = NULL;
+    int nproviders = 0, rc = 0;
+
+    if (!providers || !waiting) {
+        *errmsg = strdup("Memory allocation failed for the module graph.");
+        rc = -1;
+        goto done;
+    }
+
+    for (int i = 0; i < g->count; i++) {
+        if (!g->units[i].provides) continue;
+        providers[nproviders].name = g->units[i].provides;
+        providers[nproviders++].unit = i;
+    }
+    qsort(providers, (size_t)nproviders, sizeof(Provider), compare_providers);
+    for (int k = 1; k < nproviders; k++) {
+        if (strcmp(providers[k - 1].name, providers[k].name) == 0) {
+            *errmsg = str_printf("Module %s is provided by both %s and %s", providers[k].name,
+                                 plan->units[providers[k - 1].unit].src, plan->units[providers[k].unit].src);
+            rc = -1;
+            goto done;
+        }
+    }
+
+    for (int i = 0; i < g->count; i++) {
+        ModuleUnit *m = &g->units[i];
+        m->deps = calloc((size_t)m->requires.count + 1, sizeof(int));
+        if (!m->deps) {
+            *errmsg = strdup("Memory allocation failed for the module graph.");
+            rc = -1;
+            goto done;
+        }
+
+        for (int r = 0; r < m->requires.count; r++) {
+            Provider key = { m->requires.items[r], 0 };
+            const Provider *p = bsearch(&key, providers, (size_t)nproviders, sizeof(Provider),
+                                        compare_providers);
+            if (!p) {
+                *errmsg = str_printf("Module %s imported by %s is not provided by any source",
+                                     key.name, plan->units[i].src);
+                rc = -1;
+                goto done;
+            }
+            if (p->unit == i) continue;
+
+            int known = 0;
+            for (int d = 0; d < m->ndeps; d++) known |= m->deps[d] == p->unit;
+            if (!known) m->deps[m->ndeps++] = p->unit;
+        }
+        waiting[i] = m->ndeps;
+    }
+
+    // Kahn's algorithm over the reversed edges: importers[first[u]..first[u+1]) are
+    // the units waiting for u. Ready units are taken in source order.
+    int edges = 0;
+    for (int i = 0; i < g->count; i++) edges += g->units[i].ndeps;
+    first = calloc((size_t)g->count + 2, sizeof(int));
+    importers = calloc((size_t)edges + 1, sizeof(int));
+    if (!first || !importers) {
+        *errmsg = strdup("Memory allocation failed for the module graph.");
+        rc = -1;
+        goto done;
+    }
+    for (int i = 0; i < g->count; i++) {
+        for (int d = 0; d < g->units[i].ndeps; d++) first[g->units[i].deps[d] + 2]++;
+    }
+    for (int i = 0; i < g->count; i++) first[i + 2] += first[i + 1];
+    for (int i = 0; i < g->count; i++) {
+        for (int d = 0; d < g->units[i].ndeps; d++) importers[first[g->units[i].deps[d] + 1]++] = i;
+    }
+
+    int head = 0, tail = 0;
+    for (int i = 0; i < g->count; i++) {
+        if (waiting[i] == 0) g->order[tail++] = i;
+    }
+    while (head < tail) {
+        int u = g->order[head++];
+        for (int e = first[u]; e < first[u + 1]; e++) {
+            if (--waiting[importers[e]] == 0) g->order[tail++] = importers[e];
+        }
+    }
+    if (tail < g->count) {
+        for (int i = 0; i < g->count; i++) {
+            if (waiting[i] > 0) {
+                *errmsg = str_printf("Module import cycle involving %s", plan->units[i].src);
+                break;
+            }
+        }
+        rc = -1;
+    }
+
+done:
+    free(providers);
+    free(waiting);
+    free(first);
+    free(importers);
+    return rc;
+}
+
+// --------------------------------------------------------------------------------
+// Write gcc's module mapper: one "module bmi-file" line per provided module. The
+// file is only replaced when its content changes.
+// --------------------------------------------------------------------------------
+static int write_mapper(const ModuleGraph *g, const char *mapper) {
+    StrBuf sb = {0};
+    sb_append(&sb, "", 0);
+    for (int i = 0; i < g->count; i++) {
+        if (g->units[i].provides) sb_printf(&sb, "%s %s\n", g->units[i].provides, g->units[i].bmi);
+    }
+
+    size_t len = 0;
+    char *old = read_file(mapper, &len);
+    int rc = 0;
+    if (!old || len != sb.len || memcmp(old, sb.data, len) != 0) {
+        rc = make_parent_dirs(mapper) == 0 ? write_file_atomic(mapper, sb.data, sb.len) : -1;
+    }
+    free(old);
+    sb_free(&sb);
+    return rc;
+}
+
+int scan_modules(BuildPlan *plan, int jobs, CommandLog *log, ModuleGraph *graph, char **errmsg) {
+    memset(graph, 0, sizeof(*graph));
+    graph->units = calloc((size_t)plan->count + 1, sizeof(ModuleUnit));
+    graph->order = calloc((size_t)plan->count + 1, sizeof(int));
+    char **provides = calloc((size_t)plan->count + 1, sizeof(char *));
+    StrList *requires = calloc((size_t)plan->count + 1, sizeof(StrList));
+    char **srcs = calloc((size_t)plan->count + 1, sizeof(char *));
+    char *dir = str_printf("%s/" MODULE_SUBDIR, plan->objdir);
+    char *mapper = str_printf("%s/" MODULE_MAPPER, dir);
+    int rc = 0;
+
+    if (!graph->units || !graph->order || !provides || !requires || !srcs || !mapper) {
+        *errmsg = strdup("Memory allocation failed for the module scan.");
+        rc = -1;
+        goto done;
+    }
+    graph->count = plan->count;
+
+    double start = now_seconds();
+    if (plan->tc.p1689 || plan->tc.scan_deps) {
+        rc = scan_p1689(plan, jobs, log, provides, requires, errmsg);
+    }
+    else {
+        for (int i = 0; i < plan->count; i++) srcs[i] = plan->units[i].src;
+        scan_module_decls(srcs, plan->count, jobs, provides, requires);
+    }
+    debug("module scan: %d sources in %.3fs\n", plan->count, now_seconds() - start);
+
+    // The graph takes over the names either way, so they are freed with it.
+    for (int i = 0; i < plan->count; i++) {
+        graph->units[i].provides = provides[i];
+        graph->units[i].requires = requires[i];
+        if (provides[i]) graph->units[i].bmi = bmi_path(&plan->tc, dir, provides[i]);
+    }
+    if (rc != 0 || (rc = link_graph(plan, graph, errmsg)) != 0) goto done;
+
+    // clang has to be told where an interface goes; gcc asks the mapper.
+    for (int i = 0; i < plan->count; i++) {
+        const ModuleUnit *m = &graph->units[i];
+        if (!m->bmi || plan->tc.kind != TOOLCHAIN_CLANG) continue;
+
+        char *cmd = str_printf("%s -fmodule-output=%s", plan->units[i].cmd, m->bmi);
+        free(plan->units[i].cmd);
+        plan->units[i].cmd = cmd;
+    }
+    if (make_dirs(dir) != 0 || (plan->tc.kind != TOOLCHAIN_CLANG && write_mapper(graph, mapper) != 0)) {
+        *errmsg = str_printf("Could not create the module directory %s", dir);
+        rc = -1;
+    }
+
+done:
+    free(dir);
+    free(mapper);
+    free(provides);
+    free(requires);
+    free(srcs);
+    return rc;
+}
+
+void free_module_graph(ModuleGraph *graph) {
+    for (int i = 0; graph->units && i < graph->count; i++) {
+        free(graph->units[i].provides);
+        free(graph->units[i].bmi);
+        strlist_free(&graph->units[i].requires);
+        free(graph->units[i].deps);
+    }
+    free(graph->units);
+    free(graph->order);
+    memset(graph, 0, sizeof(*graph));
+}
@@ -1,8 +1,8 @@
 /* ****************************************************************************************************
- * parse.c — Configuration file parser and build command generator. Implements a minimal parser for
- * simple key-value build configuration files. Converts parsed data into a structured Makefile object
- * and assembles platform-aware compiler commands based on the extracted values. Also includes utilities
- * for filename normalization and memory cleanup.
+ * parse.c — Configuration file parser. Implements a minimal parser for simple key-value build
+ * configuration files and converts the parsed data into a structured Makefile object. Turning that
+ * object into compiler commands is the job of build.c. Also includes utilities for filename
+ * normalization and memory cleanup.
  *
  * Intended for use in standalone CLI tools or as part of lightweight build systems. Does not depend on
  * external libraries or parsing frameworks.
@@ -13,12 +13,25 @@
  * ----------------------------------------------------------------------------------------------------
  * Change Log:
  * Sun 2025-06-22 File created.                                                         Version: 00.01
+ * Sun 2026-10-18 Moved run() into build.c.                                             Version: 00.02
+ * Sun 2026-10-18 New workers directive.                                                Version: 00.03
+ * Sun 2026-10-18 New lang directive, c or c++.                                         Version: 00.04
+ * Sun 2026-10-18 New debug directive, split [dwp] [strip].                             Version: 00.05
+ * Sun 2026-10-18 parse_string() for configurations in memory, lines of any length.     Version: 00.06
+ * Sun 2026-10-18 New objdir directive, defaults to ./build.                            Version: 00.07
+ * Sun 2026-10-18 New tests directive.                                                  Version: 00.08
+ * Sun 2026-10-18 New pgo directive.                                                    Version: 00.09
+ * Sun 2026-10-18 New pkg directive.                                                    Version: 00.10
+ * Sun 2026-10-18 New gen directive, one line per rule.                                 Version: 00.11
  * **************************************************************************************************** */
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include "parse.h"
+#include "util.h"
 #include "debug.h"
 
 // --------------------------------------------------------------------------------
@@ -55,11 +68,99 @@ static void set_default_if_null(char **field, const char *fallback) {
 }
 
 // --------------------------------------------------------------------------------
-// Parse a build configuration file and return a populated Makefile struct. Opens
-// the given file and reads key-value pairs line by line, skipping empty lines and
-// comments. Recognized keys include comp, flags (or cflags), target, project, bin,
-// src, and libs. If optional fields like comp, bin, or src are not provided, they
-// are set to sensible defaults. Unknown keys are ignored silently.
+// Replace the value of a field with a copy of a new one, releasing the old value.
+// A key that appears twice in a configuration keeps its last value this way.
+//
+// @param field  Pointer to the target field (char**), may point to NULL
+// @param value  New value
+// --------------------------------------------------------------------------------
+static void replace(char **field, const char *value) {
+    free(*field);
+    *field = dupstr(value);
+}
+
+// --------------------------------------------------------------------------------
+// Add a value to a field that collects one value per line, like gen=. The values
+// are kept in the order of the configuration, separated by line breaks.
+//
+// @param field  Pointer to the target field (char**), may point to NULL
+// @param value  Value to add
+// --------------------------------------------------------------------------------
+static void append_line(char **field, const char *value) {
+    char *joined = *field ? str_printf("%s\n%s", *field, value) : dupstr(value);
+    free(*field);
+    *field = joined;
+}
+
+// --------------------------------------------------------------------------------
+// Check the words of the debug directive: "split" compiles with split DWARF,
+// "dwp" packages the .dwo files next to the output and "strip" moves the debug
+// info of the output into a separate file. dwp only makes sense with split.
+//
+// @param value   The raw debug directive
+// @param errmsg  Set to an allocated message if the directive is unusable
+// @return        0 if the directive is valid, -1 otherwise
+// --------------------------------------------------------------------------------
+static int check_debug(const char *value, char **errmsg) {
+    char *copy = strdup(value);
+    if (!copy) return 0;
+
+    int split = 0, dwp = 0;
+    for (char *word = strtok(copy, " \t"); word; word = strtok(NULL, " \t")) {
+        if (strcmp(word, "split") == 0)      split = 1;
+        else if (strcmp(word, "dwp") == 0)   dwp = 1;
+        else if (strcmp(word, "strip") != 0) {
+            size_t len = snprintf(NULL, 0, "Unknown debug option: %s (use split, dwp or strip)", word) + 1;
+            *errmsg = malloc(len);
+            if (*errmsg) snprintf(*errmsg, len, "Unknown debug option: %s (use split, dwp or strip)", word);
+            free(copy);
+            return -1;
+        }
+    }
+    free(copy);
+
+    if (dwp && !split) {
+        *errmsg = strdup("debug=dwp packages split DWARF, add split.");
+        return -1;
+    }
+    return 0;
+}
+
+// --------------------------------------------------------------------------------
+// Apply one line of a configuration to the Makefile struct. Empty lines and
+// comments are skipped, unknown keys are ignored silently.
+//
+// @param mf    Makefile struct to fill in
+// @param line  One line without its line break
+// --------------------------------------------------------------------------------
+static void parse_line(Makefile *mf, const char *line) {
+    debug(">>> LINE: '%s'\n", line);
+    if (line[0] == '\0' || line[0] == '#') return;
+
+    if (strncmp(line, "comp=", 5) == 0) {
+        replace(&mf->comp, line + 5);
+        debug("Parsed compiler directive as: '%s'\n", mf->comp);
+    }
+    else if (strncmp(line, "flags=", 6) == 0)   replace(&mf->flags, line + 6);
+    else if (strncmp(line, "cflags=", 7) == 0)  replace(&mf->flags, line + 7);
+    else if (strncmp(line, "target=", 7) == 0)  replace(&mf->target, line + 7);
+    else if (strncmp(line, "project=", 8) == 0) replace(&mf->project, line + 8);
+    else if (strncmp(line, "bin=", 4) == 0)     replace(&mf->bin, line + 4);
+    else if (strncmp(line, "src=", 4) == 0)     replace(&mf->src, line + 4);
+    else if (strncmp(line, "libs=", 5) == 0)    replace(&mf->libs, line + 5);
+    else if (strncmp(line, "workers=", 8) == 0) replace(&mf->workers, line + 8);
+    else if (strncmp(line, "lang=", 5) == 0)    replace(&mf->lang, line + 5);
+    else if (strncmp(line, "debug=", 6) == 0)   replace(&mf->debug, line + 6);
+    else if (strncmp(line, "objdir=", 7) == 0)  replace(&mf->objdir, line + 7);
+    else if (strncmp(line, "tests=", 6) == 0)   replace(&mf->tests, line + 6);
+    else if (strncmp(line, "pgo=", 4) == 0)     replace(&mf->pgo, line + 4);
+    else if (strncmp(line, "pkg=", 4) == 0)     replace(&mf->pkg, line + 4);
+    else if (strncmp(line, "gen=", 4) == 0)     append_line(&mf->gen, line + 4);
+}
+
+// --------------------------------------------------------------------------------
+// Parse a build configuration file and return a populated Makefile struct. Reads
+// the whole file and hands it to parse_string(), which does the actual work.
 //
 // The returned Makefile struct reflects the parsed configuration and can be used to construct
 // compiler commands or introspect project metadata. Callers are responsible for freeing the struct
@@ -73,45 +174,72 @@ static void set_default_if_null(char **field, const char *fallback) {
 // @return          Pointer to a populated Makefile, or NULL on failure
 // --------------------------------------------------------------------------------
 Makefile *parse(const char *filename, char **errmsg) {
-    FILE *fp = fopen(filename, "r");
-    if (!fp) {
+    char *text = read_file(filename, NULL);
+    if (!text) {
         size_t len = snprintf(NULL, 0, "Could not open file: %s", filename) + 1;
         *errmsg = malloc(len);
         if (*errmsg) snprintf(*errmsg, len, "Could not open file: %s", filename);
         return NULL;
     }
 
+    Makefile *mf = parse_string(text, errmsg);
+    free(text);
+    return mf;
+}
+
+// --------------------------------------------------------------------------------
+// Parse the text of a build configuration and return a populated Makefile struct.
+// Reads key-value pairs line by line, skipping empty lines and comments. Recognized
+// keys include comp, flags (or cflags), target, project, bin, src, libs, workers,
+// lang, debug, objdir, tests, pgo, pkg and gen; when a key appears twice, the last one wins, except
+// for gen, where every line adds a rule. If optional fields like comp, bin, objdir or src are not
+// provided, they are set to sensible defaults; comp defaults to g++ for lang=c++. Unknown keys are
+// ignored silently.
+//
+// @param text    Null-terminated configuration text, "\n" or "\r\n" line breaks
+// @param errmsg  Pointer to store an error message if parsing fails
+// @return        Pointer to a populated Makefile, or NULL on failure
+// --------------------------------------------------------------------------------
+Makefile *parse_string(const char *text, char **errmsg) {
     Makefile *mf = calloc(1, sizeof(Makefile));
     if (!mf) {
-        fclose(fp);
         *errmsg = strdup("Memory allocation failed for Makefile structure.");
         return NULL;
     }
 
-    char line[256];
-    while (fgets(line, sizeof(line), fp)) {
-        line[strcspn(line, "\n")] = 0;
-        line[strcspn(line, "\r")] = 0;
-        debug(">>> LINE: '%s'\n", line);
-        if (line[0] == '\0' || line[0] == '#') continue;
+    // Lines are copied one at a time, so they can be of any length.
+    const char *p = text;
+    while (*p) {
+        size_t len = strcspn(p, "\n");
+        char *line = malloc(len + 1);
+        if (!line) break;
+        memcpy(line, p, len);
+        line[len] = '\0';
+        line[strcspn(line, "\r")] = '\0';
+        parse_line(mf, line);
+        free(line);
 
-        if (strncmp(line, "comp=", 5) == 0) {
-            mf->comp    = dupstr(line + 5);
-            debug("Parsed compiler directive as: '%s'\n", mf->comp);
-        }
-        else if (strncmp(line, "flags=", 6) == 0) mf->flags = dupstr(line + 6);
-        else if (strncmp(line, "cflags=", 7) == 0) mf->flags = dupstr(line + 7);
-        else if (strncmp(line, "target=", 7) == 0) mf->target  = dupstr(line + 7);
-        else if (strncmp(line, "project=", 8) == 0)mf->project = dupstr(line + 8);
-        else if (strncmp(line, "bin=", 4) == 0)    mf->bin     = dupstr(line + 4);
-        else if (strncmp(line, "src=", 4) == 0)    mf->src     = dupstr(line + 4);
-        else if (strncmp(line, "libs=", 5) == 0)   mf->libs    = dupstr(line + 5);
+        p += len;
+        if (*p) p++;
+    }
+
+    set_default_if_null(&mf->lang, "c");
+    if (strcmp(mf->lang, "c") != 0 && strcmp(mf->lang, "c++") != 0) {
+        size_t len = snprintf(NULL, 0, "Unknown lang: %s (use c or c++)", mf->lang) + 1;
+        *errmsg = malloc(len);
+        if (*errmsg) snprintf(*errmsg, len, "Unknown lang: %s (use c or c++)", mf->lang);
+        free_makefile(mf);
+        return NULL;
     }
 
-    fclose(fp);
+    if (mf->debug && check_debug(mf->debug, errmsg) != 0) {
+        free_makefile(mf);
+        return NULL;
+    }
 
-    set_default_if_null(&mf->comp, "gcc");
+    set_default_if_null(&mf->comp, strcmp(mf->lang, "c++") == 0 ? "g++" : "gcc");
     set_default_if_null(&mf->bin, "./bin");
+    set_default_if_null(&mf->objdir, "./build");
     set_default_if_null(&mf->src, "./src/main.c");
 
     if (!mf->project || !mf->target) {
@@ -123,76 +251,6 @@ Makefile *parse(const char *filename, char **errmsg) {
     return mf;
 }
 
-// --------------------------------------------------------------------------------
-// Construct and execute a build command using the given Makefile configuration. This
-// function assembles a full compiler command string by evaluating the fields in the
-// Makefile: compiler (comp), flags, target type, source files, libraries, output
-// path, and project name. It applies platform-specific behavior to choose
-// appropriate output file extensions based on the target type (e.g., .so, .dll,
-// .obj, etc.).
-//
-// Once constructed, the command is executed using system(). If execution fails,
-// errmsg is set to a descriptive message allocated on the heap. On success, errmsg
-// remains NULL.
-//
-// This approach favors predictability and portability over shell scripting — it
-// gives the build logic a clear C representation, decoupling it from external
-// Makefiles or tooling.
-//
-// @param mf       Pointer to a fully populated Makefile configuration
-// @param errmsg   Output parameter to store an error string if the build fails (NULL on success)
-// --------------------------------------------------------------------------------
-void run(const Makefile *mf, char **errmsg) {
-    char *cmd = malloc(1024);
-    if (!cmd) {
-        *errmsg = strdup("Memory allocation failed for build command.");
-        return;
-    }
-
-    cmd[0] = '\0';
-    snprintf(cmd, 1024, "%s ", mf->comp);
-
-    if (mf->flags) {
-        strncat(cmd, mf->flags, 1023 - strlen(cmd));
-        strncat(cmd, " ", 1023 - strlen(cmd));
-    }
-
-    if (strcmp(mf->target, "lib") == 0) {
-        strncat(cmd, "-shared ", 1023 - strlen(cmd));
-    }
-
-    strncat(cmd, mf->src, 1023 - strlen(cmd));
-    strncat(cmd, " ", 1023 - strlen(cmd));
-
-    if (mf->libs) {
-        strncat(cmd, mf->libs, 1023 - strlen(cmd));
-        strncat(cmd, " ", 1023 - strlen(cmd));
-    }
-
-    strncat(cmd, "-o ", 1023 - strlen(cmd));
-    strncat(cmd, mf->bin, 1023 - strlen(cmd));
-    strncat(cmd, "/", 1023 - strlen(cmd));
-    strncat(cmd, mf->project, 1023 - strlen(cmd));
-
-#ifdef _WIN32
-    if (strcmp(mf->target, "lib") == 0)       strncat(cmd, ".dll", 1023 - strlen(cmd));
-    else if (strcmp(mf->target, "obj") == 0)  strncat(cmd, ".obj", 1023 - strlen(cmd));
-    else                                      strncat(cmd, ".exe", 1023 - strlen(cmd));
-#else
-    if (strcmp(mf->target, "lib") == 0)       strncat(cmd, ".so", 1023 - strlen(cmd));
-    else if (strcmp(mf->target, "obj") == 0)  strncat(cmd, ".o", 1023 - strlen(cmd));
-#endif
-
-    printf("Compiling:\n%s\n", cmd);
-
-    int result = system(cmd);
-    if (result != 0) {
-        *errmsg = strdup("Build command failed.");
-    }
-
-    free(cmd);
-}
-
 // --------------------------------------------------------------------------------
 // Free all memory associated with a Makefile struct. Releases each dynamically
 // allocated field within the struct, followed by the struct itself. This function
@@ -210,6 +268,14 @@ void free_makefile(Makefile *mf) {
     free(mf->bin);
     free(mf->src);
     free(mf->libs);
+    free(mf->workers);
+    free(mf->lang);
+    free(mf->debug);
+    free(mf->objdir);
+    free(mf->tests);
+    free(mf->pgo);
+    free(mf->pkg);
+    free(mf->gen);
     free(mf);
 }
 
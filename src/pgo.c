@@ -0,0 +1,376 @@
+/* ****************************************************************************************************
+ * pgo.c - Implementation of pmake --pgo. Both builds are run() on a copy of the configuration with a
+ * few fields changed: the flags that instrument or use the profile, and for the instrumented build
+ * its own object and bin directory. Everything pmake knows about incremental builds applies to both.
+ *
+ * gcc names a profile after the object file it belongs to, so the objects of the two builds would
+ * never find each other's profiles; -fprofile-prefix-path cuts the object directory off the names.
+ * The merged profile is named after its content, which puts a hash of it into every compile command:
+ * a new profile rebuilds the optimized objects, the same profile leaves them alone.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created.                                                         Version: 00.01
+ * Sun 2026-10-18 PMAKE_PGO_OUTPUT is set for the training command only.                Version: 00.02
+ * **************************************************************************************************** */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "pgo.h"
+#include "toolchain.h"
+#include "util.h"
+
+#ifdef _WIN32
+    #include <windows.h>
+    #include <direct.h>
+    #define getcwd _getcwd
+#else
+    #include <glob.h>
+    #include <errno.h>
+    #include <unistd.h>
+    #include <sys/types.h>
+    #include <sys/wait.h>
+#endif
+
+// Where the instrumented build, the raw profiles and the merged ones go, below the object directory.
+#define PGO_DIR "pgo"
+
+// What the last training run was made with and which profile it left, in the pgo directory.
+#define PGO_STATE "state"
+
+// --------------------------------------------------------------------------------
+// Return a path as an absolute one. The training command may run anywhere, and gcc
+// compares -fprofile-prefix-path with the absolute name of every object.
+// --------------------------------------------------------------------------------
+static char *absolute_path(const char *path) {
+    char cwd[4096];
+    if (path[0] == '/' || path[0] == '\\' || (path[0] && path[1] == ':')) return strdup(path);
+    if (!getcwd(cwd, sizeof(cwd))) return strdup(path);
+    return str_printf("%s/%s", cwd, path);
+}
+
+// --------------------------------------------------------------------------------
+// List the files of a directory that match a pattern such as "*.gcda", sorted.
+// --------------------------------------------------------------------------------
+static void list_files(const char *dir, const char *pattern, StrList *out) {
+#ifdef _WIN32
+    char *all = str_printf("%s\\%s", dir, pattern);
+    WIN32_FIND_DATAA found;
+    HANDLE h = FindFirstFileA(all, &found);
+    if (h != INVALID_HANDLE_VALUE) {
+        do {
+            if (found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+            strlist_push(out, str_printf("%s/%s", dir, found.cFileName));
+        } while (FindNextFileA(h, &found));
+        FindClose(h);
+    }
+    free(all);
+#else
+    char *all = str_printf("%s/%s", dir, pattern);
+    glob_t g;
+    if (glob(all, 0, NULL, &g) == 0) {
+        for (size_t k = 0; k < g.gl_pathc; k++) strlist_push(out, strdup(g.gl_pathv[k]));
+    }
+    globfree(&g);
+    free(all);
+#endif
+}
+
+// --------------------------------------------------------------------------------
+// Remove a file, or a directory together with the files in it.
+// --------------------------------------------------------------------------------
+static void remove_profile(const char *path) {
+    StrList files = {0};
+    list_files(path, "*", &files);
+    for (int i = 0; i < files.count; i++) remove(files.items[i]);
+    strlist_free(&files);
+    remove(path);   // remove() takes empty directories as well
+}
+
+// --------------------------------------------------------------------------------
+// Read the state of the last training run. The profile it left is returned even
+// if the run doesn't match, so it can be removed once a new one replaces it.
+//
+// @param file     The state file
+// @param binary   Hash of the instrumented output
+// @param command  Hash of the training command
+// @param matches  Set to 1 if the last run was made with the same output and
+//                 command and its profile is still there
+// @return         Allocated path of the last profile, or NULL if there is none
+// --------------------------------------------------------------------------------
+static char *load_state(const char *file, uint64_t binary, uint64_t command, int *matches) {
+    *matches = 0;
+    char *data = read_file(file, NULL);
+    if (!data) return NULL;
+
+    uint64_t last_binary = 0, last_command = 0;
+    int used = 0;
+    char *profile = NULL;
+    if (sscanf(data, "%" SCNx64 " %" SCNx64 " %n", &last_binary, &last_command, &used) >= 2 && used > 0) {
+        char *end = data + used + strcspn(data + used, "\r\n");
+        *end = '\0';
+        if (data[used]) profile = strdup(data + used);
+    }
+    free(data);
+
+    *matches = profile && last_binary == binary && last_command == command && file_mtime(profile) >= 0;
+    return profile;
+}
+
+static void save_state(const char *file, uint64_t binary, uint64_t command, const char *profile) {
+    char *line = str_printf("%016" PRIx64 " %016" PRIx64 " %s\n", binary, command, profile);
+    write_file_atomic(file, line, strlen(line));
+    free(line);
+}
+
+// --------------------------------------------------------------------------------
+// Run the training command through the shell with PMAKE_PGO_OUTPUT set for it and
+// what it starts, not for pmake: a program that embeds libpmake keeps its own
+// environment as it was.
+//
+// @param cmd     The training command of pgo=
+// @param output  The instrumented output
+// @return        0 if the command succeeded, nonzero otherwise
+// --------------------------------------------------------------------------------
+static int run_training(const char *cmd, const char *output) {
+#ifdef _WIN32
+    char *line = str_printf("set \"" PGO_OUTPUT_ENV "=%s\" && %s", output, cmd);
+    int rc = system(line);
+    free(line);
+    return rc;
+#else
+    pid_t pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        setenv(PGO_OUTPUT_ENV, output, 1);
+        execl("/bin/sh", "sh", "-c", cmd, (char *)NULL);
+        _exit(127);
+    }
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) return -1;
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+#endif
+}
+
+// --------------------------------------------------------------------------------
+// Collect what the training run left in the raw directory into a profile named
+// after its content. gcc's runtime has already merged the runs into one .gcda
+// file per object, those are copied into a directory; clang's raw profiles are
+// merged by llvm-profdata into a single file.
+//
+// @return  Allocated path of the profile, or NULL with errmsg set
+// --------------------------------------------------------------------------------
+static char *merge_profiles(const Toolchain *tc, const char *pgo_dir, const char *raw_dir,
+                            const char *output, char **errmsg) {
+    StrList raw = {0};
+    char *profile = NULL;
+    list_files(raw_dir, tc->kind == TOOLCHAIN_CLANG ? "*.profraw" : "*.gcda", &raw);
+    if (raw.count == 0) {
+        *errmsg = str_printf("The training left no profile; does the training command run %s?", output);
+        return NULL;
+    }
+
+    if (tc->kind == TOOLCHAIN_CLANG) {
+        char *merged = str_printf("%s/merged.profdata", pgo_dir);
+        StrBuf cmd = {0};
+        sb_printf(&cmd, "%s merge -o %s", tc->profdata, merged);
+        for (int i = 0; i < raw.count; i++) sb_printf(&cmd, " %s", raw.items[i]);
+
+        if (system(cmd.data) != 0) {
+            *errmsg = str_printf("Merging the profiles failed: %s", cmd.data);
+        }
+        else {
+            profile = str_printf("%s/profile-%016" PRIx64 ".profdata", pgo_dir, hash_file(merged));
+            if (replace_file(merged, profile) != 0) {
+                *errmsg = str_printf("Could not write %s.", profile);
+                free(profile);
+                profile = NULL;
+            }
+        }
+        remove(merged);
+        sb_free(&cmd);
+        free(merged);
+    }
+    else {
+        size_t skip = strlen(raw_dir) + 1;
+        uint64_t hash = HASH_SEED;
+        for (int i = 0; i < raw.count; i++) {
+            uint64_t content = hash_file(raw.items[i]);
+            hash = hash_bytes(raw.items[i] + skip, strlen(raw.items[i] + skip), hash);
+            hash = hash_bytes(&content, sizeof(content), hash);
+        }
+
+        profile = str_printf("%s/profile-%016" PRIx64, pgo_dir, hash);
+        int failed = make_dirs(profile) != 0;
+        for (int i = 0; i < raw.count && !failed; i++) {
+            size_t len = 0;
+            char *data = read_file(raw.items[i], &len);
+            char *copy = str_printf("%s/%s", profile, raw.items[i] + skip);
+            failed = !data || write_file_atomic(copy, data, len) != 0;
+            free(copy);
+            free(data);
+        }
+        if (failed) {
+            *errmsg = str_printf("Could not write %s.", profile);
+            free(profile);
+            profile = NULL;
+        }
+    }
+
+    if (profile) printf("Merged %d profile(s) into %s\n", raw.count, profile);
+    strlist_free(&raw);
+    return profile;
+}
+
+BuildResult run_pgo(const Makefile *mf, const BuildOptions *opts, char **errmsg) {
+    BuildResult result = BUILD_OK;
+    Toolchain tc;
+    StrList outputs = {0};
+    char *profile = NULL, *last = NULL, *problem = NULL;
+
+    if (!mf->pgo) {
+        *errmsg = str_printf("%s has no pgo= training command.", mf->project);
+        return BUILD_CONFIG_ERROR;
+    }
+
+    probe_toolchain(mf->comp, &tc);
+    if (tc.kind == TOOLCHAIN_GCC && !tc.profile_prefix) {
+        problem = str_printf("pmake --pgo needs gcc 11 or newer, %s has no -fprofile-prefix-path.", mf->comp);
+    }
+    else if (tc.kind == TOOLCHAIN_CLANG && !tc.profdata) {
+        problem = str_printf("pmake --pgo needs llvm-profdata, there is none for %s.", mf->comp);
+    }
+    else if (tc.kind == TOOLCHAIN_UNKNOWN) {
+        problem = str_printf("pmake --pgo needs gcc or clang, %s is neither.", mf->comp);
+    }
+    if (problem) {
+        *errmsg = problem;
+        free_toolchain(&tc);
+        return BUILD_CONFIG_ERROR;
+    }
+
+    char *objdir = object_dir(mf);
+    char *pgo_dir = str_printf("%s/" PGO_DIR, objdir);
+    char *instr_objdir = str_printf("%s/instr", pgo_dir);
+    char *instr_bin = str_printf("%s/bin", pgo_dir);
+    char *raw_dir = str_printf("%s/raw", pgo_dir);
+    char *state_file = str_printf("%s/" PGO_STATE, pgo_dir);
+    char *abs_objdir = absolute_path(objdir);
+    char *abs_instr = absolute_path(instr_objdir);
+    char *abs_raw = absolute_path(raw_dir);
+    char *instr_flags, *use_flags = NULL;
+
+    // %m names a raw profile after the binary, and clang's runtime merges runs into it.
+    const char *flags = mf->flags ? mf->flags : "";
+    const char *space = mf->flags ? " " : "";
+    if (tc.kind == TOOLCHAIN_CLANG) {
+        instr_flags = str_printf("%s%s-fprofile-instr-generate=%s/%%m.profraw", flags, space, abs_raw);
+    }
+    else {
+        instr_flags = str_printf("%s%s-fprofile-generate=%s -fprofile-prefix-path=%s", flags, space, abs_raw,
+                                 abs_instr);
+    }
+
+    // The instrumented build: no debug steps, no tests, and no workers, which
+    // couldn't share the profiles.
+    Makefile instr = *mf;
+    instr.flags = instr_flags;
+    instr.objdir = instr_objdir;
+    instr.bin = instr_bin;
+    instr.workers = NULL;
+    instr.debug = NULL;
+    instr.tests = NULL;
+
+    BuildOptions instr_opts = *opts;
+    instr_opts.stats = 0;
+    instr_opts.stats_json = NULL;
+    instr_opts.report = NULL;
+    instr_opts.tests = 0;
+
+    printf("Instrumented build in %s\n", instr_bin);
+    fflush(stdout);
+    result = run(&instr, &instr_opts, errmsg);
+    if (result != BUILD_OK) goto done;
+
+    build_outputs(&instr, &outputs);
+    const char *output = outputs.items[0];
+    if (opts->dry_run) {
+        printf("%s=%s %s\n", PGO_OUTPUT_ENV, output, mf->pgo);
+        goto done;
+    }
+
+    // The training only runs if the instrumented output or the command changed.
+    uint64_t binary = hash_file(output);
+    uint64_t command = hash_bytes(mf->pgo, strlen(mf->pgo), HASH_SEED);
+    int matches = 0;
+    last = load_state(state_file, binary, command, &matches);
+    if (matches) {
+        printf("Training skipped, %s and the training command are unchanged.\n", output);
+        profile = strdup(last);
+    }
+    else {
+        remove_profile(raw_dir);
+        make_dirs(raw_dir);
+        printf("Training: %s\n", mf->pgo);
+        fflush(stdout);
+        if (run_training(mf->pgo, output) != 0) {
+            *errmsg = str_printf("The training command failed: %s", mf->pgo);
+            result = BUILD_PGO_FAILED;
+            goto done;
+        }
+
+        profile = merge_profiles(&tc, pgo_dir, raw_dir, output, errmsg);
+        if (!profile) {
+            result = BUILD_PGO_FAILED;
+            goto done;
+        }
+        if (last && strcmp(last, profile) != 0) remove_profile(last);
+        save_state(state_file, binary, command, profile);
+    }
+
+    // The optimized build, into the usual directories.
+    char *abs_profile = absolute_path(profile);
+    if (tc.kind == TOOLCHAIN_CLANG) {
+        use_flags = str_printf("%s%s-fprofile-instr-use=%s", flags, space, abs_profile);
+    }
+    else {
+        use_flags = str_printf("%s%s-fprofile-use=%s -fprofile-prefix-path=%s", flags, space, abs_profile,
+                               abs_objdir);
+    }
+    free(abs_profile);
+
+    Makefile optimized = *mf;
+    optimized.flags = use_flags;
+    optimized.workers = NULL;
+
+    printf("Optimized build with %s\n", profile);
+    fflush(stdout);
+    result = run(&optimized, opts, errmsg);
+
+done:
+    strlist_free(&outputs);
+    free(profile);
+    free(last);
+    free(use_flags);
+    free(instr_flags);
+    free(abs_raw);
+    free(abs_instr);
+    free(abs_objdir);
+    free(state_file);
+    free(raw_dir);
+    free(instr_bin);
+    free(instr_objdir);
+    free(pgo_dir);
+    free(objdir);
+    free_toolchain(&tc);
+    return result;
+}
@@ -0,0 +1,236 @@
+/* ****************************************************************************************************
+ * pkg.c - Implementation of pkg=. pkg-config runs through the shell like the compiler probes, its
+ * standard output is the answer and its error messages go straight to the terminal, where they are
+ * more useful than anything pmake could make of them.
+ *
+ * The cache record is plain "key=value" text like the toolchain record, one file per package list,
+ * named after a hash of everything that changes pkg-config's answer besides the .pc files. The files
+ * it was read from are found by asking pkg-config where every package lives and what it requires,
+ * and their modification times are taken before the flags are asked: a .pc file that changes in
+ * between makes the record stale rather than wrong.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created.                                                         Version: 00.01
+ * **************************************************************************************************** */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <inttypes.h>
+#include "pkg.h"
+#include "util.h"
+#include "debug.h"
+
+#ifdef _WIN32
+    #define popen _popen
+    #define pclose _pclose
+    #define NULL_DEVICE "NUL"
+#else
+    #define NULL_DEVICE "/dev/null"
+#endif
+
+// The variables that change where pkg-config looks for .pc files.
+static const char *const PKG_ENV[] = { "PKG_CONFIG_PATH", "PKG_CONFIG_LIBDIR", "PKG_CONFIG_SYSROOT_DIR" };
+
+// --------------------------------------------------------------------------------
+// Run a pkg-config command and collect what it prints, without the trailing
+// line break.
+//
+// @param cmd  Command line, run by the shell
+// @param out  Receives the allocated output, "" if there was none
+// @return     0 if the command exited with 0, -1 otherwise
+// --------------------------------------------------------------------------------
+static int run_tool(const char *cmd, char **out) {
+    debug("pkg: %s\n", cmd);
+    StrBuf sb = {0};
+    sb_append(&sb, "", 0);
+
+    FILE *pipe = popen(cmd, "r");
+    if (!pipe) {
+        *out = sb.data;
+        return -1;
+    }
+
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), pipe)) > 0) sb_append(&sb, buf, n);
+    int rc = pclose(pipe);
+
+    while (sb.len > 0 && isspace((unsigned char)sb.data[sb.len - 1])) sb.data[--sb.len] = '\0';
+    *out = sb.data;
+    return rc == 0 ? 0 : -1;
+}
+
+// --------------------------------------------------------------------------------
+// Find the .pc files of the packages and of everything they require, directly or
+// through other packages, public or private. A package pkg-config doesn't know
+// is left out quietly; asking for its flags reports it.
+//
+// @param tool      pkg-config to ask
+// @param packages  Package names of the directive
+// @param pc        List that receives the paths of the .pc files
+// --------------------------------------------------------------------------------
+static void find_pc_files(const char *tool, const StrList *packages, StrList *pc) {
+    StrList todo = {0}, seen = {0};
+    for (int i = 0; i < packages->count; i++) strlist_push(&todo, strdup(packages->items[i]));
+
+    for (int i = 0; i < todo.count; i++) {
+        const char *name = todo.items[i];
+        int known = 0;
+        for (int k = 0; k < seen.count && !known; k++) known = strcmp(seen.items[k], name) == 0;
+        if (known) continue;
+        strlist_push(&seen, strdup(name));
+
+        char *out = NULL;
+        char *cmd = str_printf("%s --variable=pcfiledir %s 2>" NULL_DEVICE, tool, name);
+        if (run_tool(cmd, &out) == 0 && *out) strlist_push(pc, str_printf("%s/%s.pc", out, name));
+        free(cmd);
+        free(out);
+
+        // One requirement per line, a version constraint may follow the name.
+        cmd = str_printf("%s --print-requires --print-requires-private %s 2>" NULL_DEVICE, tool, name);
+        if (run_tool(cmd, &out) == 0) {
+            for (char *line = out; *line;) {
+                char *end = line + strcspn(line, "\n");
+                size_t len = strcspn(line, " \t\n");
+                if (len > 0) strlist_push(&todo, str_printf("%.*s", (int)len, line));
+                line = *end ? end + 1 : end;
+            }
+        }
+        free(cmd);
+        free(out);
+    }
+
+    strlist_free(&todo);
+    strlist_free(&seen);
+}
+
+static void set_value(char **field, const char *value) {
+    free(*field);
+    *field = strdup(value);
+}
+
+// --------------------------------------------------------------------------------
+// Read a cached record if it was made for this package list and every .pc file
+// it lists still has the modification time it had then.
+//
+// @return  1 if the record was loaded into cflags and libs, 0 otherwise
+// --------------------------------------------------------------------------------
+static int load_record(const char *file, const char *packages, char **cflags, char **libs) {
+    char *data = read_file(file, NULL);
+    if (!data) return 0;
+
+    int format = 0, matches = 0, current = 1;
+    char *line = data;
+    while (*line) {
+        char *end = strchr(line, '\n');
+        if (end) *end = '\0';
+
+        char *eq = strchr(line, '=');
+        if (eq) {
+            *eq = '\0';
+            const char *key = line, *value = eq + 1;
+
+            if (strcmp(key, "format") == 0)         format = atoi(value);
+            else if (strcmp(key, "packages") == 0)  matches = strcmp(value, packages) == 0;
+            else if (strcmp(key, "cflags") == 0)    set_value(cflags, value);
+            else if (strcmp(key, "libs") == 0)      set_value(libs, value);
+            else if (strcmp(key, "pc") == 0) {
+                char *space = strchr(value, ' ');
+                current &= space && atoll(value) == file_mtime(space + 1);
+            }
+        }
+
+        if (!end) break;
+        line = end + 1;
+    }
+    free(data);
+
+    if (format == PKG_FORMAT && matches && current && *cflags && *libs) return 1;
+
+    free(*cflags);
+    free(*libs);
+    *cflags = NULL;
+    *libs = NULL;
+    return 0;
+}
+
+// --------------------------------------------------------------------------------
+// Write a record to the cache. A cache that can't be written only means the next
+// build asks pkg-config again, so failures are ignored.
+// --------------------------------------------------------------------------------
+static void save_record(const char *file, const char *packages, const char *cflags, const char *libs,
+                        const StrList *pc, const long long *mtimes) {
+    StrBuf sb = {0};
+    sb_printf(&sb, "format=%d\npackages=%s\ncflags=%s\nlibs=%s\n", PKG_FORMAT, packages, cflags, libs);
+    for (int i = 0; i < pc->count; i++) sb_printf(&sb, "pc=%lld %s\n", mtimes[i], pc->items[i]);
+
+    if (make_parent_dirs(file) == 0) write_file_atomic(file, sb.data, sb.len);
+    sb_free(&sb);
+}
+
+int resolve_packages(const char *packages, char **cflags, char **libs, char **errmsg) {
+    const char *tool = getenv("PKG_CONFIG");
+    if (!tool || !*tool) tool = "pkg-config";
+    *cflags = NULL;
+    *libs = NULL;
+
+    StrList names = {0};
+    StrBuf list = {0};
+    split_words(packages, &names);
+    sb_append(&list, "", 0);
+    for (int i = 0; i < names.count; i++) sb_printf(&list, "%s%s", i ? " " : "", names.items[i]);
+
+    uint64_t key = hash_bytes(tool, strlen(tool) + 1, HASH_SEED);
+    key = hash_bytes(list.data, list.len + 1, key);
+    for (size_t i = 0; i < sizeof(PKG_ENV) / sizeof(PKG_ENV[0]); i++) {
+        const char *value = getenv(PKG_ENV[i]);
+        key = hash_bytes(value ? "=" : "-", 1, key);
+        if (value) key = hash_bytes(value, strlen(value) + 1, key);
+    }
+
+    char *dir = cache_dir();
+    char *file = dir ? str_printf("%s/pkg-%016" PRIx64, dir, key) : NULL;
+    int rc = 0;
+    if (names.count == 0 || (file && load_record(file, list.data, cflags, libs))) goto done;
+
+    StrList pc = {0};
+    find_pc_files(tool, &names, &pc);
+    long long *mtimes = calloc((size_t)pc.count + 1, sizeof(long long));
+    for (int i = 0; mtimes && i < pc.count; i++) mtimes[i] = file_mtime(pc.items[i]);
+
+    char *cmd = str_printf("%s --cflags %s", tool, list.data);
+    rc = run_tool(cmd, cflags);
+    free(cmd);
+    if (rc == 0) {
+        cmd = str_printf("%s --libs %s", tool, list.data);
+        rc = run_tool(cmd, libs);
+        free(cmd);
+    }
+
+    if (rc != 0) {
+        *errmsg = str_printf("pkg-config couldn't resolve pkg=%s.", list.data);
+        free(*cflags);
+        free(*libs);
+        *cflags = NULL;
+        *libs = NULL;
+    }
+    else if (file && mtimes) {
+        save_record(file, list.data, *cflags, *libs, &pc, mtimes);
+    }
+    free(mtimes);
+    strlist_free(&pc);
+
+done:
+    free(file);
+    free(dir);
+    sb_free(&list);
+    strlist_free(&names);
+    return rc;
+}
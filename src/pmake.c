@@ -19,6 +19,8 @@
 // If you'd rather hand the work off to a file, you've got options.
 // Use `pmake.pmake` for self-compilation, `Makefile` for tradition,
 // or `CMakeLists.txt` if that’s your flavor.
+// The last two also build libpmake (lib/libpmake.a and lib/libpmake.so), all of pmake but
+// the command line as a library for programs that drive builds themselves; see include/pmake.h.
 //
 // Installation scripts are available too if you want `pmake` as a system-wide tool available.
 // Check out `scripts/install.sh` for Unix-like systems or `install.cmd` on Windows.
@@ -49,6 +51,24 @@
 // Sun 2025-06-22 Complete overhaul of this tool, because of an unfixable bug.              Version: 00.20
 // Tue 2025-06-24 Renewed the manpage style help text because of its new functionality.     Version: 00.21
 // Tue 2025-06-25 Updated the manpage style help text.                                      Version: 00.22 
+// Sun 2026-10-18 Compiles units as concurrent jobs (-j) with de-interleaved output.        Version: 00.23
+// Sun 2026-10-18 Fail-fast by default, --keep-going, exit codes per kind of failure.       Version: 00.24
+// Sun 2026-10-18 --compdb writes compile_commands.json without compiling.                  Version: 00.25
+// Sun 2026-10-18 Incremental builds with -n/--dry-run and --explain.                       Version: 00.26
+// Sun 2026-10-18 Build statistics summary, --stats and --stats-json=FILE.                  Version: 00.27
+// Sun 2026-10-18 Help text compiled in and piped to $PAGER, no manual file re-read.        Version: 00.28
+// Sun 2026-10-18 Distributed compilation on pmake-worker daemons (workers=).               Version: 00.29
+// Sun 2026-10-18 Cached toolchain probing, --toolchain shows the record.                   Version: 00.30
+// Sun 2026-10-18 Built-in #include scanner, --scan-deps prints what it finds.              Version: 00.31
+// Sun 2026-10-18 lang=c++ with C++20 modules, compiled in module dependency order.         Version: 00.32
+// Sun 2026-10-18 Relink only when an object's content changed (early cutoff).              Version: 00.33
+// Sun 2026-10-18 debug=split with gdb index, dwp packaging and strip after the link.       Version: 00.34
+// Sun 2026-10-18 Thin command line over libpmake and its C API in pmake.h.                 Version: 00.35
+// Sun 2026-10-18 objdir= for objects (tmpfs too), outputs replaced atomically.             Version: 00.36
+// Sun 2026-10-18 pmake test: tests= built and run in parallel, --shard and --timeout.      Version: 00.37
+// Sun 2026-10-18 --pgo: instrumented build, training run of pgo= and optimized build.      Version: 00.38
+// Sun 2026-10-18 gen= rules generate sources side by side, skipped while up to date.       Version: 00.39
+// Sun 2026-10-18 The command stops on SIGINT and SIGTERM, the library only if asked.       Version: 00.40
 // -----------------------------------------------------------------------------------------------------
 // To Do's:
 // - Take cVersion.h & cVersion.c appart and integrate it directly into this code base.             Done.                             Done.
@@ -66,35 +86,127 @@
 #include <string.h>
 
 // Project headers — the parts that breathe life into this tool. Here’s where things get specific:
-// `parse.h` defines how we read the `.pmake` file, `debug.h` helps us talk to ourselves when things
-// go sideways, `version.h` keeps the numbers honest, and `manpage.h` handles the help text so the user
-// isn’t left guessing. These aren’t just utilities — they’re the behaviors that make `pmake` act like
-// a tool, not just a compiled blob.
-#include "parse.h"
+// `pmake.h` is libpmake, which reads the `.pmake` file and turns it into compiler jobs — the command is
+// only a front end to it, like any other program that embeds the library. `debug.h` helps us talk to
+// ourselves when things go sideways, `version.h` keeps the numbers honest, and `manpage.h` handles the
+// help text so the user isn’t left guessing. These aren’t just utilities — they’re the behaviors that
+// make `pmake` act like a tool, not just a compiled blob.
+#include "pmake.h"
 #include "debug.h"
 #include "version.h"
 #include "manpage.h"
 
+// What the user wants pmake to do with the project. Building is the default; the other commands
+// reuse the same parsed configuration for something else.
+typedef enum {
+    CMD_BUILD,      // Compile and link the project
+    CMD_TEST,       // Build the project and its tests, then run the tests
+    CMD_PGO,        // Build instrumented, train, and build again with the profile
+    CMD_COMPDB,     // Write compile_commands.json and stop
+    CMD_TOOLCHAIN,  // Show what the configured compiler can do and stop
+    CMD_SCAN_DEPS   // Print the headers the include scanner finds and stop
+} Command;
+
+// -----------------------------------------------------------------------------------------------------
+// Walk the command line after the help and version checks. Options start with a dash and may appear
+// before or after the project name; the one argument that isn't an option is the project — unless
+// there are two and the first is `test`, which makes it `pmake test <project>`. Anything unknown is
+// reported instead of silently ignored — a typo shouldn't start a build you didn't ask for.
+//
+// @param argc     Number of arguments passed to the program
+// @param argv     The actual arguments, starting with the program name itself
+// @param opts     Build options to fill in (already holding their defaults)
+// @param cmd      Receives the command to carry out
+// @param project  Receives the project argument
+// @return         0 on success, -1 if the command line doesn't make sense
+// -----------------------------------------------------------------------------------------------------
+static int parse_args(int argc, char **argv, PmakeOptions *opts, Command *cmd, const char **project) {
+    *project = NULL;
+    *cmd = CMD_BUILD;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+
+        if (strcmp(a, "-j") == 0 || strcmp(a, "--jobs") == 0) {
+            if (i + 1 >= argc) {
+                printf("Error: %s needs a number.\n", a);
+                return -1;
+            }
+            opts->jobs = atoi(argv[++i]);
+        }
+        else if (strncmp(a, "--jobs=", 7) == 0) opts->jobs = atoi(a + 7);
+        else if (strcmp(a, "-k") == 0 || strcmp(a, "--keep-going") == 0) opts->keep_going = 1;
+        else if (strcmp(a, "-n") == 0 || strcmp(a, "--dry-run") == 0)    opts->dry_run = 1;
+        else if (strcmp(a, "--explain") == 0)   opts->explain = 1;
+        else if (strcmp(a, "--stats") == 0)     opts->stats = 1;
+        else if (strncmp(a, "--stats-json=", 13) == 0) opts->stats_json = a + 13;
+        else if (strcmp(a, "--compdb") == 0)    *cmd = CMD_COMPDB;
+        else if (strcmp(a, "--pgo") == 0)       *cmd = CMD_PGO;
+        else if (strcmp(a, "--toolchain") == 0) *cmd = CMD_TOOLCHAIN;
+        else if (strcmp(a, "--scan-deps") == 0) *cmd = CMD_SCAN_DEPS;
+        else if (strncmp(a, "--shard=", 8) == 0) {
+            char end = '\0';
+            if (sscanf(a + 8, "%d/%d%c", &opts->shard, &opts->shards, &end) != 2
+                || opts->shards < 1 || opts->shard < 1 || opts->shard > opts->shards) {
+                printf("Error: --shard needs i/n with 1 <= i <= n, like --shard=2/4.\n");
+                return -1;
+            }
+        }
+        else if (strncmp(a, "--timeout=", 10) == 0) {
+            char *end = NULL;
+            opts->test_timeout = strtod(a + 10, &end);
+            if (end == a + 10 || *end || opts->test_timeout < 0) {
+                printf("Error: --timeout needs a number of seconds, 0 for none.\n");
+                return -1;
+            }
+        }
+        else if (strncmp(a, "-j", 2) == 0)      opts->jobs = atoi(a + 2);
+        else if (a[0] == '-') {
+            printf("Error: Unknown option: %s\n", a);
+            return -1;
+        }
+        else if (*project && *cmd == CMD_BUILD && strcmp(*project, "test") == 0) {
+            *cmd = CMD_TEST;
+            *project = a;
+        }
+        else if (*project) {
+            printf("Error: Only one project can be built at a time.\n");
+            return -1;
+        }
+        else *project = a;
+    }
+
+    if (opts->jobs < 1) {
+        printf("Error: The number of jobs must be at least 1.\n");
+        return -1;
+    }
+    if (!*project) {
+        printf("Error: No project given.\n");
+        return -1;
+    }
+    return 0;
+}
+
 // -----------------------------------------------------------------------------------------------------
 // int main(int argc, char **argv) - This is where execution begins. The main-function serves as the
 // entry point for all C and C++ programs that actually do something. When arguments are provided,
 // they’re passed through `argc` (the argument count) and `argv` (argument vector) holds the actual inputs
 // as strings — the first one’s always the program name.
 // 
-// The function returns an exit status to the operating system. I use EXIT_SUCCESS and EXIT_FAILURE —
-// symbolic constants defined in <stdlib.h> — instead of raw integers like 0 or 1. It keeps things clear,
-// portable, and easy to read.
+// The function returns an exit status to the operating system. I use EXIT_SUCCESS and the PmakeResult
+// values from pmake.h instead of raw integers. A broken configuration, a compile error and a link error
+// each get their own code, so a CI script can tell them apart without reading the output.
 // 
 // @param argc  Number of arguments passed to the program
 // @param argv  The actual arguments, starting with the program name itself
-// @return      EXIT_SUCCESS on successful completion, EXIT_FAILURE if something goes wrong
+// @return      EXIT_SUCCESS on successful completion, a PmakeResult code if something goes wrong
 // -----------------------------------------------------------------------------------------------------
 int main(int argc, char **argv) {
 
     // Create a version struct with major and minor numbers. I use the major number to signal builds or
     // cohesive releases, and the minor to track internal advancements — bugfixes, new features, or
     // meaningful changes since the file was created. The numbers evolve, but the structure stays the same.
-    Version v = create_version(0, 22);
+    Version v = create_version(0, 39);
     
     // If no arguments were provided, or the user asked for help explicitly, print the help text and exit
     // cleanly. A program that can’t explain itself isn’t ready to be used — this one does, and it does
@@ -114,54 +226,77 @@ int main(int argc, char **argv) {
         return EXIT_SUCCESS;
     }
 
+    // Sort out the options and the project name. The options start with their defaults, so a plain
+    // `pmake <project>` keeps working exactly as before — just on every core instead of one.
+    PmakeOptions opts;
+    Command cmd;
+    const char *name = NULL;
+    pmake_default_options(&opts);
+    opts.catch_signals = 1;
+    if (parse_args(argc, argv, &opts, &cmd, &name) != 0) {
+        return PMAKE_CONFIG_ERROR;
+    }
+
     // In case something goes wrong, the error message is stored here.
     char *errmsg = NULL;
     
     // Normalize the filename from the user's input.
     // Then debug it, so we know what we're working with.
-    char *filename = normalize_filename(argv[1]);
+    char *filename = pmake_config_file(name);
     debug("filename = '%s'\n", filename); 
     
-    // Parse the provided `.pmake` file into a structured format.
-    // This returns a Makefile pointer with all relevant fields filled out — or
+    // Load the provided `.pmake` file into a project.
+    // This returns the parsed configuration with all relevant fields filled out — or
     // sets `errmsg` if something goes wrong before we can proceed.
-    Makefile *mf = parse(filename, &errmsg);
-    
-    // Debugging output to help understand what the program is doing. This is useful during development.
-    // Debug outputs can be turned on with the `-DDEBUG` flag during compilation.
-    debug("comp    = '%s'\n", mf->comp);
-    debug("flags   = '%s'\n", mf->flags);
-    debug("target  = '%s'\n", mf->target);
-    debug("bin     = '%s'\n", mf->bin);
-    debug("src     = '%s'\n", mf->src);
-    debug("libs    = '%s'\n", mf->libs);
-    debug("project = '%s'\n", mf->project);
+    PmakeProject *project = pmake_load(filename, &errmsg);
+    pmake_free_string(filename);
 
     // If an error message was returned during parsing or setup, print it, clean up the allocated string,
     // and exit with failure. The message goes to stdout — this tool doesn't pretend it's more than it is.
     if (errmsg) {
         printf("Error: %s\n", errmsg);
-        free(errmsg);
-        free_makefile(mf);
-        return EXIT_FAILURE;
+        pmake_free_string(errmsg);
+        pmake_free(project);
+        return PMAKE_CONFIG_ERROR;
     }
 
-    // Kick off the build process using the parsed makefile. If something goes wrong, `errmsg` gets
-    // populated and handled downstream. `run()` is the part that turns config into action.
-    run(mf, &errmsg);
+    // Debugging output to help understand what the program is doing. This is useful during development.
+    // Debug outputs can be turned on with the `-DDEBUG` flag during compilation.
+    debug("comp    = '%s'\n", pmake_get(project, "comp"));
+    debug("flags   = '%s'\n", pmake_get(project, "flags"));
+    debug("target  = '%s'\n", pmake_get(project, "target"));
+    debug("bin     = '%s'\n", pmake_get(project, "bin"));
+    debug("src     = '%s'\n", pmake_get(project, "src"));
+    debug("libs    = '%s'\n", pmake_get(project, "libs"));
+    debug("project = '%s'\n", pmake_get(project, "project"));
+
+    // Kick off the build process using the loaded project. If something goes wrong, `errmsg` gets
+    // populated and handled downstream. `pmake_build()` is the part that turns config into action. For
+    // the compilation database, the same configuration is only planned and written out. --toolchain
+    // shows what pmake found out about the compiler — probed now, or straight from the cache.
+    // --scan-deps shows which headers every source pulls in, without asking the compiler. `pmake test`
+    // builds like `pmake_build()` and then runs the tests on top. --pgo builds twice, with the training
+    // run of pgo= in between.
+    PmakeResult result = PMAKE_OK;
+    if (cmd == CMD_COMPDB)          result = pmake_write_compdb(project, NULL, &errmsg);
+    else if (cmd == CMD_TOOLCHAIN)  result = pmake_print_toolchain(project);
+    else if (cmd == CMD_SCAN_DEPS)  result = pmake_print_scanned_deps(project, opts.jobs, &errmsg);
+    else if (cmd == CMD_TEST)       result = pmake_test(project, &opts, NULL, &errmsg);
+    else if (cmd == CMD_PGO)        result = pmake_pgo(project, &opts, NULL, &errmsg);
+    else                            result = pmake_build(project, &opts, NULL, &errmsg);
 
     // If something broke during execution, report the error, free the dynamically allocated error
-    // message, and clean up the makefile data. Leaving no mess behind — even when things don't go
+    // message, and clean up the project. Leaving no mess behind — even when things don't go
     // according to plan.
     if (errmsg) {
         printf("Error: %s\n", errmsg);
-        free(errmsg);
-        free_makefile(mf);
-        return EXIT_FAILURE;
+        pmake_free_string(errmsg);
+        pmake_free(project);
+        return result;
     }
 
-    // Clean up any remaining data tied to the makefile before exiting successfully.
-    // If we made it here, the build ran without errors — no drama, no leftovers.
-    free_makefile(mf);
-    return EXIT_SUCCESS;
-}
\ No newline at end of file
+    // Clean up the project before exiting. If we made it here, the build ran without errors — no
+    // drama, no leftovers. Only --toolchain can still report a missing compiler.
+    pmake_free(project);
+    return result;
+}
@@ -0,0 +1,407 @@
+/* ****************************************************************************************************
+ * remote.c - Client side of distributed compilation and the wire format shared with pmake-worker. A
+ * remote compile runs inside the forked child of a job, so blocking socket calls are fine here: the
+ * pool keeps polling the other jobs, and a SIGTERM from fail-fast mode ends a stuck transfer just like
+ * it ends a local compiler.
+ *
+ * Windows has no fork(), so there every unit is compiled locally and the workers are ignored.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created.                                                         Version: 00.01
+ * Sun 2026-10-18 Connect failures get a note of their own, worker_went_down().         Version: 00.02
+ * Sun 2026-10-18 Workers get the compiler's name only, they run their own.             Version: 00.03
+ * Sun 2026-10-18 Down workers reported through down_pipe, not matched in the output.   Version: 00.04
+ * **************************************************************************************************** */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "remote.h"
+#include "util.h"
+#include "debug.h"
+
+#ifndef _WIN32
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <errno.h>
+    #include <signal.h>
+    #include <netdb.h>
+    #include <sys/types.h>
+    #include <sys/socket.h>
+    #include <sys/time.h>
+    #include <sys/wait.h>
+    #include <arpa/inet.h>
+#endif
+
+// How long to wait for a worker to accept the connection, and for its reply. The
+// reply timeout is generous because it includes the compile itself.
+#define CONNECT_TIMEOUT_MS  2000
+#define REPLY_TIMEOUT_S     600
+
+int parse_workers(const char *spec, WorkerList *out, char **errmsg) {
+    StrList words = {0};
+    memset(out, 0, sizeof(*out));
+    split_words(spec, &words);
+    if (words.count == 0) return 0;
+
+    out->items = calloc((size_t)words.count, sizeof(Worker));
+    if (!out->items) {
+        *errmsg = strdup("Memory allocation failed for the worker list.");
+        strlist_free(&words);
+        return -1;
+    }
+
+    for (int i = 0; i < words.count; i++) {
+        char *w = words.items[i];
+        Worker *wk = &out->items[out->count++];
+        wk->slots = WORKER_DEFAULT_SLOTS;
+
+        char *slash = strchr(w, '/');
+        if (slash) {
+            *slash = '\0';
+            wk->slots = atoi(slash + 1);
+        }
+
+        // "[::1]:3733" keeps the colons of an IPv6 address apart from the port.
+        char *host = w;
+        char *colon = NULL;
+        if (*w == '[') {
+            char *close = strchr(w, ']');
+            if (close) {
+                host = w + 1;
+                *close = '\0';
+                if (close[1] == ':') colon = close + 1;
+            }
+        }
+        else {
+            colon = strrchr(w, ':');
+        }
+        if (colon) *colon = '\0';
+
+        const char *port = colon ? colon + 1 : WORKER_DEFAULT_PORT;
+        if (!*host || !*port || wk->slots < 1) {
+            *errmsg = str_printf("Invalid entry in workers: %s (expected host[:port][/slots])",
+                                 words.items[i]);
+            strlist_free(&words);
+            free_workers(out);
+            return -1;
+        }
+        wk->host = strdup(host);
+        wk->port = strdup(port);
+    }
+
+    strlist_free(&words);
+    return 0;
+}
+
+void free_workers(WorkerList *list) {
+    for (int i = 0; i < list->count; i++) {
+        free(list->items[i].host);
+        free(list->items[i].port);
+    }
+    free(list->items);
+    memset(list, 0, sizeof(*list));
+}
+
+#ifdef _WIN32
+
+int open_down_report(RemoteCompile *rc) {
+    rc->down_pipe[0] = rc->down_pipe[1] = -1;
+    return -1;
+}
+
+int worker_went_down(RemoteCompile *rc) {
+    (void)rc;
+    return 0;
+}
+
+int remote_compile(void *arg) {
+    const RemoteCompile *rc = arg;
+    return system(rc->local_cmd);
+}
+
+int wire_write_u32(int fd, uint32_t value)                  { (void)fd; (void)value; return -1; }
+int wire_write_field(int fd, const void *data, size_t len)  { (void)fd; (void)data; (void)len; return -1; }
+int wire_read_u32(int fd, uint32_t *value)                  { (void)fd; (void)value; return -1; }
+int wire_read_field(int fd, char **data, size_t *len)       { (void)fd; (void)data; (void)len; return -1; }
+
+#else
+
+int open_down_report(RemoteCompile *rc) {
+    rc->down_pipe[0] = rc->down_pipe[1] = -1;
+    if (pipe(rc->down_pipe) != 0) {
+        rc->down_pipe[0] = rc->down_pipe[1] = -1;
+        return -1;
+    }
+
+    // Neither end is for the compilers; pmake only reads once the job is done,
+    // and an empty pipe must not block it then.
+    fcntl(rc->down_pipe[0], F_SETFD, FD_CLOEXEC);
+    fcntl(rc->down_pipe[1], F_SETFD, FD_CLOEXEC);
+    fcntl(rc->down_pipe[0], F_SETFL, O_NONBLOCK);
+    return 0;
+}
+
+int worker_went_down(RemoteCompile *rc) {
+    char flag = 0;
+    if (rc->down_pipe[0] < 0) return 0;
+
+    ssize_t n;
+    do {
+        n = read(rc->down_pipe[0], &flag, 1);
+    } while (n < 0 && errno == EINTR);
+    close(rc->down_pipe[0]);
+    close(rc->down_pipe[1]);
+    rc->down_pipe[0] = rc->down_pipe[1] = -1;
+    return n == 1;
+}
+
+static int write_all(int fd, const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int read_all(int fd, void *data, size_t len) {
+    char *p = data;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+int wire_write_u32(int fd, uint32_t value) {
+    uint32_t net = htonl(value);
+    return write_all(fd, &net, sizeof(net));
+}
+
+int wire_write_field(int fd, const void *data, size_t len) {
+    if (len > REMOTE_MAX_FIELD) return -1;
+    if (wire_write_u32(fd, (uint32_t)len) != 0) return -1;
+    return write_all(fd, data, len);
+}
+
+int wire_read_u32(int fd, uint32_t *value) {
+    uint32_t net;
+    if (read_all(fd, &net, sizeof(net)) != 0) return -1;
+    *value = ntohl(net);
+    return 0;
+}
+
+int wire_read_field(int fd, char **data, size_t *len) {
+    uint32_t n;
+    *data = NULL;
+    if (wire_read_u32(fd, &n) != 0 || n > REMOTE_MAX_FIELD) return -1;
+
+    char *buf = malloc((size_t)n + 1);
+    if (!buf) return -1;
+    if (read_all(fd, buf, n) != 0) {
+        free(buf);
+        return -1;
+    }
+    buf[n] = '\0';
+    *data = buf;
+    if (len) *len = n;
+    return 0;
+}
+
+// --------------------------------------------------------------------------------
+// Open a TCP connection to a worker, giving up after CONNECT_TIMEOUT_MS so a
+// machine that is switched off costs two seconds, not the system's TCP timeout.
+//
+// @return  Connected socket, or -1 with *why set to a short reason
+// --------------------------------------------------------------------------------
+static int connect_worker(const Worker *w, const char **why) {
+    struct addrinfo hints, *res = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    if (getaddrinfo(w->host, w->port, &hints, &res) != 0) {
+        *why = "unknown host";
+        return -1;
+    }
+
+    *why = "unreachable";
+    int fd = -1;
+    for (struct addrinfo *ai = res; ai && fd < 0; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+
+        int flags = fcntl(fd, F_GETFL, 0);
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+
+        int rc = connect(fd, ai->ai_addr, ai->ai_addrlen);
+        if (rc != 0 && errno == EINPROGRESS) {
+            struct pollfd p = { fd, POLLOUT, 0 };
+            int err = 0;
+            socklen_t errlen = sizeof(err);
+            rc = (poll(&p, 1, CONNECT_TIMEOUT_MS) == 1
+                  && getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &errlen) == 0 && err == 0) ? 0 : -1;
+        }
+
+        if (rc != 0) {
+            close(fd);
+            fd = -1;
+            continue;
+        }
+        fcntl(fd, F_SETFL, flags);
+    }
+    freeaddrinfo(res);
+
+    if (fd >= 0) {
+        struct timeval tv = { REPLY_TIMEOUT_S, 0 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    }
+    return fd;
+}
+
+// --------------------------------------------------------------------------------
+// Send a preprocessed unit to a connected worker and act on its reply: the
+// compiler's output goes to stderr, a successful object is written to obj.
+//
+// @param fd    Connected socket
+// @param rc    The unit
+// @param name  File name the worker gives the preprocessed unit ("parse.i")
+// @param data  Preprocessed source
+// @param len   Its length
+// @param why   Set to a reason if the worker didn't deliver; the return value is
+//              meaningless then
+// @return      Exit code of the remote compiler
+// --------------------------------------------------------------------------------
+static int exchange(int fd, const RemoteCompile *rc, const char *name, const char *data, size_t len,
+                    const char **why) {
+    const char *flags = rc->flags ? rc->flags : "";
+    char magic[4];
+    uint32_t kind, status;
+
+    // The worker runs its own compiler of that name, never a path of this machine.
+    const char *comp = strrchr(rc->comp, '/');
+    comp = comp ? comp + 1 : rc->comp;
+    char *output = NULL, *object = NULL;
+    size_t output_len = 0, object_len = 0;
+
+    *why = "connection lost";
+    if (write_all(fd, REMOTE_MAGIC, 4) != 0
+        || wire_write_field(fd, comp, strlen(comp)) != 0
+        || wire_write_field(fd, flags, strlen(flags)) != 0
+        || wire_write_field(fd, name, strlen(name)) != 0
+        || wire_write_field(fd, data, len) != 0) {
+        return -1;
+    }
+
+    if (read_all(fd, magic, 4) != 0 || memcmp(magic, REMOTE_MAGIC, 4) != 0
+        || wire_read_u32(fd, &kind) != 0 || wire_read_u32(fd, &status) != 0
+        || wire_read_field(fd, &output, &output_len) != 0
+        || wire_read_field(fd, &object, &object_len) != 0) {
+        free(output);
+        free(object);
+        return -1;
+    }
+
+    int result = -1;
+    if (kind != REMOTE_COMPILED) {
+        // The reason comes from the worker; keep it for the note, it lives until exit.
+        *why = output;
+        output = NULL;
+    }
+    else if (status == 0 && write_file_atomic(rc->obj, object, object_len) != 0) {
+        *why = "object could not be written";
+    }
+    else {
+        fwrite(output, 1, output_len, stderr);
+        *why = NULL;
+        result = (int)status;
+    }
+
+    free(output);
+    free(object);
+    return result;
+}
+
+int remote_compile(void *arg) {
+    const RemoteCompile *rc = arg;
+    const Worker *w = rc->worker;
+
+    // A preprocessed C unit is a .i file, anything else is taken for C++ (.ii),
+    // so the worker's compiler doesn't run the preprocessor a second time.
+    const char *dot = strrchr(rc->src, '.');
+    const char *ext = (dot && strcmp(dot, ".c") == 0) ? ".i" : ".ii";
+
+    const char *base = strrchr(rc->src, '/');
+    base = base ? base + 1 : rc->src;
+    size_t stem = dot && dot > base ? (size_t)(dot - base) : strlen(base);
+    char *name = str_printf("%.*s%s", (int)stem, base, ext);
+    char *pre = str_printf("%s%s", rc->obj, ext);
+
+    // Preprocess here: this is where the headers are, and it writes the depfile
+    // that incremental builds rely on. An error at this stage is a real error in
+    // the source, reported like any other compile error.
+    char *pp_cmd = str_printf("%s %s%s-MMD -MF %s -MT %s -E %s -o %s", rc->comp,
+                              rc->flags ? rc->flags : "", rc->flags ? " " : "",
+                              rc->dep, rc->obj, rc->src, pre);
+    debug("preprocess command: %s\n", pp_cmd);
+    int ws = system(pp_cmd);
+    free(pp_cmd);
+    if (ws != 0) {
+        remove(pre);
+        free(pre);
+        free(name);
+        return (ws > 0 && WIFEXITED(ws)) ? WEXITSTATUS(ws) : 1;
+    }
+
+    size_t len = 0;
+    char *data = read_file(pre, &len);
+    remove(pre);
+    free(pre);
+
+    // A worker that drops the connection must not kill this process with SIGPIPE.
+    signal(SIGPIPE, SIG_IGN);
+
+    const char *why = "preprocessed unit unreadable";
+    int status = -1, down = 0;
+    if (data) {
+        int fd = connect_worker(w, &why);
+        down = fd < 0;
+        if (fd >= 0) {
+            status = exchange(fd, rc, name, data, len, &why);
+            close(fd);
+        }
+    }
+    free(data);
+    free(name);
+
+    if (!why) return status;
+
+    // Whatever went wrong on the way, the unit still gets built.
+    if (down) {
+        if (rc->down_pipe[1] >= 0) write_all(rc->down_pipe[1], "d", 1);
+        fprintf(stderr, "pmake: worker %s:%s is down (%s), compiling %s locally\n",
+                w->host, w->port, why, rc->src);
+    }
+    else {
+        fprintf(stderr, "pmake: worker %s:%s %s, compiling %s locally\n", w->host, w->port, why, rc->src);
+    }
+    fflush(stderr);
+    signal(SIGPIPE, SIG_DFL);
+    execl("/bin/sh", "sh", "-c", rc->local_cmd, (char *)NULL);
+    return 127;
+}
+
+#endif
@@ -0,0 +1,813 @@
+/* ****************************************************************************************************
+ * scan.c - Implementation of the #include scanner. All files seen during a scan live in one hash table
+ * keyed by their normalized path. Each entry holds the files it includes directly, already resolved to
+ * entries of the same table, so a header is read and resolved once no matter how many sources pull it
+ * in. The headers of a source are then a depth-first walk over those entries.
+ *
+ * A scan runs in two phases on all threads. First every file is parsed: new entries go onto a queue
+ * when they are added to the table, and the threads take files from the queue until it is empty and
+ * nobody is parsing anymore. The mutex guarding table and queue is never held while a file is read.
+ * Then the threads take sources from a counter and walk their entries; the table doesn't change
+ * anymore at that point, so the walks need no locking at all.
+ *
+ * The module declarations of C++ sources are picked out with the same lexing rules, one source per
+ * thread at a time; there is nothing to share between sources there.
+ *
+ * Windows builds scan on the calling thread only.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created.                                                         Version: 00.01
+ * Sun 2026-10-18 Module declaration scan for lang=c++; mutex set up before use.        Version: 00.02
+ * Sun 2026-10-18 defines_main().                                                       Version: 00.03
+ * **************************************************************************************************** */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include "scan.h"
+#include "util.h"
+#include "debug.h"
+
+#ifdef _WIN32
+    #define _lock(s)        ((void)0)
+    #define _unlock(s)      ((void)0)
+    #define _wait(s)        ((void)0)
+    #define _wake_all(s)    ((void)0)
+#else
+    #include <pthread.h>
+    #define _lock(s)        pthread_mutex_lock(&(s)->lock)
+    #define _unlock(s)      pthread_mutex_unlock(&(s)->lock)
+    #define _wait(s)        pthread_cond_wait(&(s)->more, &(s)->lock)
+    #define _wake_all(s)    pthread_cond_broadcast(&(s)->more)
+#endif
+
+// One file of the scan and the files it includes directly.
+typedef struct Header Header;
+struct Header {
+    char *path;
+    Header **includes;
+    int nincludes;
+};
+
+// The state shared by all threads of one scan.
+typedef struct {
+    Header **slots;     // Open addressing table, cap is a power of two
+    size_t cap;
+    size_t count;
+    Header **queue;     // Every entry in the order it was added; the parse phase works through it
+    size_t queued;
+    size_t parsed;      // Entries taken from the queue so far
+    int busy;           // Threads parsing a file right now
+    int failed;         // Out of memory, the result is incomplete
+    const IncludePaths *paths;
+    Header **roots;     // Entry of every source
+    int nsources;
+    int next;           // Next source to walk
+    StrList *deps;
+#ifndef _WIN32
+    pthread_mutex_t lock;
+    pthread_cond_t more;    // The queue grew, or the parse phase is over
+#endif
+} Scan;
+
+void include_paths_from_flags(const char *flags, IncludePaths *out) {
+    StrList words = {0};
+    memset(out, 0, sizeof(*out));
+    split_words(flags, &words);
+
+    for (int i = 0; i < words.count; i++) {
+        const char *w = words.items[i];
+        const char *next = i + 1 < words.count ? words.items[i + 1] : NULL;
+
+        if (strcmp(w, "-I") == 0 && next)           { strlist_push(&out->angle, strdup(next)); i++; }
+        else if (strncmp(w, "-I", 2) == 0 && w[2])  strlist_push(&out->angle, strdup(w + 2));
+        else if (strcmp(w, "-iquote") == 0 && next) { strlist_push(&out->quote, strdup(next)); i++; }
+    }
+
+    strlist_free(&words);
+}
+
+void free_include_paths(IncludePaths *paths) {
+    strlist_free(&paths->quote);
+    strlist_free(&paths->angle);
+}
+
+// --------------------------------------------------------------------------------
+// Normalize a path so every file has exactly one name in the table: "." parts and
+// doubled slashes go, and "dir/.." cancels out. "./src/../include/a.h" becomes
+// "include/a.h". Symbolic links are not looked at.
+// --------------------------------------------------------------------------------
+static char *normalize_path(const char *path) {
+    size_t len = strlen(path);
+    char *out = malloc(len + 2);
+    if (!out) return NULL;
+
+    size_t n = 0;
+    size_t floor = 0;   // Part of out that ".." may not remove
+    if (path[0] == '/') {
+        out[n++] = '/';
+        floor = 1;
+    }
+
+    const char *p = path;
+    while (*p) {
+        while (*p == '/') p++;
+        const char *start = p;
+        while (*p && *p != '/') p++;
+        size_t part = (size_t)(p - start);
+
+        if (part == 0 || (part == 1 && start[0] == '.')) continue;
+
+        if (part == 2 && start[0] == '.' && start[1] == '.') {
+            // Drop the previous component unless it is ".." itself or there is none.
+            size_t last = n;
+            while (last > floor && out[last - 1] != '/') last--;
+            if (n > floor && !(n - last == 2 && out[last] == '.' && out[last + 1] == '.')) {
+                n = last > floor ? last - 1 : floor;
+                continue;
+            }
+            if (n == floor && floor == 1) continue;     // "/.." is "/"
+        }
+
+        if (n > floor) out[n++] = '/';
+        memcpy(out + n, start, part);
+        n += part;
+    }
+
+    if (n == 0) out[n++] = '.';
+    out[n] = '\0';
+    return out;
+}
+
+static int is_file(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISREG(st.st_mode);
+}
+
+// --------------------------------------------------------------------------------
+// Find the entry of a normalized path. A new path gets a new entry, which is
+// queued for parsing. Takes ownership of path. Called with the lock held.
+// --------------------------------------------------------------------------------
+static Header *intern(Scan *s, char *path) {
+    if ((s->count + 1) * 2 > s->cap) {
+        size_t cap = s->cap ? s->cap * 2 : 1024;
+        Header **slots = calloc(cap, sizeof(Header *));
+        Header **queue = slots ? realloc(s->queue, sizeof(Header *) * cap / 2) : NULL;
+        if (!queue) {
+            free(slots);
+            free(path);
+            s->failed = 1;
+            return NULL;
+        }
+        s->queue = queue;
+        for (size_t i = 0; i < s->cap; i++) {
+            Header *h = s->slots[i];
+            if (!h) continue;
+            size_t k = (size_t)hash_bytes(h->path, strlen(h->path), HASH_SEED) & (cap - 1);
+            while (slots[k]) k = (k + 1) & (cap - 1);
+            slots[k] = h;
+        }
+        free(s->slots);
+        s->slots = slots;
+        s->cap = cap;
+    }
+
+    size_t k = (size_t)hash_bytes(path, strlen(path), HASH_SEED) & (s->cap - 1);
+    while (s->slots[k]) {
+        if (strcmp(s->slots[k]->path, path) == 0) {
+            free(path);
+            return s->slots[k];
+        }
+        k = (k + 1) & (s->cap - 1);
+    }
+
+    Header *h = calloc(1, sizeof(Header));
+    if (!h) {
+        free(path);
+        s->failed = 1;
+        return NULL;
+    }
+    h->path = path;
+    s->slots[k] = h;
+    s->count++;
+    s->queue[s->queued++] = h;
+    return h;
+}
+
+static Header *lookup(Scan *s, const char *path) {
+    char *norm = normalize_path(path);
+    if (!norm) return NULL;
+    _lock(s);
+    Header *h = intern(s, norm);
+    _unlock(s);
+    return h;
+}
+
+// --------------------------------------------------------------------------------
+// Resolve an include the way the preprocessor does: a quoted name next to the
+// including file first, then in the -iquote and -I directories; an angled name
+// only in the -I directories.
+//
+// @return  Allocated path of the file found, or NULL
+// --------------------------------------------------------------------------------
+static char *resolve_include(const Scan *s, const char *from, const char *name, int angled) {
+    if (name[0] == '/') return is_file(name) ? strdup(name) : NULL;
+
+    if (!angled) {
+        const char *slash = strrchr(from, '/');
+        char *candidate = slash ? str_printf("%.*s/%s", (int)(slash - from), from, name) : strdup(name);
+        if (candidate && is_file(candidate)) return candidate;
+        free(candidate);
+
+        for (int i = 0; i < s->paths->quote.count; i++) {
+            candidate = str_printf("%s/%s", s->paths->quote.items[i], name);
+            if (candidate && is_file(candidate)) return candidate;
+            free(candidate);
+        }
+    }
+
+    for (int i = 0; i < s->paths->angle.count; i++) {
+        char *candidate = str_printf("%s/%s", s->paths->angle.items[i], name);
+        if (candidate && is_file(candidate)) return candidate;
+        free(candidate);
+    }
+    return NULL;
+}
+
+// --------------------------------------------------------------------------------
+// Skip a string or character literal starting at the opening quote. Escapes are
+// honoured; a literal never runs past the end of the line.
+// --------------------------------------------------------------------------------
+static const char *skip_literal(const char *p) {
+    char quote = *p++;
+    while (*p && *p != quote && *p != '\n') {
+        if (*p == '\\' && p[1]) p++;
+        p++;
+    }
+    return *p == quote ? p + 1 : p;
+}
+
+// --------------------------------------------------------------------------------
+// Skip a C++ raw string literal R"delim( ... )delim" starting at the R.
+// --------------------------------------------------------------------------------
+static const char *skip_raw_literal(const char *p) {
+    const char *open = strchr(p + 2, '(');
+    if (!open || open - (p + 2) > 16) return p + 2;
+
+    char close[20];
+    int dlen = (int)(open - (p + 2));
+    snprintf(close, sizeof(close), ")%.*s\"", dlen, p + 2);
+
+    const char *end = strstr(open, close);
+    return end ? end + strlen(close) : open + strlen(open);
+}
+
+// --------------------------------------------------------------------------------
+// Pick the #include lines out of a file's text. Comments and literals are
+// skipped, so a commented-out include or one inside a string doesn't count.
+// Includes behind #if are found all the same — the scan is approximate by design.
+//
+// @param text   File content, null-terminated
+// @param names  Receives the included names
+// @param kinds  Receives '<' or '"' for every name, in the same order
+// --------------------------------------------------------------------------------
+static void parse_includes(const char *text, StrList *names, StrBuf *kinds) {
+    const char *p = text;
+    int line_start = 1;
+
+    while (*p) {
+        char c = *p;
+
+        if (c == '\n') {
+            line_start = 1;
+            p++;
+        }
+        else if (c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v') {
+            p++;
+        }
+        else if (c == '/' && p[1] == '/') {
+            while (*p && *p != '\n') p++;
+        }
+        else if (c == '/' && p[1] == '*') {
+            const char *end = strstr(p + 2, "*/");
+            p = end ? end + 2 : p + strlen(p);
+        }
+        else if (c == '#' && line_start) {
+            p++;
+            while (*p == ' ' || *p == '\t') p++;
+
+            if (strncmp(p, "include", 7) == 0) {
+                p += 7;
+                if (strncmp(p, "_next", 5) == 0) p += 5;
+                while (*p == ' ' || *p == '\t') p++;
+
+                char close = *p == '<' ? '>' : *p == '"' ? '"' : 0;
+                if (close) {
+                    const char *start = ++p;
+                    while (*p && *p != close && *p != '\n') p++;
+                    if (*p == close && p > start) {
+                        char *name = malloc((size_t)(p - start) + 1);
+                        if (name) {
+                            memcpy(name, start, (size_t)(p - start));
+                            name[p - start] = '\0';
+                            strlist_push(names, name);
+                            sb_append(kinds, close == '>' ? "<" : "\"", 1);
+                        }
+                    }
+                }
+            }
+
+            // The rest of the directive doesn't matter.
+            while (*p && *p != '\n') p++;
+        }
+        else if (c == '"' || c == '\'') {
+            line_start = 0;
+            p = skip_literal(p);
+        }
+        else if (c == 'R' && p[1] == '"' && (p == text || !(isalnum((unsigned char)p[-1]) || p[-1] == '_')
+                                             || p[-1] == 'u' || p[-1] == 'U' || p[-1] == 'L' || p[-1] == '8')) {
+            line_start = 0;
+            p = skip_raw_literal(p);
+        }
+        else {
+            line_start = 0;
+            p++;
+        }
+    }
+}
+
+// --------------------------------------------------------------------------------
+// Read a file and resolve its direct includes. Only the thread that took the
+// entry from the queue writes to it.
+// --------------------------------------------------------------------------------
+static void parse_header(Scan *s, Header *h) {
+    StrList names = {0};
+    StrBuf kinds = {0};
+    char *text = read_file(h->path, NULL);
+    if (text) parse_includes(text, &names, &kinds);
+    free(text);
+
+    h->includes = names.count ? malloc(sizeof(Header *) * (size_t)names.count) : NULL;
+    for (int i = 0; h->includes && i < names.count; i++) {
+        char *found = resolve_include(s, h->path, names.items[i], kinds.data[i] == '<');
+        if (!found) continue;
+        Header *inc = lookup(s, found);
+        free(found);
+        if (inc && inc != h) h->includes[h->nincludes++] = inc;
+    }
+    strlist_free(&names);
+    sb_free(&kinds);
+}
+
+// A set of entries already visited while walking the headers of one source.
+typedef struct {
+    const Header **slots;
+    size_t cap;
+    size_t count;
+} Visited;
+
+// --------------------------------------------------------------------------------
+// Add an entry to the visited set. Returns 1 if it was new, 0 if it was there.
+// --------------------------------------------------------------------------------
+static int visit(Visited *v, const Header *h) {
+    if ((v->count + 1) * 2 > v->cap) {
+        size_t cap = v->cap ? v->cap * 2 : 64;
+        const Header **slots = calloc(cap, sizeof(Header *));
+        if (!slots) return 0;
+        for (size_t i = 0; i < v->cap; i++) {
+            if (!v->slots[i]) continue;
+            size_t k = ((uintptr_t)v->slots[i] >> 4) * 2654435761u & (cap - 1);
+            while (slots[k]) k = (k + 1) & (cap - 1);
+            slots[k] = v->slots[i];
+        }
+        free(v->slots);
+        v->slots = slots;
+        v->cap = cap;
+    }
+
+    size_t k = ((uintptr_t)h >> 4) * 2654435761u & (v->cap - 1);
+    while (v->slots[k]) {
+        if (v->slots[k] == h) return 0;
+        k = (k + 1) & (v->cap - 1);
+    }
+    v->slots[k] = h;
+    v->count++;
+    return 1;
+}
+
+// --------------------------------------------------------------------------------
+// Append a header's direct includes to the walk stack, last one first so the walk
+// visits them in include order.
+// --------------------------------------------------------------------------------
+static int push_includes(Header ***stack, int *depth, int *cap, const Header *h) {
+    if (*depth + h->nincludes > *cap) {
+        int grown_cap = (*cap ? *cap * 2 : 64) + h->nincludes;
+        Header **grown = realloc(*stack, sizeof(Header *) * (size_t)grown_cap);
+        if (!grown) return -1;
+        *stack = grown;
+        *cap = grown_cap;
+    }
+    for (int i = h->nincludes - 1; i >= 0; i--) (*stack)[(*depth)++] = h->includes[i];
+    return 0;
+}
+
+// --------------------------------------------------------------------------------
+// Collect all headers of one source with a depth-first walk over the parsed
+// entries.
+// --------------------------------------------------------------------------------
+static void walk_source(Scan *s, int index) {
+    const Header *root = s->roots[index];
+    if (!root) return;
+
+    Visited seen = {0};
+    Header **stack = NULL;
+    int depth = 0, cap = 0;
+
+    visit(&seen, root);
+    push_includes(&stack, &depth, &cap, root);
+    while (depth > 0) {
+        const Header *h = stack[--depth];
+        if (!visit(&seen, h)) continue;
+        strlist_push(&s->deps[index], strdup(h->path));
+        if (push_includes(&stack, &depth, &cap, h) != 0) break;
+    }
+
+    free(stack);
+    free(seen.slots);
+}
+
+// --------------------------------------------------------------------------------
+// Body of every scan thread. First parse files from the queue; a thread that finds
+// it empty waits as long as others are still parsing, since they may queue more.
+// Then walk sources until none are left.
+// --------------------------------------------------------------------------------
+static void *scan_worker(void *arg) {
+    Scan *s = arg;
+
+    _lock(s);
+    for (;;) {
+        if (s->parsed < s->queued) {
+            Header *h = s->queue[s->parsed++];
+            s->busy++;
+            _unlock(s);
+            parse_header(s, h);
+            _lock(s);
+            s->busy--;
+            _wake_all(s);
+        }
+        else if (s->busy == 0) break;
+        else _wait(s);
+    }
+    _unlock(s);
+
+    for (;;) {
+        _lock(s);
+        int i = s->next++;
+        _unlock(s);
+        if (i >= s->nsources) break;
+        walk_source(s, i);
+    }
+    return NULL;
+}
+
+// --------------------------------------------------------------------------------
+// Run fn(arg) on the given number of threads, the calling thread being one of
+// them, and return when all are done. Windows runs it on the calling thread only.
+// --------------------------------------------------------------------------------
+static void run_threads(int threads, void *(*fn)(void *), void *arg) {
+#ifdef _WIN32
+    (void)threads;
+    fn(arg);
+#else
+    pthread_t *ids = threads > 1 ? calloc((size_t)threads - 1, sizeof(pthread_t)) : NULL;
+    int started = 0;
+    for (int i = 0; ids && i < threads - 1; i++) {
+        if (pthread_create(&ids[i], NULL, fn, arg) != 0) break;
+        started++;
+    }
+
+    fn(arg);
+    for (int i = 0; i < started; i++) pthread_join(ids[i], NULL);
+    free(ids);
+#endif
+}
+
+int scan_includes(char *const *sources, int count, const IncludePaths *paths, int threads,
+                  StrList *deps) {
+    Scan s;
+    memset(&s, 0, sizeof(s));
+    s.paths = paths;
+    s.nsources = count;
+    s.deps = deps;
+    s.roots = calloc((size_t)count + 1, sizeof(Header *));
+    if (!s.roots) return 0;
+
+#ifndef _WIN32
+    pthread_mutex_init(&s.lock, NULL);
+    pthread_cond_init(&s.more, NULL);
+#endif
+
+    // The sources are the first entries on the queue.
+    for (int i = 0; i < count; i++) s.roots[i] = lookup(&s, sources[i]);
+    run_threads(threads < count ? threads : count, scan_worker, &s);
+#ifndef _WIN32
+    pthread_cond_destroy(&s.more);
+    pthread_mutex_destroy(&s.lock);
+#endif
+
+    if (s.failed) fprintf(stderr, "Warning: Out of memory, the include scan is incomplete.\n");
+
+    for (size_t i = 0; i < s.queued; i++) {
+        free(s.queue[i]->path);
+        free(s.queue[i]->includes);
+        free(s.queue[i]);
+    }
+    free(s.queue);
+    free(s.slots);
+    free(s.roots);
+
+    debug("include scan: %d sources, %d files read\n", count, (int)s.queued);
+    return (int)s.queued;
+}
+
+// The state shared by all threads of a module declaration scan.
+typedef struct {
+    char *const *sources;
+    int count;
+    int next;           // Next source to scan
+    char **provides;
+    StrList *requires;
+#ifndef _WIN32
+    pthread_mutex_t lock;
+#endif
+} ModuleScan;
+
+// --------------------------------------------------------------------------------
+// Read a module name after "module" or "import": identifiers joined by dots, with
+// an optional ":partition". Leading blanks are skipped.
+//
+// @return  Allocated name, or NULL if there is none (header units, "module;")
+// --------------------------------------------------------------------------------
+static char *module_name(const char *p) {
+    while (*p == ' ' || *p == '\t') p++;
+    const char *start = p;
+    while (isalnum((unsigned char)*p) || *p == '_' || *p == '.' || *p == ':') p++;
+    while (p > start && isspace((unsigned char)p[-1])) p--;
+    if (p == start) return NULL;
+
+    char *name = malloc((size_t)(p - start) + 1);
+    if (!name) return NULL;
+    memcpy(name, start, (size_t)(p - start));
+    name[p - start] = '\0';
+    return name;
+}
+
+// --------------------------------------------------------------------------------
+// Tell whether a keyword starts at p and ends there as a word.
+// --------------------------------------------------------------------------------
+static int keyword(const char *p, const char *word) {
+    size_t len = strlen(word);
+    return strncmp(p, word, len) == 0 && !(isalnum((unsigned char)p[len]) || p[len] == '_');
+}
+
+// --------------------------------------------------------------------------------
+// Pick the module declarations out of a C++ source: "export module m;" provides
+// m, "module m;" (an implementation unit) and "import m;" require it. Partitions
+// are named in full, "m:part", and "import :part;" is completed with the name of
+// the module being declared. Header units and the global module fragment are
+// skipped. Like parse_includes(), comments and literals don't count.
+// --------------------------------------------------------------------------------
+static void parse_module_decls(const char *text, char **provides, StrList *requires) {
+    const char *p = text;
+    char *current = NULL;   // Module this file belongs to, for partition imports
+    int line_start = 1;
+
+    while (*p) {
+        char c = *p;
+
+        if (c == '\n') {
+            line_start = 1;
+            p++;
+        }
+        else if (c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v') {
+            p++;
+        }
+        else if (c == '/' && p[1] == '/') {
+            while (*p && *p != '\n') p++;
+        }
+        else if (c == '/' && p[1] == '*') {
+            const char *end = strstr(p + 2, "*/");
+            p = end ? end + 2 : p + strlen(p);
+        }
+        else if (line_start && (keyword(p, "export") || keyword(p, "module") || keyword(p, "import"))) {
+            int exported = keyword(p, "export");
+            if (exported) {
+                p += 6;
+                while (*p == ' ' || *p == '\t') p++;
+            }
+
+            int is_module = keyword(p, "module");
+            if (is_module || keyword(p, "import")) {
+                char *name = module_name(p + 6);
+                if (name && name[0] == ':' && current) {
+                    char *full = str_printf("%s%s", current, name);
+                    free(name);
+                    name = full;
+                }
+
+                if (!name || name[0] == ':') {
+                    free(name);     // "module;", "module :private;" or a stray partition
+                }
+                else if (is_module) {
+                    char *colon = strchr(name, ':');
+                    free(current);
+                    current = str_printf("%.*s", colon ? (int)(colon - name) : (int)strlen(name), name);
+
+                    // An implementation unit imports its own interface implicitly.
+                    if (exported || colon) {
+                        free(*provides);
+                        *provides = name;
+                    }
+                    else strlist_push(requires, name);
+                }
+                else strlist_push(requires, name);
+            }
+
+            line_start = 0;
+            while (*p && *p != ';' && *p != '\n') p++;
+        }
+        else if (c == '"' || c == '\'') {
+            line_start = 0;
+            p = skip_literal(p);
+        }
+        else if (c == 'R' && p[1] == '"' && (p == text || !(isalnum((unsigned char)p[-1]) || p[-1] == '_')
+                                             || p[-1] == 'u' || p[-1] == 'U' || p[-1] == 'L' || p[-1] == '8')) {
+            line_start = 0;
+            p = skip_raw_literal(p);
+        }
+        else {
+            // A declaration may follow the semicolon of the previous one.
+            line_start = c == ';' || c == '}' || c == '{';
+            p++;
+        }
+    }
+
+    free(current);
+}
+
+// --------------------------------------------------------------------------------
+// Body of every module scan thread: take the next source until none are left.
+// --------------------------------------------------------------------------------
+static void *module_worker(void *arg) {
+    ModuleScan *s = arg;
+    for (;;) {
+        _lock(s);
+        int i = s->next++;
+        _unlock(s);
+        if (i >= s->count) break;
+
+        char *text = read_file(s->sources[i], NULL);
+        if (text) parse_module_decls(text, &s->provides[i], &s->requires[i]);
+        free(text);
+    }
+    return NULL;
+}
+
+void scan_module_decls(char *const *sources, int count, int threads, char **provides,
+                       StrList *requires) {
+    ModuleScan s;
+    memset(&s, 0, sizeof(s));
+    s.sources = sources;
+    s.count = count;
+    s.provides = provides;
+    s.requires = requires;
+
+#ifndef _WIN32
+    pthread_mutex_init(&s.lock, NULL);
+#endif
+    run_threads(threads < count ? threads : count, module_worker, &s);
+#ifndef _WIN32
+    pthread_mutex_destroy(&s.lock);
+#endif
+}
+
+// --------------------------------------------------------------------------------
+// Look for a definition of main() outside of all braces: the word main, its
+// parameter list, and an opening brace right after it. A declaration ends with a
+// semicolon instead and doesn't count. Comments, literals and preprocessor lines
+// are skipped the same way as in parse_includes().
+// --------------------------------------------------------------------------------
+static int parse_main(const char *text) {
+    const char *p = text;
+    int depth = 0, line_start = 1;
+
+    while (*p) {
+        char c = *p;
+
+        if (c == '\n') {
+            line_start = 1;
+            p++;
+        }
+        else if (c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v') {
+            p++;
+        }
+        else if (c == '/' && p[1] == '/') {
+            while (*p && *p != '\n') p++;
+        }
+        else if (c == '/' && p[1] == '*') {
+            const char *end = strstr(p + 2, "*/");
+            p = end ? end + 2 : p + strlen(p);
+        }
+        else if (c == '#' && line_start) {
+            // Directives may continue on the next line.
+            while (*p && *p != '\n') p += (*p == '\\' && p[1]) ? 2 : 1;
+        }
+        else if (c == '"' || c == '\'') {
+            line_start = 0;
+            p = skip_literal(p);
+        }
+        else if (c == 'R' && p[1] == '"' && (p == text || !(isalnum((unsigned char)p[-1]) || p[-1] == '_')
+                                             || p[-1] == 'u' || p[-1] == 'U' || p[-1] == 'L' || p[-1] == '8')) {
+            line_start = 0;
+            p = skip_raw_literal(p);
+        }
+        else if (isalpha((unsigned char)c) || c == '_') {
+            const char *word = p;
+            while (isalnum((unsigned char)*p) || *p == '_') p++;
+            line_start = 0;
+            if (depth > 0 || p - word != 4 || strncmp(word, "main", 4) != 0) continue;
+
+            const char *q = p;
+            while (isspace((unsigned char)*q)) q++;
+            if (*q != '(') continue;
+            for (int parens = 0; *q; q++) {
+                if (*q == '(') parens++;
+                else if (*q == ')' && --parens == 0) break;
+            }
+            if (*q) q++;
+            while (isspace((unsigned char)*q)) q++;
+            if (*q == '{') return 1;
+        }
+        else {
+            if (c == '{') depth++;
+            else if (c == '}' && depth > 0) depth--;
+            line_start = 0;
+            p++;
+        }
+    }
+    return 0;
+}
+
+int defines_main(const char *src) {
+    char *text = read_file(src, NULL);
+    int found = text ? parse_main(text) : 0;
+    free(text);
+    return found;
+}
+
+BuildResult print_scanned_deps(const Makefile *mf, int threads, char **errmsg) {
+    BuildPlan plan;
+    if (plan_build(mf, &plan, errmsg) != 0) {
+        free_plan(&plan);
+        return BUILD_CONFIG_ERROR;
+    }
+
+    char **srcs = malloc(sizeof(char *) * (size_t)(plan.count + 1));
+    StrList *deps = calloc((size_t)plan.count + 1, sizeof(StrList));
+    if (!srcs || !deps) {
+        *errmsg = strdup("Memory allocation failed for the include scan.");
+        free(srcs);
+        free(deps);
+        free_plan(&plan);
+        return BUILD_CONFIG_ERROR;
+    }
+    for (int i = 0; i < plan.count; i++) srcs[i] = plan.units[i].src;
+
+    IncludePaths paths;
+    include_paths_from_flags(plan.flags, &paths);
+    double start = now_seconds();
+    int files = scan_includes(srcs, plan.count, &paths, threads, deps);
+    double took = now_seconds() - start;
+    free_include_paths(&paths);
+
+    for (int i = 0; i < plan.count; i++) {
+        printf("%s:", srcs[i]);
+        for (int k = 0; k < deps[i].count; k++) printf(" %s", deps[i].items[k]);
+        printf("\n");
+        strlist_free(&deps[i]);
+    }
+    fprintf(stderr, "Scanned %d source(s), %d file(s) read in %.3fs.\n", plan.count, files, took);
+
+    free(deps);
+    free(srcs);
+    free_plan(&plan);
+    return BUILD_OK;
+}
@@ -0,0 +1,131 @@
+/* ****************************************************************************************************
+ * stats.c - Implementation of the build statistics. The JSON lines are written by hand — the records
+ * are flat and few, and pulling in a JSON library for them would be the kind of ceremony this tool
+ * exists to avoid.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created.                                                         Version: 00.01
+ * Sun 2026-10-18 Report links skipped by the early cutoff.                             Version: 00.02
+ * **************************************************************************************************** */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "stats.h"
+#include "util.h"
+
+void stats_add_jobs(BuildStats *stats, const Job *jobs, int count) {
+    StepStat *steps = realloc(stats->steps, sizeof(StepStat) * (size_t)(stats->nsteps + count));
+    if (!steps) return;
+    stats->steps = steps;
+
+    for (int i = 0; i < count; i++) {
+        const Job *job = &jobs[i];
+        if (job->status == JOB_NOT_RUN || job->status == JOB_SKIPPED) continue;
+
+        StepStat *st = &stats->steps[stats->nsteps++];
+        st->label = strdup(job->label);
+        st->status = job->status;
+        st->wall = job->wall;
+        st->cpu = job->cpu;
+        st->max_rss_kb = job->max_rss_kb;
+        stats->cpu += job->cpu;
+    }
+}
+
+// Sort steps by wall time, slowest first.
+static int compare_slowest(const void *a, const void *b) {
+    double wa = ((const StepStat *)a)->wall, wb = ((const StepStat *)b)->wall;
+    return (wa < wb) - (wa > wb);
+}
+
+void print_stats(const BuildStats *stats, int detailed) {
+    printf("Build finished in %.2fs: %d compiled, %d up to date", stats->wall, stats->compiled,
+           stats->up_to_date);
+    if (stats->failed)    printf(", %d failed", stats->failed);
+    if (stats->not_built) printf(", %d not built", stats->not_built);
+    printf(", %s.\n", stats->linked ? "linked" : stats->link_cutoff ? "objects unchanged, not relinked"
+                                                                    : "not linked");
+
+    if (!detailed) return;
+
+    long peak_rss = 0;
+    const char *peak_label = NULL;
+    for (int i = 0; i < stats->nsteps; i++) {
+        if (stats->steps[i].max_rss_kb > peak_rss) {
+            peak_rss = stats->steps[i].max_rss_kb;
+            peak_label = stats->steps[i].label;
+        }
+    }
+
+    printf("  Wall time:      %.3fs\n", stats->wall);
+    printf("  CPU time:       %.3fs (%.1fx parallel speedup)\n", stats->cpu,
+           stats->wall > 0 ? stats->cpu / stats->wall : 0.0);
+    printf("  Concurrency:    %d of %d job slot(s) used at peak\n", stats->peak_parallel,
+           stats->max_parallel);
+    printf("  Units:          %d total, %d compiled, %d up to date, %d failed, %d not built\n",
+           stats->units, stats->compiled, stats->up_to_date, stats->failed, stats->not_built);
+    if (peak_label) printf("  Peak RSS:       %.1f MiB (%s)\n", peak_rss / 1024.0, peak_label);
+
+    if (stats->nsteps == 0) return;
+
+    // Sort a copy, so the steps keep their completion order for the JSON output.
+    StepStat *sorted = malloc(sizeof(StepStat) * (size_t)stats->nsteps);
+    if (!sorted) return;
+    memcpy(sorted, stats->steps, sizeof(StepStat) * (size_t)stats->nsteps);
+    qsort(sorted, (size_t)stats->nsteps, sizeof(StepStat), compare_slowest);
+
+    int n = stats->nsteps < STATS_SLOWEST ? stats->nsteps : STATS_SLOWEST;
+    printf("  Slowest steps:\n");
+    for (int i = 0; i < n; i++) {
+        printf("    %8.3fs %8.1f MiB  %s\n", sorted[i].wall, sorted[i].max_rss_kb / 1024.0,
+               sorted[i].label);
+    }
+    free(sorted);
+}
+
+int write_stats_json(const BuildStats *stats, const char *path) {
+    StrBuf sb = {0};
+    long long stamp = (long long)time(NULL);
+
+    sb_printf(&sb, "{\"type\":\"build\",\"time\":%lld,\"project\":", stamp);
+    sb_json_string(&sb, stats->project ? stats->project : "");
+    sb_printf(&sb, ",\"result\":%d,\"wall\":%.6f,\"cpu\":%.6f,\"jobs\":%d,\"peak_parallel\":%d"
+                   ",\"units\":%d,\"compiled\":%d,\"up_to_date\":%d,\"failed\":%d,\"not_built\":%d"
+                   ",\"linked\":%s,\"link_cutoff\":%s}\n",
+              stats->result, stats->wall, stats->cpu, stats->max_parallel, stats->peak_parallel,
+              stats->units, stats->compiled, stats->up_to_date, stats->failed, stats->not_built,
+              stats->linked ? "true" : "false", stats->link_cutoff ? "true" : "false");
+
+    for (int i = 0; i < stats->nsteps; i++) {
+        const StepStat *st = &stats->steps[i];
+        sb_printf(&sb, "{\"type\":\"step\",\"time\":%lld,\"label\":", stamp);
+        sb_json_string(&sb, st->label);
+        sb_printf(&sb, ",\"status\":%d,\"wall\":%.6f,\"cpu\":%.6f,\"max_rss_kb\":%ld}\n",
+                  st->status, st->wall, st->cpu, st->max_rss_kb);
+    }
+
+    FILE *fp = fopen(path, "a");
+    if (!fp) {
+        sb_free(&sb);
+        return -1;
+    }
+    int ok = fwrite(sb.data, 1, sb.len, fp) == sb.len;
+    ok &= fclose(fp) == 0;
+
+    sb_free(&sb);
+    return ok ? 0 : -1;
+}
+
+void free_stats(BuildStats *stats) {
+    for (int i = 0; i < stats->nsteps; i++) free(stats->steps[i].label);
+    free(stats->steps);
+    free(stats->project);
+    memset(stats, 0, sizeof(*stats));
+}
@@ -0,0 +1,274 @@
+/* ****************************************************************************************************
+ * tests.c - Implementation of pmake test. The tests run as plain jobs of the pool, with the pool's
+ * keep-going mode so one failure doesn't stop the others, and with a report of their own: a test
+ * that passes is one line, only a failing test shows what it printed.
+ *
+ * The timing history is a text file of "seconds test" lines next to the command log. It only decides
+ * the order within a run; the shards are cut by name, so every machine of a CI run picks the same
+ * tests no matter which history it has.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created.                                                         Version: 00.01
+ * **************************************************************************************************** */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tests.h"
+#include "jobs.h"
+#include "util.h"
+
+// The timing history in the object directory.
+#define TEST_HISTORY ".pmake_test_times"
+
+// How long every test took the last time it ran.
+typedef struct {
+    StrList tests;      // Test executables
+    double *seconds;    // Wall time of each, in the same order
+} History;
+
+// A test of the shard and how long it took last time, -1 if it never ran.
+typedef struct {
+    const char *test;
+    double seconds;
+} Scheduled;
+
+void default_test_options(TestOptions *tests) {
+    tests->shard = 1;
+    tests->shards = 1;
+    tests->timeout = TEST_TIMEOUT;
+}
+
+// --------------------------------------------------------------------------------
+// Set the time of a test in the history, adding the test if it isn't there yet.
+// --------------------------------------------------------------------------------
+static void set_history(History *h, const char *test, double seconds) {
+    for (int i = 0; i < h->tests.count; i++) {
+        if (strcmp(h->tests.items[i], test) == 0) {
+            h->seconds[i] = seconds;
+            return;
+        }
+    }
+
+    double *grown = realloc(h->seconds, sizeof(double) * (size_t)(h->tests.count + 1));
+    if (!grown) return;
+    h->seconds = grown;
+    h->seconds[h->tests.count] = seconds;
+    strlist_push(&h->tests, strdup(test));
+}
+
+// --------------------------------------------------------------------------------
+// Return the time of a test from the history, or -1 if it has none.
+// --------------------------------------------------------------------------------
+static double history_of(const History *h, const char *test) {
+    for (int i = 0; i < h->tests.count; i++) {
+        if (strcmp(h->tests.items[i], test) == 0) return h->seconds[i];
+    }
+    return -1;
+}
+
+// --------------------------------------------------------------------------------
+// Read the history file. A missing or unreadable file is an empty history.
+// --------------------------------------------------------------------------------
+static void load_history(History *h, const char *file) {
+    memset(h, 0, sizeof(*h));
+    char *data = read_file(file, NULL);
+    if (!data) return;
+
+    char *line = data;
+    while (*line) {
+        char *end = strchr(line, '\n');
+        if (end) *end = '\0';
+
+        char *space = strchr(line, ' ');
+        if (space && space[1]) set_history(h, space + 1, strtod(line, NULL));
+
+        if (!end) break;
+        line = end + 1;
+    }
+    free(data);
+}
+
+// --------------------------------------------------------------------------------
+// Write the history back, only with the tests that are still configured, so
+// renamed and removed tests drop out of it.
+// --------------------------------------------------------------------------------
+static int save_history(const History *h, const StrList *configured, const char *file) {
+    StrBuf sb = {0};
+    sb_append(&sb, "", 0);
+    for (int i = 0; i < configured->count; i++) {
+        double seconds = history_of(h, configured->items[i]);
+        if (seconds >= 0) sb_printf(&sb, "%.3f %s\n", seconds, configured->items[i]);
+    }
+
+    int rc = write_file_atomic(file, sb.data, sb.len);
+    sb_free(&sb);
+    return rc;
+}
+
+static void free_history(History *h) {
+    strlist_free(&h->tests);
+    free(h->seconds);
+    memset(h, 0, sizeof(*h));
+}
+
+static int by_name(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// --------------------------------------------------------------------------------
+// Order tests slowest first. A test that never ran counts as the slowest: nothing
+// is known about it, and starting it early is the safe bet.
+// --------------------------------------------------------------------------------
+static int slowest_first(const void *a, const void *b) {
+    const Scheduled *x = a, *y = b;
+    if ((x->seconds < 0) != (y->seconds < 0)) return x->seconds < 0 ? -1 : 1;
+    if (x->seconds != y->seconds) return x->seconds > y->seconds ? -1 : 1;
+    return strcmp(x->test, y->test);
+}
+
+// --------------------------------------------------------------------------------
+// Print one finished test: PASS, FAIL with its exit code, or TIMEOUT. What a
+// failing test printed follows on stderr, the output of a passing one is dropped.
+// --------------------------------------------------------------------------------
+static void report_test(const Job *job, int done, int count, void *ctx) {
+    (void)ctx;
+    if (job->status == 0) {
+        printf("[%d/%d] PASS    %s (%.2fs)\n", done, count, job->label, job->wall);
+    }
+    else if (job->status == JOB_TIMED_OUT) {
+        printf("[%d/%d] TIMEOUT %s (killed after %gs)\n", done, count, job->label, job->timeout);
+    }
+    else {
+        printf("[%d/%d] FAIL    %s (exit %d, %.2fs)\n", done, count, job->label, job->status, job->wall);
+    }
+    fflush(stdout);
+
+    if (job->status != 0 && job->output_len > 0) {
+        fwrite(job->output, 1, job->output_len, stderr);
+        if (job->output[job->output_len - 1] != '\n') fputc('\n', stderr);
+    }
+    fflush(stderr);
+}
+
+BuildResult run_tests(const Makefile *mf, const BuildOptions *opts, const TestOptions *tests,
+                      TestSummary *summary, char **errmsg) {
+    BuildResult result = BUILD_OK;
+    TestSummary sum;
+    StrList all = {0};
+    History history;
+    Scheduled *order = NULL;
+    Job *jobs = NULL;
+    char *history_file = NULL;
+    int count = 0;
+
+    memset(&sum, 0, sizeof(sum));
+    memset(&history, 0, sizeof(history));
+
+    if (tests->shards < 1 || tests->shard < 1 || tests->shard > tests->shards) {
+        *errmsg = str_printf("There is no shard %d/%d.", tests->shard, tests->shards);
+        result = BUILD_CONFIG_ERROR;
+        goto done;
+    }
+
+    BuildOptions build = *opts;
+    build.tests = 1;
+    result = run(mf, &build, errmsg);
+    if (result != BUILD_OK) goto done;
+
+    if (list_tests(mf, &all, errmsg) != 0) {
+        result = BUILD_CONFIG_ERROR;
+        goto done;
+    }
+    qsort(all.items, (size_t)all.count, sizeof(char *), by_name);
+    sum.total = all.count;
+
+    char *dir = object_dir(mf);
+    history_file = str_printf("%s/" TEST_HISTORY, dir);
+    free(dir);
+    load_history(&history, history_file);
+
+    order = calloc((size_t)all.count + 1, sizeof(Scheduled));
+    jobs = calloc((size_t)all.count + 1, sizeof(Job));
+    if (!order || !jobs) {
+        *errmsg = strdup("Memory allocation failed for the tests.");
+        result = BUILD_CONFIG_ERROR;
+        goto done;
+    }
+
+    for (int i = 0; i < all.count; i++) {
+        if (i % tests->shards != tests->shard - 1) continue;
+        order[count].test = all.items[i];
+        order[count++].seconds = history_of(&history, all.items[i]);
+    }
+    qsort(order, (size_t)count, sizeof(Scheduled), slowest_first);
+
+    if (opts->dry_run) {
+        for (int i = 0; i < count; i++) printf("%s\n", order[i].test);
+        goto done;
+    }
+    if (count == 0) {
+        printf("No tests in shard %d/%d.\n", tests->shard, tests->shards);
+        goto done;
+    }
+
+    for (int i = 0; i < count; i++) {
+        jobs[i].cmd = strdup(order[i].test);
+        jobs[i].label = strdup(order[i].test);
+        jobs[i].timeout = tests->timeout;
+    }
+
+    // Every test runs, whatever the others do.
+    double start = now_seconds();
+    JobPool pool = { opts->jobs, 1, 0, report_test, NULL, NULL, NULL, NULL, opts->catch_signals };
+    if (opts->progress) {
+        pool.progress = opts->progress;
+        pool.progress_ctx = opts->progress_ctx;
+    }
+    run_jobs(jobs, count, &pool);
+    double wall = now_seconds() - start;
+
+    for (int i = 0; i < count; i++) {
+        const Job *job = &jobs[i];
+        if (job->status == JOB_NOT_RUN || job->status == JOB_CANCELLED) continue;
+
+        sum.run++;
+        if (job->status == 0)                   sum.passed++;
+        else if (job->status == JOB_TIMED_OUT)  sum.timed_out++;
+        else                                    sum.failed++;
+        set_history(&history, order[i].test, job->wall);
+    }
+    if (save_history(&history, &all, history_file) != 0) {
+        fprintf(stderr, "Warning: Could not write the test times to %s\n", history_file);
+    }
+
+    printf("Tests finished in %.2fs: %d passed, %d failed, %d timed out", wall, sum.passed, sum.failed,
+           sum.timed_out);
+    if (tests->shards > 1) {
+        printf(" (shard %d/%d, %d of %d tests)", tests->shard, tests->shards, count, all.count);
+    }
+    printf(".\n");
+
+    // Tests an interrupt kept from finishing didn't pass either.
+    if (sum.passed < count) {
+        *errmsg = str_printf("%d of %d test(s) failed.", count - sum.passed, count);
+        result = BUILD_TEST_FAILED;
+    }
+
+done:
+    if (jobs) {
+        for (int i = 0; i < count; i++) free_job(&jobs[i]);
+        free(jobs);
+    }
+    free(order);
+    free(history_file);
+    free_history(&history);
+    strlist_free(&all);
+    if (summary) *summary = sum;
+    return result;
+}
@@ -0,0 +1,463 @@
+/* ****************************************************************************************************
+ * toolchain.c - Probing and caching of compiler capabilities. Every probe is a tiny compile or link in
+ * a scratch directory next to the cache, run through system() so it works the same with any shell.
+ * A probe only counts as passed if the compiler succeeded without printing a single word: gcc and
+ * clang accept some unknown options with no more than a warning.
+ *
+ * The cache file is plain "key=value" text, one file per compiler binary. Its name is a hash of the
+ * comp directive and the binary's path, size and modification time; the same values are stored
+ * inside and compared again on load, so a hash collision can't hand out a wrong record.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created.                                                         Version: 00.01
+ * Sun 2026-10-18 Probe for P1689 module scanning: gcc's -fdeps or clang-scan-deps.     Version: 00.02
+ * Sun 2026-10-18 Probe --gdb-index, find dwp and objcopy for debug=split.              Version: 00.03
+ * Sun 2026-10-18 Probe -fprofile-prefix-path and find llvm-profdata for pmake --pgo.   Version: 00.04
+ * Sun 2026-10-18 cache_dir() moved to util.c, the package cache shares it.             Version: 00.05
+ * Sun 2026-10-18 Compiler family from the predefined macros, not from --version.       Version: 00.06
+ * **************************************************************************************************** */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <sys/stat.h>
+#include "toolchain.h"
+#include "util.h"
+#include "debug.h"
+
+#ifdef _WIN32
+    #include <process.h>
+    #define PATH_SEPARATOR ';'
+    #define _pid() _getpid()
+#else
+    #include <unistd.h>
+    #define PATH_SEPARATOR ':'
+    #define _pid() getpid()
+#endif
+
+// Linkers tried with -fuse-ld=, fastest first.
+static const char *const LINKERS[] = { "mold", "lld", "gold", "bfd" };
+
+// --------------------------------------------------------------------------------
+// Tell whether a path names a regular file we may run.
+// --------------------------------------------------------------------------------
+static int is_program(const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) return 0;
+#ifdef _WIN32
+    return 1;
+#else
+    return access(path, X_OK) == 0;
+#endif
+}
+
+// --------------------------------------------------------------------------------
+// Find the binary the shell would run for a program name: taken as it is if it
+// contains a directory, otherwise looked up in PATH. Windows also tries ".exe".
+//
+// @return  Allocated path (caller frees), or NULL if there is no such program
+// --------------------------------------------------------------------------------
+static char *resolve_program(const char *prog) {
+    if (strchr(prog, '/') || strchr(prog, '\\')) {
+        if (is_program(prog)) return strdup(prog);
+#ifdef _WIN32
+        char *exe = str_printf("%s.exe", prog);
+        if (is_program(exe)) return exe;
+        free(exe);
+#endif
+        return NULL;
+    }
+
+    const char *path = getenv("PATH");
+    while (path && *path) {
+        const char *end = strchr(path, PATH_SEPARATOR);
+        size_t len = end ? (size_t)(end - path) : strlen(path);
+
+        char *candidate = str_printf("%.*s/%s", (int)len, len ? path : ".", prog);
+        if (is_program(candidate)) return candidate;
+        free(candidate);
+#ifdef _WIN32
+        candidate = str_printf("%.*s/%s.exe", (int)len, len ? path : ".", prog);
+        if (is_program(candidate)) return candidate;
+        free(candidate);
+#endif
+        if (!end) break;
+        path = end + 1;
+    }
+    return NULL;
+}
+
+// --------------------------------------------------------------------------------
+// Find a tool that belongs to a compiler, such as clang-scan-deps or llvm-dwp:
+// next to the compiler first, then in PATH. A versioned clang such as clang++-17
+// looks for tool-17 first and the unversioned tool after that.
+//
+// @param compiler  Resolved path of the compiler
+// @param tool      Name of the tool
+// @return          Allocated path (caller frees), or NULL if there is none
+// --------------------------------------------------------------------------------
+static char *find_companion(const char *compiler, const char *tool) {
+    const char *slash = strrchr(compiler, '/');
+    const char *base = slash ? slash + 1 : compiler;
+    const char *suffix = strncmp(base, "clang++", 7) == 0 ? base + 7
+                       : strncmp(base, "clang", 5) == 0   ? base + 5 : "";
+
+    char *found = NULL;
+    if (slash) {
+        char *candidate = str_printf("%.*s%s%s", (int)(slash + 1 - compiler), compiler, tool, suffix);
+        if (is_program(candidate)) found = candidate;
+        else free(candidate);
+    }
+    if (!found) {
+        char *name = str_printf("%s%s", tool, suffix);
+        found = resolve_program(name);
+        free(name);
+    }
+    if (!found && *suffix) found = resolve_program(tool);
+    return found;
+}
+
+// --------------------------------------------------------------------------------
+// Run one probe command with its output going to a file, and tell whether it
+// passed: exit code 0 and not a word of output.
+// --------------------------------------------------------------------------------
+static int run_probe(const char *cmd, const char *log) {
+    char *full = str_printf("%s > \"%s\" 2>&1", cmd, log);
+    debug("probe: %s\n", full);
+    int rc = system(full);
+    free(full);
+
+    size_t len = 0;
+    char *out = read_file(log, &len);
+    int passed = rc == 0 && out != NULL && len == 0;
+    free(out);
+    return passed;
+}
+
+// --------------------------------------------------------------------------------
+// Probe every capability of the compiler by running it in a scratch directory.
+// The directory and everything in it is removed afterwards.
+// --------------------------------------------------------------------------------
+static void probe_capabilities(Toolchain *tc, const char *scratch) {
+    char *src = str_printf("%s/probe.c", scratch);
+    char *obj = str_printf("%s/probe.o", scratch);
+    char *dep = str_printf("%s/probe.d", scratch);
+    char *dwo = str_printf("%s/probe.dwo", scratch);
+    char *ddi = str_printf("%s/probe.ddi", scratch);
+    char *gcno = str_printf("%s/probe.gcno", scratch);
+    char *exe = str_printf("%s/probe.out", scratch);
+    char *log = str_printf("%s/probe.log", scratch);
+    const char *program = "int main(void) { return 0; }\n";
+    char *cmd;
+
+    write_file_atomic(src, program, strlen(program));
+
+    cmd = str_printf("%s --version", tc->comp);
+    run_probe(cmd, log);
+    free(cmd);
+    char *text = read_file(log, NULL);
+    if (text) {
+        text[strcspn(text, "\r\n")] = '\0';
+        if (*text) tc->version = strdup(text);
+        free(text);
+    }
+
+    // The family comes from the predefined macros, not the version text: a "cc"
+    // of a distribution calls itself "cc (Debian 12.2.0-14) 12.2.0". clang
+    // defines __GNUC__ as well, so it is asked about first.
+    cmd = str_printf("%s -dM -E \"%s\"", tc->comp, src);
+    run_probe(cmd, log);
+    free(cmd);
+    text = read_file(log, NULL);
+    if (text && strstr(text, "#define __clang__ "))     tc->kind = TOOLCHAIN_CLANG;
+    else if (text && strstr(text, "#define __GNUC__ ")) tc->kind = TOOLCHAIN_GCC;
+    free(text);
+
+    // Precompiled headers aren't interchangeable: gcc looks for header.h.gch next
+    // to the header, clang wants an explicit -include-pch file.
+    if (tc->kind == TOOLCHAIN_GCC)        tc->pch_ext = strdup(".gch");
+    else if (tc->kind == TOOLCHAIN_CLANG) tc->pch_ext = strdup(".pch");
+
+    cmd = str_printf("%s -MMD -MF \"%s\" -c \"%s\" -o \"%s\"", tc->comp, dep, src, obj);
+    tc->depfiles = run_probe(cmd, log) && file_mtime(dep) >= 0;
+    free(cmd);
+
+    cmd = str_printf("%s -gsplit-dwarf -c \"%s\" -o \"%s\"", tc->comp, src, obj);
+    tc->split_dwarf = run_probe(cmd, log) && file_mtime(dwo) >= 0;
+    free(cmd);
+
+    // Module dependencies for lang=c++: gcc 14 writes P1689 files while
+    // preprocessing, clang needs the separate clang-scan-deps.
+    if (tc->kind == TOOLCHAIN_GCC) {
+        cmd = str_printf("%s -x c++ -std=c++20 -fmodules-ts -E -fdeps-format=p1689r5 -fdeps-file=\"%s\" "
+                         "-fdeps-target=\"%s\" \"%s\" -o \"%s\"", tc->comp, ddi, obj, src, exe);
+        tc->p1689 = run_probe(cmd, log) && file_mtime(ddi) >= 0;
+        free(cmd);
+        remove(exe);
+    }
+    else if (tc->kind == TOOLCHAIN_CLANG) {
+        tc->scan_deps = find_companion(tc->path, "clang-scan-deps");
+    }
+
+    // Profile-guided optimization. gcc names its profiles after the object files,
+    // and only strips the object directory from the names with -fprofile-prefix-path;
+    // clang writes raw profiles that llvm-profdata has to merge.
+    if (tc->kind == TOOLCHAIN_GCC) {
+        cmd = str_printf("%s -fprofile-generate=\"%s\" -fprofile-prefix-path=\"%s\" -c \"%s\" -o \"%s\"",
+                         tc->comp, scratch, scratch, src, obj);
+        tc->profile_prefix = run_probe(cmd, log);
+        free(cmd);
+        remove(gcno);
+    }
+    else if (tc->kind == TOOLCHAIN_CLANG) {
+        tc->profdata = find_companion(tc->path, "llvm-profdata");
+    }
+
+    for (size_t i = 0; i < sizeof(LINKERS) / sizeof(LINKERS[0]); i++) {
+        cmd = str_printf("%s -fuse-ld=%s \"%s\" -o \"%s\"", tc->comp, LINKERS[i], src, exe);
+        if (run_probe(cmd, log)) strlist_push(&tc->linkers, strdup(LINKERS[i]));
+        free(cmd);
+        remove(exe);
+    }
+
+    // Only some linkers build the gdb index (bfd doesn't), and they are listed
+    // fastest first.
+    for (int i = 0; i < tc->linkers.count && !tc->gdb_index_ld; i++) {
+        cmd = str_printf("%s -fuse-ld=%s -Wl,--gdb-index \"%s\" -o \"%s\"", tc->comp, tc->linkers.items[i],
+                         src, exe);
+        if (run_probe(cmd, log)) tc->gdb_index_ld = strdup(tc->linkers.items[i]);
+        free(cmd);
+        remove(exe);
+    }
+
+    // The split DWARF tools. llvm-dwp is preferred for gcc as well: the dwp of
+    // binutils doesn't understand DWARF 5, which gcc writes since version 11.
+    if (tc->kind == TOOLCHAIN_CLANG) {
+        tc->dwp = find_companion(tc->path, "llvm-dwp");
+        tc->objcopy = find_companion(tc->path, "llvm-objcopy");
+    }
+    if (!tc->dwp) tc->dwp = resolve_program("llvm-dwp");
+    if (!tc->dwp) tc->dwp = resolve_program("dwp");
+    if (!tc->objcopy) tc->objcopy = resolve_program("objcopy");
+
+    remove(src);
+    remove(obj);
+    remove(dep);
+    remove(dwo);
+    remove(ddi);
+    remove(gcno);
+    remove(exe);
+    remove(log);
+    remove(scratch);    // remove() takes empty directories as well
+    free(src);
+    free(obj);
+    free(dep);
+    free(dwo);
+    free(ddi);
+    free(gcno);
+    free(exe);
+    free(log);
+}
+
+// --------------------------------------------------------------------------------
+// Read a cached record into tc if the file exists and describes exactly this
+// binary and probe format.
+//
+// @return  1 if the record was loaded, 0 otherwise
+// --------------------------------------------------------------------------------
+static int load_record(Toolchain *tc, const char *file) {
+    char *data = read_file(file, NULL);
+    if (!data) return 0;
+
+    int format = 0, matches = 0;
+    char *line = data;
+    while (*line) {
+        char *end = strchr(line, '\n');
+        if (end) *end = '\0';
+
+        char *eq = strchr(line, '=');
+        if (eq) {
+            *eq = '\0';
+            const char *key = line, *value = eq + 1;
+
+            if (strcmp(key, "format") == 0)         format = atoi(value);
+            else if (strcmp(key, "comp") == 0)      matches += strcmp(value, tc->comp) == 0;
+            else if (strcmp(key, "path") == 0)      matches += strcmp(value, tc->path) == 0;
+            else if (strcmp(key, "size") == 0)      matches += atoll(value) == tc->size;
+            else if (strcmp(key, "mtime") == 0)     matches += atoll(value) == tc->mtime;
+            else if (strcmp(key, "kind") == 0)      tc->kind = (ToolchainKind)atoi(value);
+            else if (strcmp(key, "version") == 0)   tc->version = *value ? strdup(value) : NULL;
+            else if (strcmp(key, "depfiles") == 0)  tc->depfiles = atoi(value);
+            else if (strcmp(key, "split_dwarf") == 0) tc->split_dwarf = atoi(value);
+            else if (strcmp(key, "linkers") == 0)   split_words(value, &tc->linkers);
+            else if (strcmp(key, "pch_ext") == 0)   tc->pch_ext = *value ? strdup(value) : NULL;
+            else if (strcmp(key, "p1689") == 0)     tc->p1689 = atoi(value);
+            else if (strcmp(key, "scan_deps") == 0) tc->scan_deps = *value ? strdup(value) : NULL;
+            else if (strcmp(key, "profile_prefix") == 0) tc->profile_prefix = atoi(value);
+            else if (strcmp(key, "profdata") == 0)  tc->profdata = *value ? strdup(value) : NULL;
+            else if (strcmp(key, "gdb_index_ld") == 0) tc->gdb_index_ld = *value ? strdup(value) : NULL;
+            else if (strcmp(key, "dwp") == 0)       tc->dwp = *value ? strdup(value) : NULL;
+            else if (strcmp(key, "objcopy") == 0)   tc->objcopy = *value ? strdup(value) : NULL;
+        }
+
+        if (!end) break;
+        line = end + 1;
+    }
+    free(data);
+
+    if (format == TOOLCHAIN_FORMAT && matches == 4 && tc->kind <= TOOLCHAIN_CLANG) return 1;
+
+    // Stale or foreign record: forget whatever was read.
+    free(tc->version);
+    free(tc->pch_ext);
+    free(tc->scan_deps);
+    free(tc->profdata);
+    free(tc->gdb_index_ld);
+    free(tc->dwp);
+    free(tc->objcopy);
+    strlist_free(&tc->linkers);
+    tc->version = NULL;
+    tc->pch_ext = NULL;
+    tc->scan_deps = NULL;
+    tc->profdata = NULL;
+    tc->gdb_index_ld = NULL;
+    tc->dwp = NULL;
+    tc->objcopy = NULL;
+    tc->p1689 = 0;
+    tc->profile_prefix = 0;
+    tc->kind = TOOLCHAIN_UNKNOWN;
+    tc->depfiles = 0;
+    tc->split_dwarf = 0;
+    return 0;
+}
+
+// --------------------------------------------------------------------------------
+// Write the record to the cache. A cache that can't be written only means the
+// next build probes again, so failures are ignored.
+// --------------------------------------------------------------------------------
+static void save_record(const Toolchain *tc, const char *file) {
+    StrBuf sb = {0};
+    sb_printf(&sb, "format=%d\ncomp=%s\npath=%s\nsize=%lld\nmtime=%lld\n", TOOLCHAIN_FORMAT,
+              tc->comp, tc->path, tc->size, tc->mtime);
+    sb_printf(&sb, "kind=%d\nversion=%s\n", (int)tc->kind, tc->version ? tc->version : "");
+    sb_printf(&sb, "depfiles=%d\nsplit_dwarf=%d\nlinkers=", tc->depfiles, tc->split_dwarf);
+    for (int i = 0; i < tc->linkers.count; i++) sb_printf(&sb, "%s%s", i ? " " : "", tc->linkers.items[i]);
+    sb_printf(&sb, "\npch_ext=%s\n", tc->pch_ext ? tc->pch_ext : "");
+    sb_printf(&sb, "p1689=%d\nscan_deps=%s\n", tc->p1689, tc->scan_deps ? tc->scan_deps : "");
+    sb_printf(&sb, "profile_prefix=%d\nprofdata=%s\n", tc->profile_prefix,
+              tc->profdata ? tc->profdata : "");
+    sb_printf(&sb, "gdb_index_ld=%s\ndwp=%s\nobjcopy=%s\n", tc->gdb_index_ld ? tc->gdb_index_ld : "",
+              tc->dwp ? tc->dwp : "", tc->objcopy ? tc->objcopy : "");
+
+    if (make_parent_dirs(file) == 0) write_file_atomic(file, sb.data, sb.len);
+    sb_free(&sb);
+}
+
+void probe_toolchain(const char *comp, Toolchain *tc) {
+    memset(tc, 0, sizeof(*tc));
+    tc->comp = strdup(comp);
+
+    // Defaults for a compiler pmake can't look at: what gcc and clang both do.
+    tc->depfiles = 1;
+
+    // The binary is the first word; "ccache gcc" is keyed on ccache.
+    StrList words = {0};
+    split_words(comp, &words);
+    if (words.count > 0) tc->path = resolve_program(words.items[0]);
+    strlist_free(&words);
+    if (!tc->path) return;
+
+    struct stat st;
+    if (stat(tc->path, &st) == 0) tc->size = (long long)st.st_size;
+    tc->mtime = file_mtime(tc->path);
+
+    char *dir = cache_dir();
+    char *file = NULL;
+    if (dir) {
+        uint64_t key = hash_bytes(comp, strlen(comp), HASH_SEED);
+        key = hash_bytes(tc->path, strlen(tc->path), key);
+        key = hash_bytes(&tc->size, sizeof(tc->size), key);
+        key = hash_bytes(&tc->mtime, sizeof(tc->mtime), key);
+        file = str_printf("%s/toolchain-%016" PRIx64, dir, key);
+
+        if (load_record(tc, file)) {
+            tc->from_cache = 1;
+            free(file);
+            free(dir);
+            return;
+        }
+    }
+
+    // Probe in a scratch directory of our own, so two builds probing at the
+    // same time don't trip over each other's files.
+    const char *tmp = getenv("TMPDIR");
+    char *scratch = dir ? str_printf("%s/probe.%d", dir, (int)_pid())
+                        : str_printf("%s/pmake-probe.%d", tmp && *tmp ? tmp : "/tmp", (int)_pid());
+    tc->depfiles = 0;
+    if (make_dirs(scratch) == 0) {
+        probe_capabilities(tc, scratch);
+        if (file) save_record(tc, file);
+    }
+    else {
+        tc->depfiles = 1;
+    }
+
+    free(scratch);
+    free(file);
+    free(dir);
+}
+
+void free_toolchain(Toolchain *tc) {
+    free(tc->comp);
+    free(tc->path);
+    free(tc->version);
+    free(tc->pch_ext);
+    free(tc->scan_deps);
+    free(tc->profdata);
+    free(tc->gdb_index_ld);
+    free(tc->dwp);
+    free(tc->objcopy);
+    strlist_free(&tc->linkers);
+    memset(tc, 0, sizeof(*tc));
+}
+
+int toolchain_has_linker(const Toolchain *tc, const char *name) {
+    for (int i = 0; i < tc->linkers.count; i++) {
+        if (strcmp(tc->linkers.items[i], name) == 0) return 1;
+    }
+    return 0;
+}
+
+void print_toolchain(const Toolchain *tc) {
+    static const char *const kinds[] = { "unknown", "gcc", "clang" };
+
+    printf("compiler:    %s\n", tc->comp);
+    if (!tc->path) {
+        printf("path:        not found\n");
+        return;
+    }
+    printf("path:        %s (%s)\n", tc->path, tc->from_cache ? "cached" : "probed");
+    printf("kind:        %s\n", kinds[tc->kind]);
+    printf("version:     %s\n", tc->version ? tc->version : "unknown");
+    printf("depfiles:    %s\n", tc->depfiles ? "yes (-MMD -MF)" : "no");
+    printf("split dwarf: %s\n", tc->split_dwarf ? "yes (-gsplit-dwarf)" : "no");
+    printf("linkers:     ");
+    for (int i = 0; i < tc->linkers.count; i++) printf("%s%s", i ? " " : "", tc->linkers.items[i]);
+    printf("%s\n", tc->linkers.count ? "" : "default only");
+    printf("gdb index:   %s\n", tc->gdb_index_ld ? tc->gdb_index_ld : "no");
+    printf("dwp:         %s\n", tc->dwp ? tc->dwp : "not found");
+    printf("objcopy:     %s\n", tc->objcopy ? tc->objcopy : "not found");
+    printf("pch:         %s\n", tc->pch_ext ? tc->pch_ext : "unknown");
+    if (tc->profdata)            printf("pgo:         %s\n", tc->profdata);
+    else if (tc->profile_prefix) printf("pgo:         -fprofile-prefix-path\n");
+    else                         printf("pgo:         no\n");
+    if (tc->p1689)          printf("modules:     -fdeps-format=p1689r5\n");
+    else if (tc->scan_deps) printf("modules:     %s\n", tc->scan_deps);
+    else                    printf("modules:     built-in scanner\n");
+}
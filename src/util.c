@@ -0,0 +1,311 @@
+/* ****************************************************************************************************
+ * util.c - Implementation of the shared string and filesystem helpers. The string buffer replaces the
+ * fixed 1024 byte command strings pmake used to build — a project with a few hundred source files
+ * simply doesn't fit in that.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created.                                                         Version: 00.01
+ * Sun 2026-10-18 Added sb_json_string() and write_file_atomic().                       Version: 00.02
+ * Sun 2026-10-18 Added file_mtime() and hash_bytes().                                  Version: 00.03
+ * Sun 2026-10-18 Added now_seconds().                                                  Version: 00.04
+ * Sun 2026-10-18 Added read_file().                                                    Version: 00.05
+ * Sun 2026-10-18 Added hash_file().                                                    Version: 00.06
+ * Sun 2026-10-18 Added replace_file(), write_file_atomic() uses it.                    Version: 00.07
+ * Sun 2026-10-18 Added cache_dir().                                                    Version: 00.08
+ * **************************************************************************************************** */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "util.h"
+
+#ifdef _WIN32
+    #include <windows.h>
+    #include <direct.h>
+    #include <process.h>
+    #define _mkdir_one(p) _mkdir(p)
+    #define _pid() _getpid()
+#else
+    #include <unistd.h>
+    #include <time.h>
+    #define _mkdir_one(p) mkdir(p, 0777)
+    #define _pid() getpid()
+#endif
+
+char *str_printf(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    va_list copy;
+    va_copy(copy, args);
+    int size = vsnprintf(NULL, 0, fmt, copy) + 1;
+    va_end(copy);
+
+    char *s = malloc(size);
+    if (s) vsnprintf(s, size, fmt, args);
+    va_end(args);
+    return s;
+}
+
+// --------------------------------------------------------------------------------
+// Make sure the buffer has room for at least `extra` more bytes plus the null
+// terminator. Doubles the capacity so repeated appends stay cheap.
+// --------------------------------------------------------------------------------
+static int sb_reserve(StrBuf *sb, size_t extra) {
+    if (sb->len + extra + 1 <= sb->cap) return 0;
+
+    size_t cap = sb->cap ? sb->cap : 256;
+    while (cap < sb->len + extra + 1) cap *= 2;
+
+    char *data = realloc(sb->data, cap);
+    if (!data) return -1;
+
+    sb->data = data;
+    sb->cap = cap;
+    return 0;
+}
+
+void sb_printf(StrBuf *sb, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    va_list copy;
+    va_copy(copy, args);
+    int size = vsnprintf(NULL, 0, fmt, copy);
+    va_end(copy);
+
+    if (size >= 0 && sb_reserve(sb, (size_t)size) == 0) {
+        vsnprintf(sb->data + sb->len, (size_t)size + 1, fmt, args);
+        sb->len += (size_t)size;
+    }
+    va_end(args);
+}
+
+void sb_append(StrBuf *sb, const char *data, size_t len) {
+    if (sb_reserve(sb, len) != 0) return;
+    memcpy(sb->data + sb->len, data, len);
+    sb->len += len;
+    sb->data[sb->len] = '\0';
+}
+
+void sb_json_string(StrBuf *sb, const char *s) {
+    sb_append(sb, "\"", 1);
+    for (const char *p = s; *p; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c == '"' || c == '\\') {
+            char esc[2] = { '\\', (char)c };
+            sb_append(sb, esc, 2);
+        }
+        else if (c == '\n') sb_append(sb, "\\n", 2);
+        else if (c == '\t') sb_append(sb, "\\t", 2);
+        else if (c < 0x20)  sb_printf(sb, "\\u%04x", c);
+        else                sb_append(sb, p, 1);
+    }
+    sb_append(sb, "\"", 1);
+}
+
+void sb_free(StrBuf *sb) {
+    free(sb->data);
+    sb->data = NULL;
+    sb->len = 0;
+    sb->cap = 0;
+}
+
+void strlist_push(StrList *l, char *s) {
+    if (!s) return;
+    if (l->count == l->cap) {
+        int cap = l->cap ? l->cap * 2 : 16;
+        char **items = realloc(l->items, sizeof(char *) * cap);
+        if (!items) {
+            free(s);
+            return;
+        }
+        l->items = items;
+        l->cap = cap;
+    }
+    l->items[l->count++] = s;
+}
+
+void strlist_free(StrList *l) {
+    for (int i = 0; i < l->count; i++) free(l->items[i]);
+    free(l->items);
+    l->items = NULL;
+    l->count = 0;
+    l->cap = 0;
+}
+
+int split_words(const char *s, StrList *out) {
+    int added = 0;
+    if (!s) return 0;
+
+    while (*s) {
+        while (*s && isspace((unsigned char)*s)) s++;
+        if (!*s) break;
+
+        const char *start = s;
+        while (*s && !isspace((unsigned char)*s)) s++;
+
+        size_t len = (size_t)(s - start);
+        char *word = malloc(len + 1);
+        if (!word) break;
+        memcpy(word, start, len);
+        word[len] = '\0';
+        strlist_push(out, word);
+        added++;
+    }
+
+    return added;
+}
+
+int make_dirs(const char *path) {
+    char *tmp = strdup(path);
+    if (!tmp) return -1;
+
+    // Walk the path and create every prefix that ends at a separator. The first
+    // character is skipped so absolute paths don't try to create "".
+    for (char *p = tmp + 1; *p; p++) {
+        if (*p != '/' && *p != '\\') continue;
+        char c = *p;
+        *p = '\0';
+        if (_mkdir_one(tmp) != 0 && errno != EEXIST) {
+            free(tmp);
+            return -1;
+        }
+        *p = c;
+    }
+
+    int rc = (_mkdir_one(tmp) != 0 && errno != EEXIST) ? -1 : 0;
+    free(tmp);
+    return rc;
+}
+
+int make_parent_dirs(const char *file) {
+    const char *slash = strrchr(file, '/');
+#ifdef _WIN32
+    const char *bslash = strrchr(file, '\\');
+    if (bslash > slash) slash = bslash;
+#endif
+    if (!slash || slash == file) return 0;
+
+    char *dir = malloc((size_t)(slash - file) + 1);
+    if (!dir) return -1;
+    memcpy(dir, file, (size_t)(slash - file));
+    dir[slash - file] = '\0';
+
+    int rc = make_dirs(dir);
+    free(dir);
+    return rc;
+}
+
+int write_file_atomic(const char *path, const char *data, size_t len) {
+    char *tmp = str_printf("%s.tmp.%d", path, (int)_pid());
+    if (!tmp) return -1;
+
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) {
+        free(tmp);
+        return -1;
+    }
+
+    int ok = fwrite(data, 1, len, fp) == len;
+    ok &= fclose(fp) == 0;
+
+    if (!ok || replace_file(tmp, path) != 0) {
+        remove(tmp);
+        free(tmp);
+        return -1;
+    }
+
+    free(tmp);
+    return 0;
+}
+
+int replace_file(const char *from, const char *to) {
+#ifdef _WIN32
+    // rename() on Windows refuses to replace an existing file.
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) ? 0 : -1;
+#else
+    return rename(from, to) == 0 ? 0 : -1;
+#endif
+}
+
+char *read_file(const char *path, size_t *len_out) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return NULL;
+
+    StrBuf sb = {0};
+    char buf[8192];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) sb_append(&sb, buf, n);
+    fclose(fp);
+
+    if (!sb.data) sb_append(&sb, "", 0);
+    if (len_out) *len_out = sb.len;
+    return sb.data;
+}
+
+long long file_mtime(const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0) return -1;
+
+#if defined(__APPLE__)
+    return (long long)st.st_mtimespec.tv_sec * 1000000000LL + st.st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+    return (long long)st.st_mtime * 1000000000LL;
+#else
+    return (long long)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+}
+
+uint64_t hash_bytes(const void *data, size_t len, uint64_t seed) {
+    const unsigned char *p = data;
+    uint64_t h = seed;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+uint64_t hash_file(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return 0;
+
+    char buf[65536];
+    uint64_t hash = HASH_SEED;
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) hash = hash_bytes(buf, n, hash);
+
+    int failed = ferror(fp);
+    fclose(fp);
+    return failed ? 0 : hash;
+}
+
+double now_seconds(void) {
+#ifdef _WIN32
+    return GetTickCount64() / 1000.0;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
+
+char *cache_dir(void) {
+#ifdef _WIN32
+    const char *base = getenv("LOCALAPPDATA");
+    return base && *base ? str_printf("%s\\pmake", base) : NULL;
+#else
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    if (xdg && *xdg) return str_printf("%s/pmake", xdg);
+    const char *home = getenv("HOME");
+    return home && *home ? str_printf("%s/.cache/pmake", home) : NULL;
+#endif
+}
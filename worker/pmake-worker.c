@@ -0,0 +1,354 @@
+/* ****************************************************************************************************
+ * pmake-worker.c - Compile daemon for distributed pmake builds. pmake preprocesses its translation
+ * units locally and sends them here over TCP, together with the compiler and the exact compile flags.
+ * The worker compiles each unit in a private temporary directory and sends back the compiler's exit
+ * code, its diagnostics and the object file. The worker never needs the project's sources or headers.
+ *
+ * Every connection is handled by its own forked process, at most --jobs at a time; further clients
+ * wait in the listen queue. Only compilers on the --allow list are run, by name from the worker's own
+ * PATH and without a shell, and flags that make a compiler load other programs or plugins (-wrapper,
+ * -fplugin=, -specs=, -B, response files, ...) are refused. That narrows what a client can do, it
+ * doesn't make the worker safe for strangers: anyone who can connect can make it compile and write
+ * files in its temporary directory. Only run it on networks you trust. It listens
+ * on 127.0.0.1 unless told otherwise, so several workers on different ports can be tried out on a
+ * single machine:
+ *
+ *   pmake-worker --port 3733 &
+ *   pmake-worker --port 3734 &
+ *   # myproject.pmake: workers=localhost:3733 localhost:3734
+ *
+ * Usage: pmake-worker [--listen ADDR] [--port N] [--jobs N] [--allow LIST] [--verbose]
+ *
+ * Unix-like systems only.
+ * ----------------------------------------------------------------------------------------------------
+ * Author:      Patrik Eigenmann
+ * eMail:       p.eigenmann@gmx.net
+ * GitHub:      www.github.com/PatrikEigenmann/pmake
+ * ----------------------------------------------------------------------------------------------------
+ * Change Log:
+ * Sun 2026-10-18 File created.                                                         Version: 00.01
+ * Sun 2026-10-18 Compilers by name from PATH only, flags that load code refused.       Version: 00.02
+ * **************************************************************************************************** */
+#define _XOPEN_SOURCE 700  // mkdtemp()
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "remote.h"
+#include "util.h"
+
+// Compilers a worker runs unless --allow says otherwise.
+#define DEFAULT_ALLOW "cc gcc g++ c++ clang clang++"
+
+typedef struct {
+    const char *listen;     // Address to bind to
+    const char *port;       // Port to listen on
+    int jobs;               // Compiles running at the same time
+    StrList allow;          // Compiler names that may be run
+    int verbose;            // Log every request to stderr
+} WorkerConfig;
+
+// Flags that make a compiler run other programs or load code: a wrapper, plugins, spec files, another
+// directory for its own programs, options passed through to cc1, and response files, which could hold
+// any of those. A flag matches if it starts with one of these.
+static const char *const REFUSED_FLAGS[] = {
+    "-wrapper", "-fplugin", "-fpass-plugin", "-specs", "--specs", "-B", "--prefix", "-Xclang",
+    "--gcc-toolchain", "@"
+};
+
+// --------------------------------------------------------------------------------
+// Tell whether a compiler may run: it must be a bare name on the allow list. A
+// path is refused, so only what the worker's own PATH finds under that name runs,
+// not a program the client points at.
+// --------------------------------------------------------------------------------
+static int is_allowed(const WorkerConfig *cfg, const char *comp) {
+    if (strchr(comp, '/')) return 0;
+    for (int i = 0; i < cfg->allow.count; i++) {
+        if (strcmp(cfg->allow.items[i], comp) == 0) return 1;
+    }
+    return 0;
+}
+
+// --------------------------------------------------------------------------------
+// Find the first flag the worker refuses to pass to a compiler.
+//
+// @return  Allocated copy of the flag, or NULL if all of them are fine
+// --------------------------------------------------------------------------------
+static char *refused_flag(const char *flags) {
+    StrList words = {0};
+    char *found = NULL;
+    split_words(flags, &words);
+    for (int i = 0; i < words.count && !found; i++) {
+        for (size_t k = 0; k < sizeof(REFUSED_FLAGS) / sizeof(REFUSED_FLAGS[0]) && !found; k++) {
+            if (strncmp(words.items[i], REFUSED_FLAGS[k], strlen(REFUSED_FLAGS[k])) == 0) {
+                found = strdup(words.items[i]);
+            }
+        }
+    }
+    strlist_free(&words);
+    return found;
+}
+
+// --------------------------------------------------------------------------------
+// Send a reply: the kind, the exit code, the text for the client's stderr (or the
+// reason of a worker error) and the object file.
+// --------------------------------------------------------------------------------
+static void send_reply(int fd, uint32_t kind, uint32_t status, const char *text, size_t text_len,
+                       const char *object, size_t object_len) {
+    if (write(fd, REMOTE_MAGIC, 4) != 4) return;
+    if (wire_write_u32(fd, kind) != 0 || wire_write_u32(fd, status) != 0) return;
+    if (wire_write_field(fd, text, text_len) != 0) return;
+    wire_write_field(fd, object ? object : "", object_len);
+}
+
+static void send_error(int fd, const char *reason) {
+    send_reply(fd, REMOTE_WORKER_ERROR, 0, reason, strlen(reason), NULL, 0);
+}
+
+// --------------------------------------------------------------------------------
+// Run the compiler on the preprocessed unit without a shell: comp flags -c in -o
+// out, with stdout and stderr going to the file log.
+//
+// @return  Exit code of the compiler, or -1 if it couldn't be started
+// --------------------------------------------------------------------------------
+static int run_compiler(const char *comp, const char *flags, const char *in, const char *out,
+                        const char *log) {
+    StrList argv = {0};
+    strlist_push(&argv, strdup(comp));
+    split_words(flags, &argv);
+    strlist_push(&argv, strdup("-c"));
+    strlist_push(&argv, strdup(in));
+    strlist_push(&argv, strdup("-o"));
+    strlist_push(&argv, strdup(out));
+
+    // execvp() wants a NULL-terminated array; strlist_push() ignores NULL.
+    char **args = realloc(argv.items, sizeof(char *) * (size_t)(argv.count + 1));
+    if (!args) {
+        strlist_free(&argv);
+        return -1;
+    }
+    argv.items = args;
+    args[argv.count] = NULL;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        int fd = open(log, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if (fd >= 0) {
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+            close(fd);
+        }
+        execvp(args[0], args);
+        _exit(127);
+    }
+
+    int ws = 0;
+    int rc = -1;
+    if (pid > 0) {
+        while (waitpid(pid, &ws, 0) < 0 && errno == EINTR) {}
+        rc = WIFEXITED(ws) ? WEXITSTATUS(ws) : 128 + WTERMSIG(ws);
+        if (rc == 127) rc = -1;
+    }
+
+    strlist_free(&argv);
+    return rc;
+}
+
+// --------------------------------------------------------------------------------
+// Serve one client: read the request, compile it in a fresh temporary directory,
+// send the result back and clean up. Runs in its own process.
+// --------------------------------------------------------------------------------
+static void serve(const WorkerConfig *cfg, int fd) {
+    char magic[4];
+    char *comp = NULL, *flags = NULL, *name = NULL, *source = NULL;
+    size_t source_len = 0;
+
+    size_t got = 0;
+    while (got < sizeof(magic)) {
+        ssize_t n = read(fd, magic + got, sizeof(magic) - got);
+        if (n <= 0) return;
+        got += (size_t)n;
+    }
+
+    if (memcmp(magic, REMOTE_MAGIC, 4) != 0
+        || wire_read_field(fd, &comp, NULL) != 0 || wire_read_field(fd, &flags, NULL) != 0
+        || wire_read_field(fd, &name, NULL) != 0 || wire_read_field(fd, &source, &source_len) != 0) {
+        send_error(fd, "sent a malformed request");
+        goto done;
+    }
+
+    if (!is_allowed(cfg, comp)) {
+        char *reason = str_printf("does not allow the compiler %s", comp);
+        send_error(fd, reason);
+        free(reason);
+        goto done;
+    }
+
+    char *refused = refused_flag(flags);
+    if (refused) {
+        char *reason = str_printf("does not allow the flag %s", refused);
+        send_error(fd, reason);
+        free(reason);
+        free(refused);
+        goto done;
+    }
+
+    // The name only gives the compiler the right extension and the diagnostics a
+    // familiar file name; it must not reach outside the directory.
+    if (!*name || strchr(name, '/') || strcmp(name, "..") == 0) {
+        send_error(fd, "sent an invalid file name");
+        goto done;
+    }
+
+    const char *tmp = getenv("TMPDIR");
+    char *dir = str_printf("%s/pmake-worker.XXXXXX", tmp && *tmp ? tmp : "/tmp");
+    if (!mkdtemp(dir)) {
+        send_error(fd, "could not create a temporary directory");
+        free(dir);
+        goto done;
+    }
+
+    char *in = str_printf("%s/%s", dir, name);
+    char *out = str_printf("%s/unit.o", dir);
+    char *log = str_printf("%s/output.txt", dir);
+
+    if (write_file_atomic(in, source, source_len) != 0) {
+        send_error(fd, "could not store the unit");
+    }
+    else {
+        int rc = run_compiler(comp, flags, in, out, log);
+        if (rc < 0) {
+            char *reason = str_printf("could not run %s", comp);
+            send_error(fd, reason);
+            free(reason);
+        }
+        else {
+            size_t text_len = 0, object_len = 0;
+            char *text = read_file(log, &text_len);
+            char *object = rc == 0 ? read_file(out, &object_len) : NULL;
+
+            if (rc == 0 && !object) {
+                send_error(fd, "lost the object file");
+            }
+            else {
+                send_reply(fd, REMOTE_COMPILED, (uint32_t)rc, text ? text : "", text ? text_len : 0,
+                           object, object_len);
+            }
+            if (cfg->verbose) fprintf(stderr, "pmake-worker: %s %s (exit %d)\n", comp, name, rc);
+            free(text);
+            free(object);
+        }
+    }
+
+    remove(in);
+    remove(out);
+    remove(log);
+    rmdir(dir);
+    free(in);
+    free(out);
+    free(log);
+    free(dir);
+
+done:
+    free(comp);
+    free(flags);
+    free(name);
+    free(source);
+}
+
+// --------------------------------------------------------------------------------
+// Open the listening socket on the configured address and port.
+// --------------------------------------------------------------------------------
+static int open_listener(const WorkerConfig *cfg) {
+    struct addrinfo hints, *res = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+
+    int rc = getaddrinfo(cfg->listen, cfg->port, &hints, &res);
+    if (rc != 0) {
+        fprintf(stderr, "Error: Cannot resolve %s: %s\n", cfg->listen, gai_strerror(rc));
+        return -1;
+    }
+
+    int fd = -1;
+    for (struct addrinfo *ai = res; ai && fd < 0; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, ai->ai_addr, ai->ai_addrlen) != 0 || listen(fd, 64) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(res);
+
+    if (fd < 0) fprintf(stderr, "Error: Cannot listen on %s:%s: %s\n", cfg->listen, cfg->port, strerror(errno));
+    return fd;
+}
+
+int main(int argc, char **argv) {
+    WorkerConfig cfg = { "127.0.0.1", WORKER_DEFAULT_PORT, 0, {0}, 0 };
+    const char *allow = DEFAULT_ALLOW;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if      (strcmp(a, "--listen") == 0 && v) { cfg.listen = v; i++; }
+        else if (strcmp(a, "--port") == 0 && v)   { cfg.port = v; i++; }
+        else if (strcmp(a, "--jobs") == 0 && v)   { cfg.jobs = atoi(v); i++; }
+        else if (strcmp(a, "--allow") == 0 && v)  { allow = v; i++; }
+        else if (strcmp(a, "--verbose") == 0)     cfg.verbose = 1;
+        else {
+            fprintf(stderr, "Usage: %s [--listen ADDR] [--port N] [--jobs N] [--allow \"cc gcc ...\"]\n"
+                            "       [--verbose]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (cfg.jobs < 1) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        cfg.jobs = n > 0 ? (int)n : 1;
+    }
+    split_words(allow, &cfg.allow);
+
+    int listener = open_listener(&cfg);
+    if (listener < 0) return EXIT_FAILURE;
+
+    // A client that hangs up mid-reply must only end its own connection.
+    signal(SIGPIPE, SIG_IGN);
+
+    fprintf(stderr, "pmake-worker: listening on %s:%s with %d job(s)\n", cfg.listen, cfg.port, cfg.jobs);
+
+    int active = 0;
+    for (;;) {
+        // Reap finished connections; block only when every slot is taken.
+        int ws;
+        while (active > 0 && waitpid(-1, &ws, active >= cfg.jobs ? 0 : WNOHANG) > 0) active--;
+        if (active >= cfg.jobs) continue;
+
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) continue;
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(listener);
+            serve(&cfg, fd);
+            close(fd);
+            _exit(0);
+        }
+        if (pid > 0) active++;
+        close(fd);
+    }
+}